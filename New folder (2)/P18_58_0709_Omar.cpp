@@ -2,637 +2,78 @@
 #include <cstdlib>
 #include <cmath>
 #include <cstdio>
+#include <cstring>
 #include <vector>
 #include <algorithm>
 #include <string>
 #include <sstream>
 #include <ctime>
 #include <chrono>
+#include <thread>
 #include <glut.h>
 
-#define DEG2RAD(a) (a *0.0174532925f)
+#include "coral_render.h"
+#include "coral_profiler.h"
+#include "coral_mazegen.h"
+#include "coral_replay.h"
+#include "coral_stream.h"
+#include "coral_arena.h"
 
 ///////////////
-// Globals (player/camera kept from your version)
+// Globals (frame loop; simulation state lives in coral_sim, camera & scene in coral_render)
 ///////////////
-float playerX = 5.0f;
-float playerY = 0.05f / 2 + 0.1f;
-float playerZ = 5.0f;
-float playerAngleY = 0.0f; // rotation to face movement
-float playerPitch = 0.0f; // tilt on x-axis when airborne
-float playerSpeed = 0.12f; // movement speed
-
-float prevPlayerX = 5.0f;
-float prevPlayerY = 0.05f / 2 + 0.1f;
-float prevPlayerZ = 5.0f;
-
-float groundY = 0.05f / 2 + 0.1f; // ground level
-float maxPlayerY = 3.0f; // maximum allowed height
-
-int collectedGoals = 0;
-int totalGoals = 3;
-
-int cameraViewMode = 1; //1=behind,2=top,3=side
-
-// Timer
-float gameTime = 90.0f; // seconds
-bool gameOver = false;
-bool gameWin = false;
 std::chrono::steady_clock::time_point lastTime;
 
-///////////////
-// Simple Vector
-///////////////
-class Vector3f {
-public:
-	float x, y, z;
-	Vector3f(float _x = 0.0f, float _y = 0.0f, float _z = 0.0f) {
-		x = _x; y = _y; z = _z;
-	}
-	Vector3f operator+(Vector3f v) const { return Vector3f(x + v.x, y + v.y, z + v.z); }
-	Vector3f operator-(Vector3f v) const { return Vector3f(x - v.x, y - v.y, z - v.z); }
-	Vector3f operator*(float n) const { return Vector3f(x * n, y * n, z * n); }
-	Vector3f operator/(float n) const { return Vector3f(x / n, y / n, z / n); }
-	Vector3f unit() const {
-		float L = sqrtf(x * x + y * y + z * z);
-		if (L == 0) return Vector3f(0, 0, 0);
-		return *this / L;
-	}
-	Vector3f cross(Vector3f v) const {
-		return Vector3f(
-			y * v.z - z * v.y,
-			z * v.x - x * v.z,
-			x * v.y - y * v.x
-		);
-	}
-};
-
-///////////////
-// Camera (kept as in lab code)
-///////////////
-class Camera {
-public:
-	Vector3f eye, center, up;
-	Camera(float eyeX = 1.0f, float eyeY = 1.0f, float eyeZ = 1.0f,
-		float centerX = 0.0f, float centerY = 0.0f, float centerZ = 0.0f,
-		float upX = 0.0f, float upY = 1.0f, float upZ = 0.0f)
-	{
-		eye = Vector3f(eyeX, eyeY, eyeZ);
-		center = Vector3f(centerX, centerY, centerZ);
-		up = Vector3f(upX, upY, upZ);
-	}
-	void moveX(float d) { // strafe left/right
-		Vector3f right = up.cross(center - eye).unit();
-		eye = eye + right * d;
-		center = center + right * d;
-	}
-	void moveY(float d) { // move up/down
-		eye = eye + up.unit() * d;
-		center = center + up.unit() * d;
-	}
-	void moveZ(float d) { // move forward/back
-		Vector3f view = (center - eye).unit();
-		eye = eye + view * d;
-		center = center + view * d;
-	}
-	void rotateX(float a) { // pitch
-		Vector3f view = (center - eye).unit();
-		Vector3f right = up.cross(view).unit();
-		float s = sinf(DEG2RAD(a)), c = cosf(DEG2RAD(a));
-		view = view * c + up * s;
-		up = view.cross(right);
-		center = eye + view;
-	}
-	void rotateY(float a) { // yaw
-		Vector3f view = (center - eye).unit();
-		Vector3f right = up.cross(view).unit();
-		float s = sinf(DEG2RAD(a)), c = cosf(DEG2RAD(a));
-		view = view * c + right * s;
-		right = view.cross(up);
-		center = eye + view;
-	}
-	void look() {
-		gluLookAt(eye.x, eye.y, eye.z,
-			center.x, center.y, center.z,
-			up.x, up.y, up.z);
-	}
-};
-
-Camera camera;
-
-///////////////
-// Lighting & primitives (minor aesthetic changes)
-///////////////
-void setupLights() {
-	// Soft underwater ambient
-	GLfloat ambient[] = { 0.05f,0.12f,0.18f,1.0f };
-	GLfloat diffuse[] = { 0.2f,0.4f,0.6f,1.0f };
-	GLfloat specular[] = { 0.3f,0.6f,0.8f,1.0f };
-	GLfloat shininess[] = { 30.0f };
-
-	glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, ambient);
-	glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, diffuse);
-	glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, specular);
-	glMaterialfv(GL_FRONT_AND_BACK, GL_SHININESS, shininess);
-
-	GLfloat lightColor[] = { 0.4f,0.6f,0.9f,1.0f };
-	GLfloat lightPos[] = { -4.0f,6.0f,3.0f,1.0f };
-
-	glLightfv(GL_LIGHT0, GL_POSITION, lightPos);
-	glLightfv(GL_LIGHT0, GL_DIFFUSE, lightColor);
-	glLightfv(GL_LIGHT0, GL_SPECULAR, lightColor);
-}
-
-void setupCameraProjection() {
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	gluPerspective(60.0, 640.0 / 480.0, 0.1, 200.0);
-
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
-	camera.look();
-}
-
-static void drawUnitCube() { glutSolidCube(1.0); }
-static void drawUnitSphere() { glutSolidSphere(0.5, 20, 12); }
-static void drawUnitCylinder() {
-	GLUquadric* q = gluNewQuadric();
-	glPushMatrix();
-	gluCylinder(q, 0.5, 0.5, 1.0, 16, 2);
-	glPopMatrix();
-	gluDeleteQuadric(q);
-}
-
-///////////////
-// AABB collision helper
-///////////////
-struct AABB {
-	float minx, miny, minz;
-	float maxx, maxy, maxz;
-};
-
-bool aabbIntersects(const AABB& a, const AABB& b) {
-	return (a.minx <= b.maxx && a.maxx >= b.minx) &&
-		(a.miny <= b.maxy && a.maxy >= b.miny) &&
-		(a.minz <= b.maxz && a.maxz >= b.minz);
-}
-
-///////////////
-// Scene objects (structures)
-///////////////
-struct SceneObj {
-	float x, y, z;
-	float sx, sy, sz;
-	bool visible;
-	bool animating;
-	float animPhase;
-	SceneObj() : x(0), y(0), z(0), sx(1), sy(1), sz(1), visible(true), animating(false), animPhase(0) {}
-};
-
-std::vector<SceneObj> majorObjs(2);
-std::vector<SceneObj> regObjs(3);
-
-struct GoalObj {
-	float x, y, z;
-	bool visible;
-	float phase;
-};
-std::vector<GoalObj> goals;
-
-struct CoralSegment {
-	float x, y, z;
-	float w, h, d; // box dims
-	bool visible;
-};
-std::vector<CoralSegment> coralSegments;
-
-///////////////
-// Arena & drawing helpers
-///////////////
-const float arenaSize = 10.0f;
-const float wallHeight = 1.0f;
-const float wallTh = 0.2f;
-
-float colorPhase = 0.0f;
-
-void DrawSeabed(float width, float depth) {
-	glPushMatrix();
-	glColor3f(0.06f, 0.2f, 0.12f); // deep seabed
-	glTranslatef(width / 2.0f, 0.0f, depth / 2.0f);
-	glScalef(width, 0.05f, depth);
-	glutSolidCube(1.0f);
-	glPopMatrix();
-}
-
-void DrawBoundaryWallFixed(float x, float y, float z, float width, float height, float depth, float colorPhaseLocal) {
-	glPushMatrix();
-	float r = 0.4f + 0.2f * sinf(colorPhaseLocal + x + z);
-	float g = 0.2f + 0.15f * cosf(colorPhaseLocal * 1.1f + x - z);
-	float b = 0.25f + 0.15f * sinf(colorPhaseLocal * 0.7f - x + z);
-	glColor3f(r, g, b);
-	glTranslatef(x + width / 2.0f, y + height / 2.0f, z + depth / 2.0f);
-	glScalef(width, height, depth);
-	glutSolidCube(1.0f);
-	glPopMatrix();
-}
-
-void DrawCoral(const CoralSegment& c, float timePhase) {
-	if (!c.visible) return;
-	glPushMatrix();
-	glTranslatef(c.x + c.w / 2.0f, c.y + c.h / 2.0f, c.z + c.d / 2.0f);
-	glColor3f(0.9f, 0.35f, 0.5f);
-	glPushMatrix();
-	glScalef(c.w, c.h, c.d);
-	drawUnitCube();
-	glPopMatrix();
-
-	// small tubes (non-colliding decoration)
-	int tubes = 3;
-	for (int i = 0;i < tubes;i++) {
-		glPushMatrix();
-		float dx = (i - 1) * 0.15f;
-		float dz = sinf(timePhase + i) * 0.03f;
-		glTranslatef(dx, c.h / 2.0f + 0.12f, dz);
-		glRotatef(-90, 1, 0, 0);
-		glScalef(0.18f, 0.18f, 0.4f);
-		drawUnitCylinder();
-		glPopMatrix();
-	}
-	glPopMatrix();
-}
-
-void DrawRock(float x, float y, float z, float s) {
-	glPushMatrix();
-	glColor3f(0.2f, 0.2f, 0.25f);
-	glTranslatef(x, y, z);
-	glScalef(s, s * 0.6f, s);
-	drawUnitSphere();
-	glPopMatrix();
-}
-
-void DrawSeaweed(float x, float y, float z, float height, float tphase) {
-	glPushMatrix();
-	glTranslatef(x, y, z);
-	glRotatef(sinf(tphase + x + z) * 20.0f, 0, 1, 0);
-	glColor3f(0.05f, 0.6f, 0.2f);
-	glBegin(GL_TRIANGLES);
-	glVertex3f(0, 0, 0);
-	glVertex3f(-0.08f, height / 2.0f, 0);
-	glVertex3f(0.08f, height, 0);
-	glEnd();
-	glPopMatrix();
-}
-
-///////////////
-// Diver
-///////////////
-void DrawDiverModel(float x, float y, float z, float angleY, float scale = 0.22f) {
-	glPushMatrix();
-	glTranslatef(x, y, z);
-	// apply yaw (y-axis) then pitch (x-axis) so airborne tilt keeps facing direction
-	glRotatef(angleY, 0, 1, 0);
-	glRotatef(playerPitch, 1, 0, 0);
-	glScalef(scale, scale, scale);
-
-	// Torso
-	glPushMatrix();
-	glColor3f(0.15f, 0.45f, 0.7f);
-	glTranslatef(0.0f, 0.6f, 0.0f);
-	glScalef(0.6f, 0.9f, 0.35f);
-	drawUnitCube();
-	glPopMatrix();
-
-	// Head
-	glPushMatrix();
-	glColor3f(0.95f, 0.85f, 0.75f);
-	glTranslatef(0.0f, 1.15f, 0.0f);
-	glScalef(0.45f, 0.45f, 0.45f);
-	drawUnitSphere();
-	glPopMatrix();
-
-	// Left Arm
-	glPushMatrix();
-	glColor3f(0.15f, 0.45f, 0.7f);
-	glTranslatef(-0.5f, 0.7f, 0);
-	glScalef(0.18f, 0.6f, 0.18f);
-	drawUnitCube();
-	glPopMatrix();
-
-	// Right Arm
-	glPushMatrix();
-	glColor3f(0.15f, 0.45f, 0.7f);
-	glTranslatef(0.5f, 0.7f, 0);
-	glScalef(0.18f, 0.6f, 0.18f);
-	drawUnitCube();
-	glPopMatrix();
-
-	// Left Leg
-	glPushMatrix();
-	glColor3f(0.1f, 0.1f, 0.2f);
-	glTranslatef(-0.18f, 0.1f, 0.0f);
-	glScalef(0.18f, 0.6f, 0.18f);
-	drawUnitCube();
-	glPopMatrix();
-
-	// Right Leg
-	glPushMatrix();
-	glColor3f(0.1f, 0.1f, 0.2f);
-	glTranslatef(0.18f, 0.1f, 0.0f);
-	glScalef(0.18f, 0.6f, 0.18f);
-	drawUnitCube();
-	glPopMatrix();
-
-	// Oxygen tank
-	glPushMatrix();
-	glColor3f(0.02f, 0.45f, 0.25f);
-	glTranslatef(0.0f, 0.6f, -0.35f);
-	glRotatef(-90, 1, 0, 0);
-	glScalef(0.35f, 0.35f, 0.8f);
-	drawUnitCylinder();
-	glPopMatrix();
-	glPopMatrix();
-}
-
-///////////////
-// Goal portal (visible & always non-blocking)
-///////////////
-void DrawGoalPortal(const GoalObj& g, float tphase) {
-	if (!g.visible) return;
-	glPushMatrix();
-	glTranslatef(g.x, g.y + 0.18f * sinf(tphase * 2.0f), g.z);
-	glRotatef(tphase * 40.0f, 0, 1, 0);
-
-	glPushMatrix();
-	glColor3f(0.9f, 0.5f, 0.05f);
-	glutSolidTorus(0.03f, 0.20f, 16, 30);
-	glPopMatrix();
-
-	glPushMatrix();
-	glColor3f(1.0f, 0.8f, 0.1f);
-	glScalef(0.24f, 0.24f, 0.24f);
-	drawUnitSphere();
-	glPopMatrix();
-
-	glPushMatrix();
-	glColor3f(0.95f, 0.7f, 0.15f);
-	glTranslatef(0, -0.55f, 0);
-	glRotatef(-90, 1, 0, 0);
-	glScalef(0.05f, 0.05f, 1.0f);
-	drawUnitCylinder();
-	glPopMatrix();
-
-	glPopMatrix();
-}
-
-///////////////
-// Major object (>=5 primitives)
-///////////////
-void DrawMajorObj(const SceneObj& o) {
-	if (!o.visible) return;
-	glPushMatrix();
-	glTranslatef(o.x, o.y, o.z);
-	glRotatef(o.animPhase * 60.0f, 0, 1, 0);
-
-	// base 
-	glPushMatrix();
-	glColor3f(0.6f, 0.6f, 0.6f);
-	glTranslatef(0, 0.10f, 0);
-	glScalef(0.7f, 0.20f, 0.7f);
-	drawUnitCube();
-	glPopMatrix();
-
-	// mast 
-	glPushMatrix();
-	glColor3f(0.45f, 0.45f, 0.5f);
-	glTranslatef(0, 0.24f, 0);
-	glRotatef(-90, 1, 0, 0);
-	glScalef(0.12f, 0.12f, 0.9f);
-	drawUnitCylinder();
-	glPopMatrix();
-
-	// arms 
-	glPushMatrix();
-	glColor3f(0.8f, 0.4f, 0.2f);
-	glTranslatef(0.20f, 0.72f, 0);
-	glRotatef(20, 0, 0, 1);
-	glScalef(0.40f, 0.09f, 0.09f);
-	drawUnitCube();
-	glPopMatrix();
-
-	glPushMatrix();
-	glColor3f(0.7f, 0.35f, 0.2f);
-	glTranslatef(0.40f, 0.82f, 0);
-	glRotatef(10, 0, 0, 1);
-	glScalef(0.28f, 0.08f, 0.08f);
-	drawUnitCube();
-	glPopMatrix();
-
-	// hook
-	glPushMatrix();
-	glColor3f(0.95f, 0.9f, 0.3f);
-	glTranslatef(0.48f, 0.90f, 0);
-	glScalef(0.08f, 0.08f, 0.08f);
-	drawUnitSphere();
-	glPopMatrix();
-
-	glPopMatrix();
-}
-
-///////////////
-// Regular object (>=3 primitives)
-///////////////
-void DrawRegularObj(const SceneObj& o, float t) {
-	if (!o.visible) return;
-	glPushMatrix();
-	glTranslatef(o.x, o.y, o.z);
-	glRotatef(o.animPhase * 90.0f, 0, 1, 0);
+// Fixed-step loop (see updateScene)
+float simHz = 60.0f; // simulation ticks per second (--sim-hz)
+float renderCapHz = 60.0f; // max redraws per second, 0 = redraw every loop (--fps-cap)
+float simAccumulator = 0.0f; // wall time not yet simulated
+std::chrono::steady_clock::time_point nextRedrawTime;
 
-	// rock base 
-	glPushMatrix();
-	glColor3f(0.25f, 0.25f, 0.28f);
-	glTranslatef(0, 0, 0);
-	glScalef(0.5f, 0.28f, 0.5f);
-	drawUnitSphere();
-	glPopMatrix();
+// Profiler overlay ('p' toggles recording + overlay, 't' writes the Chrome trace)
+bool showProfiler = false;
+const int profilerOverlayFrames = 30; // frames averaged in the overlay
+const char* traceFile = "coral_trace.json";
 
-	// seaweed1
-	glPushMatrix();
-	DrawSeaweed(0.12f, 0.0f, 0.0f, 0.9f, t + o.x);
-	glPopMatrix();
+long long frameHeapAllocations = 0; // operator new calls over the last frame (C stats line)
 
-	// seaweed2
-	glPushMatrix();
-	DrawSeaweed(-0.12f, 0.0f, 0.0f, 0.7f, t - o.x);
-	glPopMatrix();
-
-	glPopMatrix();
-}
+// Input log (--record file writes every key event at exit, --replay file plays one back;
+// while replaying, live keys only drive the camera)
+const char* recordFile = nullptr;
+bool replaying = false;
+InputLog replayLog;
+size_t replayNext = 0; // next replayLog event to apply
 
 ///////////////
-// Build a tidy maze layout with no overlaps and clear collectible spots
+// Fixed-step clock
 ///////////////
-void buildMazeLayout() {
-	coralSegments.clear();
-
-	auto addBox = [&](float x, float z, float w, float d) {
-		CoralSegment s;
-		s.x = x; s.z = z; s.y = 0.0f;
-		s.w = w; s.d = d; s.h = 0.9f;
-		s.visible = true;
-		coralSegments.push_back(s);
-		};
-
-	// Layout chosen to create a few corridors and visible collectible spots
-	// Coordinates are chosen not to overlap with majors/regObjs or rocks
-
-	// vertical wall left
-	addBox(1.0f, 1.0f, 0.4f, 6.5f); // from z=1 to z=7.5
-	// vertical wall right
-	addBox(8.6f, 2.0f, 0.4f, 6.0f); // from z=2 to z=8
-	// horizontal middle bar
-	addBox(2.0f, 4.0f, 4.8f, 0.4f); // from x=2 to x=6.8 at z=4
-	// small divider near start
-	addBox(4.2f, 1.4f, 0.4f, 1.8f);
-	// another small divider near end
-	addBox(6.0f, 6.0f, 0.4f, 1.8f);
-
-	// pillars (clear, not overlapping)
-	addBox(3.0f, 7.6f, 0.6f, 0.6f);
-	addBox(5.6f, 7.6f, 0.6f, 0.6f);
-}
-
-///////////////
-// Initialize objects tidily (no overlaps)
-///////////////
-void initSceneObjects() {
-	srand((unsigned)time(NULL));
-	buildMazeLayout();
-
-	// majors (large, blocking).
-	majorObjs[0].x = 2.0f; majorObjs[0].y = 0.0f; majorObjs[0].z = 1.8f;
-	majorObjs[0].visible = true; majorObjs[0].animPhase = 0; majorObjs[0].animating = true;
-
-	majorObjs[1].x = 7.2f; majorObjs[1].y = 0.0f; majorObjs[1].z = 6.8f;
-	majorObjs[1].visible = true; majorObjs[1].animPhase = 0; majorObjs[1].animating = true;
-
-	// regular (minor) objects (seaweed/rock clusters).
-	regObjs[0].x = 3.4f; regObjs[0].y = 0.0f; regObjs[0].z = 3.2f; regObjs[0].visible = true; regObjs[0].animating = true;
-	regObjs[1].x = 6.4f; regObjs[1].y = 0.0f; regObjs[1].z = 2.2f; regObjs[1].visible = true; regObjs[1].animating = true;
-	regObjs[2].x = 2.2f; regObjs[2].y = 0.0f; regObjs[2].z = 8.4f; regObjs[2].visible = true; regObjs[2].animating = true;
-
-	// goals (collectibles)
-	goals.clear();
-	// visible near corridor junction
-	GoalObj g1; g1.x = 4.5f; g1.z = 3.7f; g1.y = 0.6f; g1.visible = true; g1.phase = 0.5f; goals.push_back(g1);
-	// visible in small alcove (raised to require floating)
-	GoalObj g2; g2.x = 7.8f; g2.z = 7.8f; g2.y = 1.6f; g2.visible = true; g2.phase = 1.5f; goals.push_back(g2);
-	// visible near pillar cluster (easy to spot)
-	GoalObj g3; g3.x = 1.5f; g3.z = 9.0f; g3.y = 0.65f; g3.visible = true; g3.phase = 2.5f; goals.push_back(g3);
-	colorPhase = 0.0f;
-}
-
-///////////////
-// AABB factories (player, coral, major, regular, goal)
-///////////////
-AABB getPlayerAABB() {
-	// tighter player box so player can touch walls/objects closely
-	const float halfx = 0.14f;
-	const float halfy = 0.48f;
-	const float halfz = 0.14f;
-	return AABB{ playerX - halfx, playerY - halfy, playerZ - halfz,
-	playerX + halfx, playerY + halfy, playerZ + halfz };
-}
-AABB getGoalAABB(const GoalObj& g) {
-
-	float r = 0.20f;
-	return AABB{ g.x - r, g.y - r, g.z - r, g.x + r, g.y + r, g.z + r };
-}
-AABB getCoralAABB(const CoralSegment& c) {
-	return AABB{ c.x, c.y, c.z, c.x + c.w, c.y + c.h, c.z + c.d };
-}
-AABB getMajorAABB(const SceneObj& o) {
-	const float extent = 0.50f;
-	const float height = 1.10f;
-	return AABB{ o.x - extent, o.y, o.z - extent, o.x + extent, o.y + height, o.z + extent };
-}
-AABB getRegAABB(const SceneObj& o) {
-	// regular objects (rock + seaweed) extents match drawing
-	return AABB{ o.x - 0.60f, o.y, o.z - 0.60f, o.x + 0.60f, o.y + 0.90f, o.z + 0.60f };
-}
-
-///////////////
-// Camera functions (kept; added top/side view)
-///////////////
-void SetCameraBehindPlayer()
-{
-	float distance = 3.0f;
-	float height = 1.5f;
-
-	float rad = DEG2RAD(playerAngleY);
-	camera.eye.x = playerX + sin(rad) * distance;
-	camera.eye.z = playerZ + cos(rad) * distance;
-	camera.eye.y = height;
-
-	camera.center.x = playerX;
-	camera.center.y = playerY + 0.8f;
-	camera.center.z = playerZ;
-
-
-	camera.up = Vector3f(0, 1, 0);
-}
-
-void SetCameraTopView() {
-	camera.eye = Vector3f(arenaSize / 2.0f, 20.0f, arenaSize / 2.0f);
-	camera.center = Vector3f(arenaSize / 2.0f, 0.0f, arenaSize / 2.0f);
-	camera.up = Vector3f(0.0f, 0.0f, -1.0f);
-}
-
-void SetCameraSideView() {
-	camera.eye = Vector3f(-8.0f, 3.0f, arenaSize / 2.0f);
-	camera.center = Vector3f(arenaSize / 2.0f, 0.8f, arenaSize / 2.0f);
-	camera.up = Vector3f(0.0f, 1.0f, 0.0f);
-}
-
-void SetCameraFrontView() {
-	camera.eye = Vector3f(arenaSize / 2.0f, 6.0f, arenaSize + 12.0f);
-	camera.center = Vector3f(playerX, playerY + 0.8f, playerZ);
-	camera.up = Vector3f(0.0f, 1.0f, 0.0f);
-}
-
-void SetCameraFreeView() {
-	// leave camera where it is but allow free controls (WASD/QE, arrows)
-	// if starting from a fixed view, move camera to a reasonable default behind the map center
-	camera.eye = Vector3f(arenaSize / 2.0f, 3.0f, arenaSize + 2.0f);
-	camera.center = Vector3f(arenaSize / 2.0f, 0.8f, arenaSize / 2.0f);
-	camera.up = Vector3f(0.0f, 1.0f, 0.0f);
+// restart the fixed-step clock (startup, restart) so no stale time is simulated; the new
+// round's first snapshot is drawn right away
+void resetSimClock() {
+	lastTime = std::chrono::steady_clock::now();
+	nextRedrawTime = lastTime;
+	simAccumulator = 0.0f;
+	renderAlpha = 1.0f;
+	publishSnapshot(true);
+	acquireSnapshot();
 }
 
 ///////////////
 // Input handlers - preserved player & camera keys
 ///////////////
 void Keyboard(unsigned char key, int x, int y) {
+	recordInputEvent(INPUT_EVENT_KEY_DOWN, key);
 	if (gameOver) {
-		if (key == 'r' || key == 'R') {
+		if (!replaying && (key == 'r' || key == 'R')) {
 			// restart
-			gameOver = false;
-			gameWin = false;
-			collectedGoals = 0;
-			playerX = 5.0f; playerZ = 5.0f; playerY = 0.05 / 2 + 0.1f; playerAngleY = 0.0f; playerPitch = 0.0f;
-			gameTime = 90.0f;
-			lastTime = std::chrono::steady_clock::now();
-			initSceneObjects();
+			resetGame();
+			resetSimClock();
 			glutPostRedisplay();
 		}
 		return;
 	}
 
 	float d = 0.1f; // camera movement
-	float pSpeed = playerSpeed; // player movement speed
-
-	// Save previous for safe revert on collision
-	prevPlayerX = playerX;
-	prevPlayerZ = playerZ;
-	prevPlayerY = playerY;
 
 	switch (key) {
 		// camera moves (kept)
@@ -643,30 +84,14 @@ void Keyboard(unsigned char key, int x, int y) {
 	case 'q': camera.moveZ(d); break;
 	case 'e': camera.moveZ(-d); break;
 
-		// player movement (kept EXACT keys: I/J/K/L)
-	case 'i': playerZ -= pSpeed; playerAngleY = 0.0f; break; // forward (decreasing Z)
-	case 'k': playerZ += pSpeed; playerAngleY = 180.0f; break; // backward
-	case 'j': playerX -= pSpeed; playerAngleY = 90.0f; break; // left
-	case 'l': playerX += pSpeed; playerAngleY = -90.0f; break; // right
-
-		// vertical movement: u = up, o = down
-	case 'u': playerY += pSpeed; break;
-	case 'o': playerY -= pSpeed; break;
-
-		// animation toggles: M/N control majors anim start/stop
-	case 'm':
-		for (auto& mo : majorObjs) mo.animating = true;
+	case 'c': showCullStats = !showCullStats; break;
+	case 'h': snapshotNavHint = !snapshotNavHint; break; // path to the nearest goal (from the next tick)
+	case 'p':
+		showProfiler = !showProfiler;
+		profilerEnabled = showProfiler;
 		break;
-	case 'n':
-		for (auto& mo : majorObjs) mo.animating = false;
-		break;
-
-		// animation toggles: ,/. control regulars anim start/stop
-	case 'v':
-		for (auto& r : regObjs) r.animating = true;
-		break;
-	case 'b':
-		for (auto& r : regObjs) r.animating = false;
+	case 't':
+		if (profilerWriteChromeTrace(traceFile)) printf("trace written to %s\n", traceFile);
 		break;
 
 		// camera view switching keys (remapped:1=back fixed,2=top,3=side,4=free)
@@ -676,25 +101,22 @@ void Keyboard(unsigned char key, int x, int y) {
 	case '4': cameraViewMode = 4; SetCameraFreeView(); break; // free movement view
 
 	case27: exit(EXIT_SUCCESS);
-	default: break;
+		// player movement (I/J/K/L, U/O: held state) and animation toggles (M/N, V/B)
+	default:
+		if (!replaying && !setInputKey(key, true)) applyPlayerKey(key);
+		break;
 	}
+	// no redisplay here: the idle loop redraws at the render cap
+}
 
-	// clamp player to arena bounds based on player half-extents so touching walls is possible but not passing through
-	const float phalfx = 0.14f;
-	const float phalfz = 0.14f;
-	if (playerX - phalfx < wallTh) playerX = wallTh + phalfx;
-	if (playerX + phalfx > arenaSize - wallTh) playerX = arenaSize - wallTh - phalfx;
-	if (playerZ - phalfz < wallTh) playerZ = wallTh + phalfz;
-	if (playerZ + phalfz > arenaSize - wallTh) playerZ = arenaSize - wallTh - phalfz;
-
-	// clamp player Y to allowed range
-	if (playerY < groundY) playerY = groundY;
-	if (playerY > maxPlayerY) playerY = maxPlayerY;
-
-	glutPostRedisplay();
+// key releases only matter for the held movement keys (also while the round is over)
+void KeyboardUp(unsigned char key, int x, int y) {
+	recordInputEvent(INPUT_EVENT_KEY_UP, key);
+	if (!replaying) setInputKey(key, false);
 }
 
 void Special(int key, int x, int y) {
+	recordInputEvent(INPUT_EVENT_SPECIAL, (unsigned char)key);
 	float a = 2.0f;
 	switch (key) {
 	case GLUT_KEY_UP: camera.rotateX(a); break;
@@ -702,125 +124,266 @@ void Special(int key, int x, int y) {
 	case GLUT_KEY_LEFT: camera.rotateY(a); break;
 	case GLUT_KEY_RIGHT: camera.rotateY(-a); break;
 	}
-	glutPostRedisplay();
+	if (gameOver) glutPostRedisplay(); // the idle loop stops redrawing once the round is over
 }
 
 ///////////////
-// Update loop (animations, collisions, timer)
-// - Collision: revert to prev pos on colliding with visible majors/corals/major rocks
-// - Minor objects do NOT block
+// Idle driver: fixed-step accumulator, capped redraws, sleeps while nothing is due
 ///////////////
 void updateScene() {
-	if (gameOver) return;
-
+	PROFILE_ZONE("updateScene");
 	auto now = std::chrono::steady_clock::now();
 	std::chrono::duration<float> elapsed = now - lastTime;
-	float dt = elapsed.count();
-	if (dt <= 0) return;
 	lastTime = now;
 
-	// update timer
-	gameTime -= dt;
-	if (gameTime <= 0.0f) {
-		gameOver = true;
-		gameWin = (collectedGoals >= totalGoals);
-		glutPostRedisplay();
+	// a replay restarts the round itself when the log has an R after game over
+	if (replaying && gameOver && replayEventsUntil(replayLog, replayNext, sessionTick) > 0 && !gameOver)
+		resetSimClock();
+
+	if (gameOver) {
+		// nothing to simulate until a restart; don't spin the CPU
+		simAccumulator = 0.0f;
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
 		return;
 	}
 
-	colorPhase += dt * 1.0f;
+	// streamed world: the chunks the current camera mode shows are loaded too
+	if (worldStreamActive()) setStreamFocusFromCamera();
+
+	// clamp long stalls (window drag, debugger) instead of fast-forwarding through them
+	const float step = 1.0f / simHz;
+	simAccumulator += std::min(elapsed.count(), 0.25f);
+	while (simAccumulator >= step && !gameOver) {
+		if (replaying) {
+			// same order as the recording: the events that arrived before this step, then the step
+			replayEventsUntil(replayLog, replayNext, sessionTick);
+			if (sessionTick >= replayLog.endTick) {
+				simAccumulator = 0.0f; // end of the log: hold the last state
+				break;
+			}
+		}
+		PROFILE_ZONE("simulateStep");
+		simulateStep(step);
+		publishSnapshot();
+		simAccumulator -= step;
+	}
+	renderAlpha = gameOver ? 1.0f : simAccumulator / step;
 
-	// animate majors if enabled (animation property unaffected by show/hide)
-	for (auto& m : majorObjs) {
-		if (m.animating) m.animPhase += dt;
+	if (renderCapHz <= 0.0f) {
+		glutPostRedisplay();
+		return;
 	}
-	for (auto& r : regObjs) {
-		if (r.animating) r.animPhase += dt * 1.2f;
+
+	auto redrawPeriod = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<float>(1.0f / renderCapHz));
+	if (gameOver || now >= nextRedrawTime) {
+		glutPostRedisplay();
+		nextRedrawTime += redrawPeriod;
+		if (nextRedrawTime < now) nextRedrawTime = now + redrawPeriod;
 	}
-	for (auto& g : goals) g.phase += dt * 1.5f;
 
-	// airborne detection and pitch (positive tilts head forward around x-axis)
-	bool airborne = (playerY > groundY + 0.01f);
-	playerPitch = airborne ? 20.0f : 0.0f;
+	// sleep until the next tick or redraw is due
+	auto nextTick = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<float>(step - simAccumulator));
+	PROFILE_ZONE("sleep");
+	std::this_thread::sleep_until(std::min(nextTick, nextRedrawTime));
+}
 
-	// save current pos in case we need revert due to collision
-	AABB pbox = getPlayerAABB();
+///////////////
+// HUD text
+// Both HUD fonts (GLUT's Helvetica 12 and 18) are rasterised once, glyph by glyph through
+// glutBitmapCharacter + glReadPixels, into one alpha texture atlas. renderHUD lists its lines
+// with hudPrint (the text copied into the frame arena); the textured quad array is rebuilt
+// only when a line or the window size changed since the last frame (the timer ticks once a
+// second), so the HUD is otherwise one cached draw call.
+///////////////
+enum HudFontId { HUD_FONT_12, HUD_FONT_18, HUD_FONT_COUNT };
+const int hudFirstChar = 32, hudCharCount = 95; // printable ASCII
 
-	// Check collisions with visible coral segments
-	bool collided = false;
-	for (const auto& c : coralSegments) {
-		if (!c.visible) continue;
-		AABB cab = getCoralAABB(c);
-		if (aabbIntersects(pbox, cab)) { collided = true; }
-	}
+struct HudGlyph {
+	int x0, y0, x1, y1; // set pixels within the cell (empty when x0 == x1)
+	float u0, v0, u1, v1; // the same box in the atlas
+	int advance;
+};
 
-	// majors
-	if (!collided) {
-		for (const auto& m : majorObjs) {
-			if (!m.visible) continue;
-			if (aabbIntersects(pbox, getMajorAABB(m))) { collided = true; break; }
-		}
+struct HudFont {
+	void* glut;
+	int cellH, descent; // cell height in pixels, baseline above the cell bottom
+	int cellW; // widest glyph + 1 pixel either side
+	HudGlyph glyphs[hudCharCount];
+};
+
+HudFont hudFonts[HUD_FONT_COUNT] = {
+	{ GLUT_BITMAP_HELVETICA_12, 16, 4, 0, {} },
+	{ GLUT_BITMAP_HELVETICA_18, 24, 6, 0, {} },
+};
+GLuint hudAtlas = 0;
+
+struct HudLine {
+	HudFontId font;
+	int x, y; // baseline start
+	const char* text; // in the frame arena
+	bool operator==(const HudLine& o) const { return font == o.font && x == o.x && y == o.y && strcmp(text, o.text) == 0; }
+};
+
+// this frame / the last one, which hudQuads shows (the arena keeps its texts for a frame)
+std::vector<HudLine> hudLines, hudLastLines;
+std::vector<float> hudQuads; // s,t, x,y,z per corner (GL_T2F_V3F quads)
+int hudBuiltW = -1, hudBuiltH = -1;
+
+// window size, kept by Reshape instead of asking GLUT every frame
+int windowWidth = 640, windowHeight = 480;
+
+static int nextPow2(int v) {
+	int p = 1;
+	while (p < v) p *= 2;
+	return p;
+}
+
+// draws every glyph into the corner of the back buffer and reads it back (first frame,
+// before the scene clears the buffer)
+void buildHudAtlas() {
+	int cols = 16, rows = (hudCharCount + cols - 1) / cols;
+	int atlasW = 0, atlasH = 0;
+	for (auto& f : hudFonts) {
+		int widest = 0;
+		for (int c = 0;c < hudCharCount;c++) widest = std::max(widest, glutBitmapWidth(f.glut, hudFirstChar + c));
+		f.cellW = widest + 2;
+		atlasW = std::max(atlasW, cols * f.cellW);
+		atlasH += rows * f.cellH;
 	}
+	atlasW = nextPow2(atlasW);
+	atlasH = nextPow2(atlasH);
+	std::vector<unsigned char> atlas((size_t)atlasW * atlasH, 0);
 
-	// large rocks (we'll test a couple of major rock positions)
-	if (!collided) {
-		{
-			float rx = 1.0f, ry = 0.08f, rz = 1.2f, s = 0.35f;
-			float xr = 0.5f * s;
-			float yr = 0.5f * s * 0.6f;
-			AABB rock1 = AABB{ rx - xr, ry - yr, rz - xr, rx + xr, ry + yr, rz + xr };
-			if (aabbIntersects(pbox, rock1)) collided = true;
-		}
-		if (!collided) {
-			float rx = 8.2f, ry = 0.08f, rz = 1.6f, s = 0.45f;
-			float xr = 0.5f * s;
-			float yr = 0.5f * s * 0.6f;
-			AABB rock2 = AABB{ rx - xr, ry - yr, rz - xr, rx + xr, ry + yr, rz + xr };
-			if (aabbIntersects(pbox, rock2)) collided = true;
-		}
-		if (!collided) {
-			float rx = 4.0f, ry = 0.08f, rz = 8.2f, s = 0.30f;
-			float xr = 0.5f * s;
-			float yr = 0.5f * s * 0.6f;
-			AABB rock3 = AABB{ rx - xr, ry - yr, rz - xr, rx + xr, ry + yr, rz + xr };
-			if (aabbIntersects(pbox, rock3)) collided = true;
+	glViewport(0, 0, windowWidth, windowHeight);
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	gluOrtho2D(0, windowWidth, 0, windowHeight);
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+	glDisable(GL_LIGHTING);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_SCISSOR_TEST);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glColor3f(1.0f, 1.0f, 1.0f);
+
+	std::vector<unsigned char> cell;
+	int rowBase = 0;
+	for (auto& f : hudFonts) {
+		cell.resize((size_t)f.cellW * f.cellH);
+		glScissor(0, 0, f.cellW, f.cellH);
+		for (int c = 0;c < hudCharCount;c++) {
+			glClear(GL_COLOR_BUFFER_BIT);
+			glRasterPos2i(1, f.descent);
+			glutBitmapCharacter(f.glut, hudFirstChar + c);
+			glReadPixels(0, 0, f.cellW, f.cellH, GL_RED, GL_UNSIGNED_BYTE, cell.data());
+
+			int ax = (c % cols) * f.cellW, ay = rowBase + (c / cols) * f.cellH;
+			HudGlyph& g = f.glyphs[c];
+			g.x0 = f.cellW; g.y0 = f.cellH; g.x1 = 0; g.y1 = 0;
+			for (int y = 0;y < f.cellH;y++) {
+				for (int x = 0;x < f.cellW;x++) {
+					unsigned char v = cell[(size_t)y * f.cellW + x];
+					atlas[(size_t)(ay + y) * atlasW + ax + x] = v;
+					if (v == 0) continue;
+					g.x0 = std::min(g.x0, x); g.x1 = std::max(g.x1, x + 1);
+					g.y0 = std::min(g.y0, y); g.y1 = std::max(g.y1, y + 1);
+				}
+			}
+			if (g.x1 <= g.x0) g.x0 = g.x1 = g.y0 = g.y1 = 0;
+			g.u0 = (float)(ax + g.x0) / atlasW; g.u1 = (float)(ax + g.x1) / atlasW;
+			g.v0 = (float)(ay + g.y0) / atlasH; g.v1 = (float)(ay + g.y1) / atlasH;
+			g.advance = glutBitmapWidth(f.glut, hudFirstChar + c);
 		}
+		rowBase += rows * f.cellH;
 	}
+	glDisable(GL_SCISSOR_TEST);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_LIGHTING);
 
-	// If collided with visible major or coral, revert to previous position (safe)
-	if (collided) {
-		playerX = prevPlayerX;
-		playerZ = prevPlayerZ;
-		playerY = prevPlayerY;
-		pbox = getPlayerAABB();
-	}
+	if (hudAtlas == 0) glGenTextures(1, &hudAtlas);
+	glBindTexture(GL_TEXTURE_2D, hudAtlas);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, atlasW, atlasH, 0, GL_ALPHA, GL_UNSIGNED_BYTE, atlas.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
 
-	// Check goals (collect) - goals are always visible or hidden but do not block
-	for (auto& g : goals) {
-		if (!g.visible) continue;
-		if (aabbIntersects(pbox, getGoalAABB(g))) {
-			g.visible = false;
-			collectedGoals++;
-			if (collectedGoals >= totalGoals) {
-				gameOver = true;
-				gameWin = true;
+void hudPrint(HudFontId font, int x, int y, const char* text) {
+	hudLines.push_back(HudLine{ font, x, y, frameArena.format("%s", text) });
+}
+
+// one textured quad per visible glyph, over its set pixels only and pixel-aligned so
+// GL_NEAREST copies the atlas exactly
+static void buildHudQuads() {
+	PROFILE_ZONE("buildHudQuads");
+	hudQuads.clear();
+	for (const auto& line : hudLines) {
+		const HudFont& f = hudFonts[line.font];
+		int x = line.x - 1, y = line.y - f.descent; // cell origin
+		for (const char* c = line.text;*c;c++) {
+			unsigned char ch = *c;
+			if (ch < hudFirstChar || ch >= hudFirstChar + hudCharCount) continue;
+			const HudGlyph& g = f.glyphs[ch - hudFirstChar];
+			if (g.x1 > g.x0) {
+				float x0 = (float)(x + g.x0), x1 = (float)(x + g.x1);
+				float y0 = (float)(y + g.y0), y1 = (float)(y + g.y1);
+				const float quad[20] = {
+					g.u0, g.v0, x0, y0, 0.0f,
+					g.u1, g.v0, x1, y0, 0.0f,
+					g.u1, g.v1, x1, y1, 0.0f,
+					g.u0, g.v1, x0, y1, 0.0f,
+				};
+				hudQuads.insert(hudQuads.end(), quad, quad + 20);
 			}
+			x += g.advance;
 		}
 	}
+	hudBuiltW = windowWidth;
+	hudBuiltH = windowHeight;
+}
 
-	glutPostRedisplay();
+// draws this frame's hudPrint lines (ortho projection set by the caller)
+void flushHudText() {
+	if (hudLines != hudLastLines || windowWidth != hudBuiltW || windowHeight != hudBuiltH) buildHudQuads();
+	hudLastLines.swap(hudLines);
+	hudLines.clear();
+	if (hudQuads.empty()) return;
+
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_TEXTURE_2D);
+	glEnable(GL_ALPHA_TEST); // bitmap glyph pixels are on or off, no blending needed
+	glAlphaFunc(GL_GREATER, 0.5f);
+	glBindTexture(GL_TEXTURE_2D, hudAtlas);
+	glColor3f(1.0f, 1.0f, 1.0f);
+	glInterleavedArrays(GL_T2F_V3F, 0, hudQuads.data());
+	glDrawArrays(GL_QUADS, 0, (GLsizei)(hudQuads.size() / 5));
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDisable(GL_ALPHA_TEST);
+	glDisable(GL_TEXTURE_2D);
+	glEnable(GL_DEPTH_TEST);
 }
 
 ///////////////
 // HUD & display
 ///////////////
-void renderHUD() {
+// levels can have any number of majors/regulars (or none)
+static bool anyAnimating(const std::vector<SceneObj>& objs) {
+	return std::any_of(objs.begin(), objs.end(), [](const SceneObj& o) { return o.animating; });
+}
+
+void renderHUD(const SimSnapshot& snap) {
+	PROFILE_ZONE("renderHUD");
 	glMatrixMode(GL_PROJECTION);
 	glPushMatrix();
 	glLoadIdentity();
 
-	int w = glutGet(GLUT_WINDOW_WIDTH);
-	int h = glutGet(GLUT_WINDOW_HEIGHT);
+	int w = windowWidth;
+	int h = windowHeight;
 
 	gluOrtho2D(0, w, 0, h);
 
@@ -833,38 +396,67 @@ void renderHUD() {
 	char buf[256];
 	sprintf(buf,
 		"Time: %.0f Collected: %d/%d View:%d MajAnim:%s RegAnim:%s",
-		gameTime, collectedGoals, totalGoals, cameraViewMode,
-		(majorObjs[0].animating || majorObjs[1].animating) ? "ON" : "OFF",
-		(regObjs[0].animating || regObjs[1].animating || regObjs[2].animating) ? "ON" : "OFF"
+		snap.gameTime, snap.collectedGoals, snap.totalGoals, cameraViewMode,
+		anyAnimating(snap.curr.majors) ? "ON" : "OFF",
+		anyAnimating(snap.curr.regs) ? "ON" : "OFF"
 	);
-
-	glColor3f(1.0f, 1.0f, 1.0f);
-	glRasterPos2i(10, h - 20);
-
-	for (char* p = buf; *p; ++p)
-		glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *p);
+	hudPrint(HUD_FONT_12, 10, h - 20, buf);
 
 	// Controls (only the important keys requested)
-	auto printLine = [&](int y, const char* text) {
-		glRasterPos2i(10, y);
-		for (const char* c = text; *c; ++c)
-			glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
-		};
+	hudPrint(HUD_FONT_12, 10, h - 40, "Player: I/J/K/L move | U=up O=down (float)");
+	hudPrint(HUD_FONT_12, 10, h - 55, "Camera:1=behind  2=top  3=side | H=path hint");
+	hudPrint(HUD_FONT_12, 10, h - 70, "Animations: M=start majors N=stop majors | v=start regulars b=stop regulars");
+
+	// the optional lines stack down from below the controls
+	int y = h - 85;
+	if (showCullStats) {
+		char stats[160];
+		sprintf(stats, "Cull: drawn %d culled %d  LOD: %d/%d/%d/%d impostors %d", cullStats.drawn, cullStats.culled,
+			lodObjectCount[LOD_HIGH], lodObjectCount[LOD_MEDIUM], lodObjectCount[LOD_LOW], lodObjectCount[LOD_MINIMAL],
+			lodObjectCount[LOD_IMPOSTOR]);
+		hudPrint(HUD_FONT_12, 10, y, stats);
+		y -= 15;
+
+		// the scene pass's job graph: each worker's busy share of it (the first eight), and
+		// the heap allocations of the last frame
+		int n = sprintf(stats, "Jobs: %d workers, draw lists %.2f ms, busy", (int)sceneJobStats.workers.size(), sceneJobStats.graphMs);
+		for (size_t k = 0;k < sceneJobStats.workers.size() && k < 8;k++)
+			n += sprintf(stats + n, " %.0f%%", sceneJobStats.graphMs > 0.0 ? 100.0 * sceneJobStats.workers[k].busyMs / sceneJobStats.graphMs : 0.0);
+		sprintf(stats + n, "  Heap: %lld allocs/frame", frameHeapAllocations);
+		hudPrint(HUD_FONT_12, 10, y, stats);
+		y -= 15;
+	}
 
-	printLine(h - 40, "Player: I/J/K/L move | U=up O=down (float)");
-	printLine(h - 55, "Camera:1=behind  2=top  3=side");
-	printLine(h - 70, "Animations: M=start majors N=stop majors | v=start regulars b=stop regulars");
+	if (replaying) {
+		char line[64];
+		sprintf(line, "Replay: tick %lld / %lld", snap.sessionTick, replayLog.endTick);
+		hudPrint(HUD_FONT_12, 10, y, line);
+		y -= 15;
+	}
 
-	if (gameOver) {
-		std::string msg = gameWin ?
+	if (showProfiler) {
+		// per-zone average over the last frames, indented by nesting depth
+		static std::vector<ProfileStat> profileStats;
+		profilerCollectStats(profileStats, profilerOverlayFrames);
+		hudPrint(HUD_FONT_12, 10, y, "Profile (ms/frame avg, max) - T=save trace");
+		for (const auto& s : profileStats) {
+			y -= 14;
+			if (y < 10) break;
+			char line[128];
+			sprintf(line, "%*s%s  %.3f  %.3f", s.depth * 3, "", s.name, s.avgMs, s.maxMs);
+			hudPrint(HUD_FONT_12, 10, y, line);
+		}
+	}
+
+	if (snap.gameOver) {
+		const char* msg = snap.gameWin ?
 			"GAME WIN - Press R to restart" :
 			"GAME LOSE - Press R to restart";
-
-		glRasterPos2i(w / 2 - 120, h / 2);
-		for (char c : msg)
-			glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, c);
+		hudPrint(HUD_FONT_18, w / 2 - 120, h / 2, msg);
 	}
 
+	flushHudText();
+
 	glEnable(GL_LIGHTING);
 	glPopMatrix();
 
@@ -874,93 +466,152 @@ void renderHUD() {
 	glMatrixMode(GL_MODELVIEW);
 }
 
+void Reshape(int w, int h) {
+	windowWidth = w;
+	windowHeight = std::max(h, 1);
+	glViewport(0, 0, windowWidth, windowHeight);
+	viewAspect = (float)windowWidth / windowHeight;
+}
 
-void Display(void) {
-	setupCameraProjection();
-	setupLights();
 
-	glClearColor(0.02f, 0.07f, 0.12f, 1.0f); // underwater blue
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+void Display(void) {
+	profilerBeginFrame();
+	frameArena.beginFrame();
+	static long long heapAtFrame = 0; // since the last Display: its ticks, scene and HUD
+	long long heap = heapAllocations();
+	frameHeapAllocations = heap - heapAtFrame;
+	heapAtFrame = heap;
+	PROFILE_ZONE("Display");
+	if (hudAtlas == 0) buildHudAtlas();
+	// the newest tick for the whole frame: scene and HUD read the same snapshot
+	const SimSnapshot& snap = acquireSnapshot();
+	renderScene();
+	renderHUD(snap);
+
+	PROFILE_ZONE("glutSwapBuffers");
+	glFlush();
+	glutSwapBuffers();
+}
 
-	// Draw seabed
-	DrawSeabed(arenaSize, arenaSize);
 
-	// Boundary walls
-	DrawBoundaryWallFixed(0.0f, 0.0f, 0.0f, arenaSize, wallHeight, wallTh, colorPhase);
-	DrawBoundaryWallFixed(0.0f, 0.0f, arenaSize - wallTh, arenaSize, wallHeight, wallTh, colorPhase + 1.0f);
-	DrawBoundaryWallFixed(0.0f, 0.0f, 0.0f, wallTh, wallHeight, arenaSize, colorPhase + 2.0f);
-	DrawBoundaryWallFixed(arenaSize - wallTh, 0.0f, 0.0f, wallTh, wallHeight, arenaSize, colorPhase + 3.0f);
+///////////////
+// Primitive microbenchmark (--bench-primitives [frames])
+// Replays the per-frame primitive mix of the current scene through the old
+// GLUT/GLU immediate path and through the mesh cache, and reports time and
+// quadric allocations per frame.
+///////////////
+int legacyQuadricAllocs = 0;
 
-	// Coral maze
-	for (const auto& c : coralSegments) {
-		if (c.visible)
-			DrawCoral(c, colorPhase);
+static void legacyDrawPrimitive(int id) {
+	switch (id) {
+	case MESH_CUBE: glutSolidCube(1.0); break;
+	case MESH_SPHERE: glutSolidSphere(0.5, 20, 12); break;
+	case MESH_CYLINDER: {
+		GLUquadric* q = gluNewQuadric();
+		legacyQuadricAllocs++;
+		gluCylinder(q, 0.5, 0.5, 1.0, 16, 2);
+		gluDeleteQuadric(q);
+		break;
 	}
-
-	// Major objects
-	for (const auto& m : majorObjs) {
-		if (m.visible)
-			DrawMajorObj(m);
+	case MESH_TORUS: glutSolidTorus(0.03f, 0.20f, 16, 30); break;
 	}
+}
 
-	// Major rocks
-	DrawRock(1.0f, 0.08f, 1.2f, 0.35f);
-	DrawRock(8.2f, 0.08f, 1.6f, 0.45f);
-	DrawRock(4.0f, 0.08f, 8.2f, 0.30f);
-
-	// Regular objects
-	for (const auto& r : regObjs)
-		DrawRegularObj(r, colorPhase);
-
-	// Seaweed
-	DrawSeaweed(2.2f, 0.0f, 3.5f, 0.9f, colorPhase + 0.3f);
-	DrawSeaweed(6.8f, 0.0f, 2.2f, 0.7f, colorPhase - 0.6f);
-	DrawSeaweed(4.5f, 0.0f, 6.0f, 0.8f, colorPhase + 1.2f);
-
-	// Goals
-	for (const auto& g : goals)
-		DrawGoalPortal(g, g.phase);
-
-	// Player
-	DrawDiverModel(playerX, playerY, playerZ, playerAngleY + 180.0f, 0.22f);
-
-	// HUD
-	renderHUD();
+void runPrimitiveBenchmark(int frames) {
+	// measure the dynamic primitive mix of one frame (static lists already compiled)
+	buildStaticGeometry(*frontSnapshot().layout);
+	std::fill(meshDrawCount, meshDrawCount + MESH_COUNT, 0);
+	Display();
+	int mix[MESH_COUNT];
+	std::copy(meshDrawCount, meshDrawCount + MESH_COUNT, mix);
+
+	double wallMs[2], cpuMs[2];
+	int allocs[2];
+	for (int pass = 0;pass < 2;pass++) {
+		legacyQuadricAllocs = 0;
+		std::clock_t c0 = std::clock();
+		auto t0 = std::chrono::steady_clock::now();
+		for (int f = 0;f < frames;f++) {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			for (int id = 0;id < MESH_COUNT;id++) {
+				for (int k = 0;k < mix[id];k++) {
+					if (pass == 0) legacyDrawPrimitive(id);
+					else drawMesh((MeshId)id);
+				}
+			}
+			glFinish();
+		}
+		std::chrono::duration<double, std::milli> wall = std::chrono::steady_clock::now() - t0;
+		wallMs[pass] = wall.count() / frames;
+		cpuMs[pass] = 1000.0 * (std::clock() - c0) / CLOCKS_PER_SEC / frames;
+		allocs[pass] = legacyQuadricAllocs / frames;
+	}
 
-	glFlush();
-	glutSwapBuffers();
+	printf("primitive mix per frame: cubes %d spheres %d cylinders %d tori %d (%d frames)\n",
+		mix[MESH_CUBE], mix[MESH_SPHERE], mix[MESH_CYLINDER], mix[MESH_TORUS], frames);
+	printf("%-8s %12s %12s %16s\n", "path", "wall ms/frm", "cpu ms/frm", "quadric allocs");
+	printf("%-8s %12.3f %12.3f %16d\n", "legacy", wallMs[0], cpuMs[0], allocs[0]);
+	printf("%-8s %12.3f %12.3f %16d\n", "cached", wallMs[1], cpuMs[1], allocs[1]);
 }
 
-
 ///////////////////////
 // main & initialization
 ///////////////////////
 int main(int argc, char** argv) {
 	glutInit(&argc, argv);
 
+	for (int i = 1;i < argc;i++) {
+		if (strcmp(argv[i], "--sim-hz") == 0 && i + 1 < argc) simHz = std::max(1.0f, (float)atof(argv[++i]));
+		else if (strcmp(argv[i], "--fps-cap") == 0 && i + 1 < argc) renderCapHz = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--profile") == 0) showProfiler = profilerEnabled = true;
+		else if (strcmp(argv[i], "--no-lod") == 0) lodEnabled = false;
+		else if (strcmp(argv[i], "--unbatched") == 0) renderQueueBatched = false;
+		else if (strcmp(argv[i], "--trace-file") == 0 && i + 1 < argc) traceFile = argv[++i];
+		else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordFile = argv[++i];
+		else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+			if (!loadInputLog(argv[++i], replayLog)) return 1;
+			replaying = true;
+			simHz = replayLog.simHz; // bit-exact playback needs the recorded step
+		}
+		else parseMazeArg(i, argc, argv); // --maze N, --seed S, --maze-algo, --maze-tile, --maze-threads, --level file, --stream MB
+	}
+
 	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
 	glutInitWindowSize(640, 480);
 	glutInitWindowPosition(50, 50);
 	glutCreateWindow("Assignment2 - Coral Maze Escape (Fixed)");
 
 	glutDisplayFunc(Display);
+	glutReshapeFunc(Reshape);
 	glutKeyboardFunc(Keyboard);
+	glutKeyboardUpFunc(KeyboardUp);
 	glutSpecialFunc(Special);
 	glutIdleFunc(updateScene);
 
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_LIGHTING);
-	glEnable(GL_LIGHT0);
-	glEnable(GL_NORMALIZE);
-	glEnable(GL_COLOR_MATERIAL);
-	glShadeModel(GL_SMOOTH);
+	initRenderState();
 
 	// init scene
-	initSceneObjects();
-	lastTime = std::chrono::steady_clock::now();
+	initPrimitiveMeshes();
+	initPropBatches();
+	if (replaying) beginReplay(replayLog);
+	else {
+		if (recordFile) {
+			beginInputRecording(simHz);
+			atexit([] {
+				if (saveInputRecording(recordFile)) printf("input log written to %s\n", recordFile);
+				});
+		}
+		resetGame();
+	}
+	resetSimClock();
 	SetCameraFrontView();
 	cameraViewMode = 1;
 
+	if (argc > 1 && strcmp(argv[1], "--bench-primitives") == 0) {
+		runPrimitiveBenchmark(argc > 2 ? atoi(argv[2]) : 300);
+		return 0;
+	}
+
 	glutMainLoop();
 	return 0;
 }
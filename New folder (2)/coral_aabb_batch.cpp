@@ -0,0 +1,221 @@
+#include "coral_aabb_batch.h"
+
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CORAL_X86 1
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// MSVC has no per-function target attribute: the AVX2 path needs /arch:AVX2 there
+#if defined(CORAL_X86) && (defined(__GNUC__) || defined(__clang__))
+#define CORAL_AVX2_TARGET __attribute__((target("avx2")))
+#define CORAL_HAS_AVX2_PATH 1
+#elif defined(CORAL_X86) && defined(__AVX2__)
+#define CORAL_AVX2_TARGET
+#define CORAL_HAS_AVX2_PATH 1
+#endif
+
+static int lowestBit(unsigned m) {
+#if defined(_MSC_VER) && !defined(__clang__)
+	unsigned long i;
+	_BitScanForward(&i, m);
+	return (int)i;
+#else
+	return __builtin_ctz(m);
+#endif
+}
+
+///////////////
+// Store
+///////////////
+void AabbSoA::clear() {
+	minx.clear(); miny.clear(); minz.clear();
+	maxx.clear(); maxy.clear(); maxz.clear();
+	visible.clear();
+	count = 0;
+}
+
+void AabbSoA::reserve(int n) {
+	size_t padded = (size_t)(n + aabbBatchWidth - 1) / aabbBatchWidth * aabbBatchWidth;
+	minx.reserve(padded); miny.reserve(padded); minz.reserve(padded);
+	maxx.reserve(padded); maxy.reserve(padded); maxz.reserve(padded);
+	visible.reserve((padded + 63) / 64);
+}
+
+int AabbSoA::push(const AABB& b, bool isVisible) {
+	if (count == (int)minx.size()) {
+		// grow by one padded block of empty boxes (min > max never overlaps)
+		const float inf = std::numeric_limits<float>::infinity();
+		size_t padded = minx.size() + aabbBatchWidth;
+		minx.resize(padded, inf); miny.resize(padded, inf); minz.resize(padded, inf);
+		maxx.resize(padded, -inf); maxy.resize(padded, -inf); maxz.resize(padded, -inf);
+		visible.resize((padded + 63) / 64, 0);
+	}
+	int i = count++;
+	set(i, b);
+	setVisible(i, isVisible);
+	return i;
+}
+
+void AabbSoA::set(int i, const AABB& b) {
+	minx[i] = b.minx; miny[i] = b.miny; minz[i] = b.minz;
+	maxx[i] = b.maxx; maxy[i] = b.maxy; maxz[i] = b.maxz;
+}
+
+AABB AabbSoA::get(int i) const {
+	return AABB{ minx[i], miny[i], minz[i], maxx[i], maxy[i], maxz[i] };
+}
+
+///////////////
+// Kernels
+// All three walk [begin, end) and report the same boxes; the SIMD ones work on aligned
+// blocks of 16 and mask off lanes outside the range or hidden.
+///////////////
+// visible and in-range lanes of the 16-box block starting at b
+static unsigned blockMask(const AabbSoA& s, int b, int begin, int end) {
+	unsigned m = (unsigned)(s.visible[b >> 6] >> (b & 63)) & 0xFFFFu;
+	if (begin > b) m &= ~0u << (begin - b);
+	if (end < b + aabbBatchWidth) m &= (1u << (end - b)) - 1u;
+	return m;
+}
+
+// appends the set lanes of m as box indices; true if the scan may stop (anyOnly)
+static inline bool emitHits(unsigned m, int b, bool anyOnly, int* hits, int& n) {
+	if (!m) return false;
+	if (anyOnly) {
+		n = 1;
+		return true;
+	}
+	while (m) {
+		if (hits) hits[n] = b + lowestBit(m);
+		n++;
+		m &= m - 1;
+	}
+	return false;
+}
+
+static int scanScalar(const AabbSoA& s, const AABB& q, int begin, int end, int* hits, bool anyOnly) {
+	int n = 0;
+	for (int i = begin;i < end;i++) {
+		if (!s.isVisible(i)) continue;
+		if (q.minx <= s.maxx[i] && q.maxx >= s.minx[i] &&
+			q.miny <= s.maxy[i] && q.maxy >= s.miny[i] &&
+			q.minz <= s.maxz[i] && q.maxz >= s.minz[i]) {
+			if (anyOnly) return 1;
+			if (hits) hits[n] = i;
+			n++;
+		}
+	}
+	return n;
+}
+
+#ifdef CORAL_X86
+static int scanSse(const AabbSoA& s, const AABB& q, int begin, int end, int* hits, bool anyOnly) {
+	const __m128 qminx = _mm_set1_ps(q.minx), qminy = _mm_set1_ps(q.miny), qminz = _mm_set1_ps(q.minz);
+	const __m128 qmaxx = _mm_set1_ps(q.maxx), qmaxy = _mm_set1_ps(q.maxy), qmaxz = _mm_set1_ps(q.maxz);
+	int n = 0;
+	for (int b = begin & ~(aabbBatchWidth - 1);b < end;b += aabbBatchWidth) {
+		unsigned lanes = blockMask(s, b, begin, end);
+		if (!lanes) continue;
+		unsigned m = 0;
+		for (int k = 0;k < aabbBatchWidth;k += 4) {
+			__m128 x = _mm_and_ps(_mm_cmple_ps(qminx, _mm_load_ps(&s.maxx[b + k])), _mm_cmpge_ps(qmaxx, _mm_load_ps(&s.minx[b + k])));
+			__m128 y = _mm_and_ps(_mm_cmple_ps(qminy, _mm_load_ps(&s.maxy[b + k])), _mm_cmpge_ps(qmaxy, _mm_load_ps(&s.miny[b + k])));
+			__m128 z = _mm_and_ps(_mm_cmple_ps(qminz, _mm_load_ps(&s.maxz[b + k])), _mm_cmpge_ps(qmaxz, _mm_load_ps(&s.minz[b + k])));
+			m |= (unsigned)_mm_movemask_ps(_mm_and_ps(x, _mm_and_ps(y, z))) << k;
+		}
+		if (emitHits(m & lanes, b, anyOnly, hits, n)) return n;
+	}
+	return n;
+}
+#endif
+
+#ifdef CORAL_HAS_AVX2_PATH
+CORAL_AVX2_TARGET
+static int scanAvx2(const AabbSoA& s, const AABB& q, int begin, int end, int* hits, bool anyOnly) {
+	const __m256 qminx = _mm256_set1_ps(q.minx), qminy = _mm256_set1_ps(q.miny), qminz = _mm256_set1_ps(q.minz);
+	const __m256 qmaxx = _mm256_set1_ps(q.maxx), qmaxy = _mm256_set1_ps(q.maxy), qmaxz = _mm256_set1_ps(q.maxz);
+	int n = 0;
+	for (int b = begin & ~(aabbBatchWidth - 1);b < end;b += aabbBatchWidth) {
+		unsigned lanes = blockMask(s, b, begin, end);
+		if (!lanes) continue;
+		unsigned m = 0;
+		for (int k = 0;k < aabbBatchWidth;k += 8) {
+			__m256 x = _mm256_and_ps(_mm256_cmp_ps(qminx, _mm256_load_ps(&s.maxx[b + k]), _CMP_LE_OQ),
+				_mm256_cmp_ps(qmaxx, _mm256_load_ps(&s.minx[b + k]), _CMP_GE_OQ));
+			__m256 y = _mm256_and_ps(_mm256_cmp_ps(qminy, _mm256_load_ps(&s.maxy[b + k]), _CMP_LE_OQ),
+				_mm256_cmp_ps(qmaxy, _mm256_load_ps(&s.miny[b + k]), _CMP_GE_OQ));
+			__m256 z = _mm256_and_ps(_mm256_cmp_ps(qminz, _mm256_load_ps(&s.maxz[b + k]), _CMP_LE_OQ),
+				_mm256_cmp_ps(qmaxz, _mm256_load_ps(&s.minz[b + k]), _CMP_GE_OQ));
+			m |= (unsigned)_mm256_movemask_ps(_mm256_and_ps(x, _mm256_and_ps(y, z))) << k;
+		}
+		if (emitHits(m & lanes, b, anyOnly, hits, n)) return n;
+	}
+	return n;
+}
+#endif
+
+///////////////
+// Dispatch
+///////////////
+static const char* const aabbKernelNames[AABB_KERNEL_COUNT] = { "scalar", "sse", "avx2" };
+
+const char* aabbKernelName(AabbKernel k) {
+	return aabbKernelNames[k];
+}
+
+bool aabbKernelSupported(AabbKernel k) {
+	switch (k) {
+	case AABB_KERNEL_SCALAR: return true;
+#ifdef CORAL_X86
+	case AABB_KERNEL_SSE: return true; // baseline on x86-64
+#endif
+#ifdef CORAL_HAS_AVX2_PATH
+	case AABB_KERNEL_AVX2:
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_cpu_supports("avx2");
+#else
+		return true; // built with /arch:AVX2
+#endif
+#endif
+	default: return false;
+	}
+}
+
+static AabbKernel detectAabbKernel() {
+	for (int k = AABB_KERNEL_COUNT - 1;k > 0;k--)
+		if (aabbKernelSupported((AabbKernel)k)) return (AabbKernel)k;
+	return AABB_KERNEL_SCALAR;
+}
+
+AabbKernel aabbKernel = detectAabbKernel();
+
+static int scanBoxes(AabbKernel k, const AabbSoA& s, const AABB& q, int begin, int end, int* hits, bool anyOnly) {
+	if (end > s.count) end = s.count;
+	if (begin >= end) return 0;
+	switch (k) {
+#ifdef CORAL_HAS_AVX2_PATH
+	case AABB_KERNEL_AVX2: return scanAvx2(s, q, begin, end, hits, anyOnly);
+#endif
+#ifdef CORAL_X86
+	case AABB_KERNEL_SSE: return scanSse(s, q, begin, end, hits, anyOnly);
+#endif
+	default: return scanScalar(s, q, begin, end, hits, anyOnly);
+	}
+}
+
+int aabbBatchOverlaps(const AabbSoA& s, const AABB& q, int begin, int end, int* hits) {
+	return scanBoxes(aabbKernel, s, q, begin, end, hits, false);
+}
+
+int aabbBatchOverlaps(AabbKernel k, const AabbSoA& s, const AABB& q, int begin, int end, int* hits) {
+	return scanBoxes(k, s, q, begin, end, hits, false);
+}
+
+bool aabbBatchAny(const AabbSoA& s, const AABB& q, int begin, int end) {
+	return scanBoxes(aabbKernel, s, q, begin, end, nullptr, true) != 0;
+}
@@ -0,0 +1,51 @@
+#pragma once
+///////////////
+// Structure-of-arrays box store and batch overlap kernels
+// Boxes live in six contiguous, 32-byte aligned float arrays padded to a multiple of 16
+// with empty boxes, plus a visibility bitmask, so one query can be tested against 8 (AVX2)
+// or 4 (SSE) boxes per compare. The kernel is picked at startup from the CPU features;
+// the scalar path is the reference and the fallback on other architectures.
+///////////////
+#include <cstdint>
+
+#include "coral_array.h"
+
+struct AABB {
+	float minx, miny, minz;
+	float maxx, maxy, maxz;
+};
+
+typedef LevelArray<float, 32> AlignedFloats;
+
+const int aabbBatchWidth = 16; // arrays are padded to this many boxes
+
+struct AabbSoA {
+	AlignedFloats minx, miny, minz, maxx, maxy, maxz;
+	LevelArray<uint64_t> visible; // bit i set = box i takes part in queries
+	int count = 0;
+
+	void clear();
+	void reserve(int n);
+	int push(const AABB& b, bool isVisible); // returns the box index
+	void set(int i, const AABB& b);
+	AABB get(int i) const;
+	void setVisible(int i, bool isVisible) {
+		if (isVisible) visible[i >> 6] |= 1ull << (i & 63);
+		else visible[i >> 6] &= ~(1ull << (i & 63));
+	}
+	bool isVisible(int i) const { return (visible[i >> 6] >> (i & 63)) & 1; }
+};
+
+enum AabbKernel { AABB_KERNEL_SCALAR, AABB_KERNEL_SSE, AABB_KERNEL_AVX2, AABB_KERNEL_COUNT };
+
+extern AabbKernel aabbKernel; // best supported kernel, chosen at startup
+
+const char* aabbKernelName(AabbKernel k);
+bool aabbKernelSupported(AabbKernel k);
+
+// visible boxes in [begin, end) overlapping q (touching counts, like aabbIntersects).
+// Indices are written to hits when it is not null; returns the number of overlaps.
+int aabbBatchOverlaps(const AabbSoA& s, const AABB& q, int begin, int end, int* hits);
+int aabbBatchOverlaps(AabbKernel k, const AabbSoA& s, const AABB& q, int begin, int end, int* hits);
+// true as soon as one visible box in [begin, end) overlaps q
+bool aabbBatchAny(const AabbSoA& s, const AABB& q, int begin, int end);
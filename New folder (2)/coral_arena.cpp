@@ -0,0 +1,120 @@
+#include "coral_arena.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+///////////////
+// Heap counters
+// Replacing the global operator new counts every C++ allocation in the program (malloc
+// from C libraries and the GL driver is not seen). Relaxed: only the totals matter.
+///////////////
+static std::atomic<long long> heapNewCalls{ 0 };
+
+long long heapAllocations() {
+	return heapNewCalls.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t bytes) {
+	heapNewCalls.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = malloc(bytes ? bytes : 1)) return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t bytes) {
+	return operator new(bytes);
+}
+
+void* operator new(size_t bytes, std::align_val_t align) {
+	heapNewCalls.fetch_add(1, std::memory_order_relaxed);
+	size_t a = std::max(sizeof(void*), (size_t)align);
+#ifdef _WIN32
+	if (void* p = _aligned_malloc(bytes ? bytes : 1, a)) return p;
+#else
+	if (void* p = aligned_alloc(a, (bytes + a - 1) / a * a + (bytes ? 0 : a))) return p;
+#endif
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t bytes, std::align_val_t align) {
+	return operator new(bytes, align);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+#ifdef _WIN32
+static void alignedFree(void* p) { _aligned_free(p); }
+#else
+static void alignedFree(void* p) { free(p); }
+#endif
+void operator delete(void* p, std::align_val_t) noexcept { alignedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { alignedFree(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { alignedFree(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { alignedFree(p); }
+
+///////////////
+// Frame arena
+///////////////
+FrameArena frameArena(64 * 1024);
+
+FrameArena::FrameArena(size_t bytes) {
+	for (auto& h : halves) {
+		h.block.reset(bytes ? new unsigned char[bytes] : nullptr);
+		h.size = bytes;
+	}
+}
+
+void FrameArena::beginFrame() {
+	current ^= 1;
+	Half& h = halves[current];
+	if (h.spillBytes > 0) {
+		// ran over two frames ago: one block for all of it (and room to spare) from now on
+		h.size = (h.used + h.spillBytes) * 2;
+		h.block.reset(new unsigned char[h.size]);
+	}
+	h.spill.clear();
+	h.spillBytes = 0;
+	h.used = 0;
+}
+
+void* FrameArena::alloc(size_t bytes, size_t align) {
+	Half& h = halves[current];
+	uintptr_t base = (uintptr_t)h.block.get();
+	size_t start = ((base + h.used + align - 1) & ~(uintptr_t)(align - 1)) - base;
+	if (h.block && start + bytes <= h.size) {
+		h.used = start + bytes;
+		return h.block.get() + start;
+	}
+	// new [] aligns to max_align_t; wider alignments are over-allocated
+	size_t pad = align > alignof(std::max_align_t) ? align : 0;
+	h.spill.emplace_back(new unsigned char[bytes + pad]);
+	h.spillBytes += bytes + pad;
+	uintptr_t p = (uintptr_t)h.spill.back().get();
+	return (void*)((p + align - 1) & ~(uintptr_t)(align - 1));
+}
+
+char* FrameArena::vformat(const char* fmt, va_list args) {
+	va_list measure;
+	va_copy(measure, args);
+	int n = vsnprintf(nullptr, 0, fmt, measure);
+	va_end(measure);
+	char* s = allocArray<char>(std::max(n, 0) + 1);
+	vsnprintf(s, std::max(n, 0) + 1, fmt, args);
+	return s;
+}
+
+char* FrameArena::format(const char* fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	char* s = vformat(fmt, args);
+	va_end(args);
+	return s;
+}
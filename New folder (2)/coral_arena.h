@@ -0,0 +1,39 @@
+#pragma once
+///////////////
+// Frame arena & heap counters
+// FrameArena hands out per-frame scratch memory (HUD strings, transient arrays) by bumping
+// a pointer through one block, and frees it all at once when a frame begins. It keeps two
+// frames: what the last frame allocated stays valid through the current one, so a frame
+// can compare itself with the one before. A frame that runs past its block takes extra heap
+// blocks for the rest and the block grows to fit by the time it comes round again, so a
+// steady run does not touch the heap. One thread per arena.
+// The global operator new / delete are counted (heapAllocations), so the game and the
+// benchmarks can show the frames and ticks that allocate.
+///////////////
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdarg>
+
+struct FrameArena {
+	struct Half {
+		std::unique_ptr<unsigned char[]> block;
+		size_t size = 0, used = 0;
+		std::vector<std::unique_ptr<unsigned char[]>> spill; // allocations past the block this time
+		size_t spillBytes = 0;
+	};
+	Half halves[2];
+	int current = 0;
+
+	explicit FrameArena(size_t bytes = 0);
+	void beginFrame(); // frees the frame before last
+	void* alloc(size_t bytes, size_t align = alignof(std::max_align_t));
+	template<class T> T* allocArray(size_t count) { return static_cast<T*>(alloc(count * sizeof(T), alignof(T))); }
+	char* format(const char* fmt, ...); // printf into the arena
+	char* vformat(const char* fmt, va_list args);
+	size_t used() const { return halves[current].used + halves[current].spillBytes; }
+};
+
+extern FrameArena frameArena; // the render side's: the game's Display, coral_render_bench
+
+long long heapAllocations(); // operator new calls since startup, every thread
@@ -0,0 +1,92 @@
+#pragma once
+///////////////
+// Contiguous arrays for the level data
+// LevelArray either owns aligned heap storage or borrows memory from a mapped level file
+// (coral_level.h), so loaded levels are used in place. Borrowed elements may be written
+// (the mapping is copy-on-write); changing the size copies them into owned storage first.
+///////////////
+#include <vector>
+#include <cstddef>
+#include <new>
+
+template <class T, size_t Align>
+struct AlignedAllocator {
+	typedef T value_type;
+	AlignedAllocator() {}
+	template <class U> AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+	template <class U> struct rebind { typedef AlignedAllocator<U, Align> other; };
+	T* allocate(size_t n) { return (T*)::operator new(n * sizeof(T), std::align_val_t(Align)); }
+	void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(Align)); }
+	bool operator==(const AlignedAllocator&) const { return true; }
+	bool operator!=(const AlignedAllocator&) const { return false; }
+};
+
+template <class T, size_t Align = alignof(T)>
+class LevelArray {
+public:
+	typedef T value_type;
+	typedef T* iterator;
+	typedef const T* const_iterator;
+
+	LevelArray() : ptr(nullptr), count(0), borrowedMem(false) {}
+	LevelArray(const LevelArray& o) : own(o.begin(), o.end()), borrowedMem(false) { sync(); }
+	LevelArray& operator=(const LevelArray& o) {
+		if (this != &o) {
+			own.assign(o.begin(), o.end());
+			borrowedMem = false;
+			sync();
+		}
+		return *this;
+	}
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	T* data() { return ptr; }
+	const T* data() const { return ptr; }
+	T& operator[](size_t i) { return ptr[i]; }
+	const T& operator[](size_t i) const { return ptr[i]; }
+	T* begin() { return ptr; }
+	T* end() { return ptr + count; }
+	const T* begin() const { return ptr; }
+	const T* end() const { return ptr + count; }
+	T& back() { return ptr[count - 1]; }
+
+	void clear() { release(); own.clear(); sync(); }
+	void reserve(size_t n) { detach(); own.reserve(n); sync(); }
+	void resize(size_t n, const T& v = T()) { detach(); own.resize(n, v); sync(); }
+	void assign(size_t n, const T& v) { release(); own.assign(n, v); sync(); }
+	template <class It> void assign(It first, It last) { release(); own.assign(first, last); sync(); }
+	void push_back(const T& v) { detach(); own.push_back(v); sync(); }
+
+	// use n elements at p in place (p must stay valid until the array is cleared or rebound)
+	void borrow(T* p, size_t n) {
+		own.clear();
+		own.shrink_to_fit();
+		ptr = p;
+		count = n;
+		borrowedMem = true;
+	}
+	bool borrowed() const { return borrowedMem; }
+
+private:
+	void release() {
+		if (!borrowedMem) return;
+		borrowedMem = false;
+		ptr = nullptr;
+		count = 0;
+	}
+	void detach() {
+		if (!borrowedMem) return;
+		own.assign(ptr, ptr + count);
+		borrowedMem = false;
+	}
+	void sync() {
+		ptr = own.data();
+		count = own.size();
+	}
+
+	std::vector<T, AlignedAllocator<T, Align>> own;
+	T* ptr;
+	size_t count;
+	bool borrowedMem;
+};
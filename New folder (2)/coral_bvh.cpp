@@ -0,0 +1,299 @@
+#include "coral_bvh.h"
+
+#include <cmath>
+#include <algorithm>
+
+///////////////
+// Build
+// Each node splits its primitives at the cheapest of bvhBins - 1 planes along the axis with
+// the widest centroid spread (surface area heuristic: area x count on both sides). Nodes go
+// out in depth-first order, so the left child is always the node right after its parent.
+// Primitives with identical centroids, a split that leaves one side empty or a tree grown
+// past bvhMedianDepth fall back to a median split, which keeps the depth logarithmic.
+///////////////
+static const int bvhMedianDepth = 40;
+static const int bvhStackSize = 128; // > bvhMedianDepth + log2 of any primitive count
+
+static const AABB emptyBox = { 1e30f, 1e30f, 1e30f, -1e30f, -1e30f, -1e30f };
+
+static void growBox(AABB& a, const AABB& b) {
+	a.minx = std::min(a.minx, b.minx); a.miny = std::min(a.miny, b.miny); a.minz = std::min(a.minz, b.minz);
+	a.maxx = std::max(a.maxx, b.maxx); a.maxy = std::max(a.maxy, b.maxy); a.maxz = std::max(a.maxz, b.maxz);
+}
+
+static float halfArea(const AABB& b) {
+	float dx = b.maxx - b.minx, dy = b.maxy - b.miny, dz = b.maxz - b.minz;
+	return dx * dy + dy * dz + dz * dx;
+}
+
+// primitives are partitioned by value, so every pass over a node's range reads memory in order
+struct BvhBuildPrim {
+	AABB box;
+	float centre[3];
+	int id;
+};
+
+struct BvhBuilder {
+	Bvh& bvh;
+	std::vector<BvhBuildPrim> prims;
+
+	int build(int begin, int end, int depth) {
+		int index = (int)bvh.nodes.size();
+		bvh.nodes.emplace_back();
+		bvh.depth = std::max(bvh.depth, depth + 1);
+
+		AABB bounds = emptyBox, centres = emptyBox;
+		for (int i = begin;i < end;i++) {
+			const BvhBuildPrim& p = prims[i];
+			growBox(bounds, p.box);
+			AABB c = { p.centre[0], p.centre[1], p.centre[2], p.centre[0], p.centre[1], p.centre[2] };
+			growBox(centres, c);
+		}
+		BvhNode& node = bvh.nodes[index];
+		node.box = bounds;
+		int n = end - begin;
+		if (n <= bvhLeafSize) {
+			node.first = begin;
+			node.count = n;
+			return index;
+		}
+
+		float lo[3] = { centres.minx, centres.miny, centres.minz };
+		float extent[3] = { centres.maxx - centres.minx, centres.maxy - centres.miny, centres.maxz - centres.minz };
+		int axis = 0;
+		if (extent[1] > extent[axis]) axis = 1;
+		if (extent[2] > extent[axis]) axis = 2;
+
+		int mid = begin;
+		if (extent[axis] > 0.0f && depth < bvhMedianDepth) {
+			float scale = bvhBins / extent[axis];
+			auto binOf = [&](const BvhBuildPrim& p) {
+				return std::min((int)((p.centre[axis] - lo[axis]) * scale), bvhBins - 1);
+				};
+			int binCount[bvhBins] = {};
+			AABB binBox[bvhBins];
+			for (int b = 0;b < bvhBins;b++) binBox[b] = emptyBox;
+			for (int i = begin;i < end;i++) {
+				int b = binOf(prims[i]);
+				binCount[b]++;
+				growBox(binBox[b], prims[i].box);
+			}
+			// right-to-left sweep for the right side of every plane, then left-to-right for the cost
+			float rightArea[bvhBins];
+			int rightCount[bvhBins];
+			AABB acc = emptyBox;
+			int count = 0;
+			for (int b = bvhBins - 1;b > 0;b--) {
+				growBox(acc, binBox[b]);
+				count += binCount[b];
+				rightArea[b] = count > 0 ? halfArea(acc) : 0.0f;
+				rightCount[b] = count;
+			}
+			float bestCost = 1e30f;
+			int bestPlane = -1;
+			acc = emptyBox;
+			count = 0;
+			for (int b = 1;b < bvhBins;b++) {
+				growBox(acc, binBox[b - 1]);
+				count += binCount[b - 1];
+				if (count == 0 || rightCount[b] == 0) continue;
+				float cost = halfArea(acc) * count + rightArea[b] * rightCount[b];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestPlane = b;
+				}
+			}
+			if (bestPlane > 0)
+				mid = (int)(std::partition(prims.begin() + begin, prims.begin() + end,
+					[&](const BvhBuildPrim& p) { return binOf(p) < bestPlane; }) - prims.begin());
+		}
+		if (mid == begin || mid == end) {
+			mid = begin + n / 2;
+			std::nth_element(prims.begin() + begin, prims.begin() + mid, prims.begin() + end,
+				[&](const BvhBuildPrim& a, const BvhBuildPrim& b) { return a.centre[axis] < b.centre[axis]; });
+		}
+
+		build(begin, mid, depth + 1);
+		int right = build(mid, end, depth + 1);
+		bvh.nodes[index].first = right;
+		bvh.nodes[index].count = 0;
+		return index;
+	}
+};
+
+void buildBvh(Bvh& bvh, const AABB* boxes, int count) {
+	bvh.nodes.clear();
+	bvh.boxes.clear();
+	bvh.ids.clear();
+	bvh.depth = 0;
+	if (count <= 0) return;
+
+	BvhBuilder builder{ bvh, {} };
+	builder.prims.resize(count);
+	for (int i = 0;i < count;i++) {
+		BvhBuildPrim& p = builder.prims[i];
+		p.box = boxes[i];
+		p.centre[0] = (boxes[i].minx + boxes[i].maxx) * 0.5f;
+		p.centre[1] = (boxes[i].miny + boxes[i].maxy) * 0.5f;
+		p.centre[2] = (boxes[i].minz + boxes[i].maxz) * 0.5f;
+		p.id = i;
+	}
+	bvh.nodes.reserve(2 * (count / bvhLeafSize + 1));
+	builder.build(0, count, 0);
+
+	bvh.boxes.resize(count);
+	bvh.ids.resize(count);
+	for (int i = 0;i < count;i++) {
+		bvh.boxes[i] = builder.prims[i].box;
+		bvh.ids[i] = builder.prims[i].id;
+	}
+}
+
+///////////////
+// Queries
+// Zero direction components get a huge finite inverse instead of infinity, so a slab the ray
+// runs along never produces 0 * inf = NaN.
+///////////////
+bool rayBoxSlab(const AABB& b, float ox, float oy, float oz, float ix, float iy, float iz, float maxT, float& tEnter) {
+	float t0 = (b.minx - ox) * ix, t1 = (b.maxx - ox) * ix;
+	float tmin = std::min(t0, t1), tmax = std::max(t0, t1);
+	t0 = (b.miny - oy) * iy; t1 = (b.maxy - oy) * iy;
+	tmin = std::max(tmin, std::min(t0, t1)); tmax = std::min(tmax, std::max(t0, t1));
+	t0 = (b.minz - oz) * iz; t1 = (b.maxz - oz) * iz;
+	tmin = std::max(tmin, std::min(t0, t1)); tmax = std::min(tmax, std::max(t0, t1));
+	tmin = std::max(tmin, 0.0f);
+	tEnter = tmin;
+	return tmin <= std::min(tmax, maxT);
+}
+
+static float inverseDir(float d) {
+	return d != 0.0f ? 1.0f / d : (std::signbit(d) ? -1e30f : 1e30f);
+}
+
+static bool primVisible(const uint64_t* visible, int id) {
+	return !visible || ((visible[id >> 6] >> (id & 63)) & 1);
+}
+
+bool bvhRaycast(const Bvh& bvh, const BvhRay& ray, const uint64_t* visible, BvhHit& hit) {
+	hit.t = ray.maxT;
+	hit.id = -1;
+	if (bvh.nodes.empty()) return false;
+	float ix = inverseDir(ray.dx), iy = inverseDir(ray.dy), iz = inverseDir(ray.dz);
+	struct Entry { int node; float t; } stack[bvhStackSize];
+	int sp = 0;
+	float t;
+	if (rayBoxSlab(bvh.nodes[0].box, ray.ox, ray.oy, ray.oz, ix, iy, iz, hit.t, t)) stack[sp++] = { 0, t };
+	while (sp > 0) {
+		Entry e = stack[--sp];
+		if (e.t > hit.t) continue; // a nearer hit was found after this node was pushed
+		const BvhNode& node = bvh.nodes[e.node];
+		if (node.count > 0) {
+			for (int i = node.first;i < node.first + node.count;i++) {
+				if (!primVisible(visible, bvh.ids[i])) continue;
+				if (rayBoxSlab(bvh.boxes[i], ray.ox, ray.oy, ray.oz, ix, iy, iz, hit.t, t) && (hit.id < 0 || t < hit.t)) {
+					hit.t = t;
+					hit.id = bvh.ids[i];
+				}
+			}
+			continue;
+		}
+		// push the farther child first so the nearer one is visited next
+		int left = e.node + 1, right = node.first;
+		float tl, tr;
+		bool hitL = rayBoxSlab(bvh.nodes[left].box, ray.ox, ray.oy, ray.oz, ix, iy, iz, hit.t, tl);
+		bool hitR = rayBoxSlab(bvh.nodes[right].box, ray.ox, ray.oy, ray.oz, ix, iy, iz, hit.t, tr);
+		if (hitL && hitR) {
+			if (tl <= tr) { stack[sp++] = { right, tr }; stack[sp++] = { left, tl }; }
+			else { stack[sp++] = { left, tl }; stack[sp++] = { right, tr }; }
+		}
+		else if (hitL) stack[sp++] = { left, tl };
+		else if (hitR) stack[sp++] = { right, tr };
+	}
+	return hit.id >= 0;
+}
+
+bool bvhRayAny(const Bvh& bvh, const BvhRay& ray, const uint64_t* visible) {
+	if (bvh.nodes.empty()) return false;
+	float ix = inverseDir(ray.dx), iy = inverseDir(ray.dy), iz = inverseDir(ray.dz);
+	int stack[bvhStackSize];
+	int sp = 0;
+	stack[sp++] = 0;
+	float t;
+	while (sp > 0) {
+		int index = stack[--sp];
+		const BvhNode& node = bvh.nodes[index];
+		if (!rayBoxSlab(node.box, ray.ox, ray.oy, ray.oz, ix, iy, iz, ray.maxT, t)) continue;
+		if (node.count > 0) {
+			for (int i = node.first;i < node.first + node.count;i++)
+				if (primVisible(visible, bvh.ids[i]) && rayBoxSlab(bvh.boxes[i], ray.ox, ray.oy, ray.oz, ix, iy, iz, ray.maxT, t))
+					return true;
+			continue;
+		}
+		stack[sp++] = node.first;
+		stack[sp++] = index + 1;
+	}
+	return false;
+}
+
+void bvhQuery(const Bvh& bvh, const AABB& box, const uint64_t* visible, std::vector<int>& ids) {
+	ids.clear();
+	if (bvh.nodes.empty()) return;
+	int stack[bvhStackSize];
+	int sp = 0;
+	stack[sp++] = 0;
+	while (sp > 0) {
+		int index = stack[--sp];
+		const BvhNode& node = bvh.nodes[index];
+		if (!aabbIntersects(box, node.box)) continue;
+		if (node.count > 0) {
+			for (int i = node.first;i < node.first + node.count;i++)
+				if (primVisible(visible, bvh.ids[i]) && aabbIntersects(box, bvh.boxes[i])) ids.push_back(bvh.ids[i]);
+			continue;
+		}
+		stack[sp++] = node.first;
+		stack[sp++] = index + 1;
+	}
+}
+
+///////////////
+// Coral BVH
+// Built from the coral boxes of the collision grid (coral ids come first there) and
+// filtered by the grid's live bits, so hiding a coral needs no rebuild of its own.
+///////////////
+Bvh coralBvh;
+static unsigned coralBvhRevision = ~0u;
+static const CoralSegment* coralBvhData = nullptr;
+static size_t coralBvhCount = 0;
+
+void updateCoralBvh() {
+	if (coralBvhRevision == layoutRevision && coralBvhData == coralSegments.data() && coralBvhCount == coralSegments.size()) return;
+	std::vector<AABB> boxes(coralSegments.size());
+	for (size_t i = 0;i < coralSegments.size();i++) boxes[i] = getCoralAABB(coralSegments[i]);
+	buildBvh(coralBvh, boxes.data(), (int)boxes.size());
+	coralBvhRevision = layoutRevision;
+	coralBvhData = coralSegments.data();
+	coralBvhCount = coralSegments.size();
+}
+
+static const uint64_t* coralLiveBits() {
+	const CollisionGrid& g = collisionGrid;
+	if (g.kindBase[COLLIDER_MAJOR] != (int)coralSegments.size()) return nullptr; // grid not built for this coral
+	return g.boxes.visible.data();
+}
+
+bool coralRaycast(float x0, float y0, float z0, float x1, float y1, float z1, BvhHit& hit) {
+	updateCoralBvh();
+	BvhRay ray = { x0, y0, z0, x1 - x0, y1 - y0, z1 - z0, 1.0f };
+	return bvhRaycast(coralBvh, ray, coralLiveBits(), hit);
+}
+
+bool coralLineOfSight(float x0, float y0, float z0, float x1, float y1, float z1) {
+	updateCoralBvh();
+	BvhRay ray = { x0, y0, z0, x1 - x0, y1 - y0, z1 - z0, 1.0f };
+	return !bvhRayAny(coralBvh, ray, coralLiveBits());
+}
+
+void coralQuery(const AABB& box, std::vector<int>& ids) {
+	updateCoralBvh();
+	bvhQuery(coralBvh, box, coralLiveBits(), ids);
+}
@@ -0,0 +1,64 @@
+#pragma once
+///////////////
+// Bounding volume hierarchy for ray casts and box queries
+// Built top-down with a binned surface area heuristic and stored flattened in depth-first
+// order as 32-byte nodes: an interior node's left child is the next node and `first` holds
+// its right child; a leaf's `first`/`count` pick a range of the primitive boxes, which are
+// reordered into leaf order so a leaf reads one contiguous run. Rays use the slab test with a
+// precomputed inverse direction and visit the nearer child first.
+// coralBvh covers the coral of the current layout and rebuilds itself when layoutRevision moves;
+// it belongs to the simulation thread (the renderer casts against its snapshot's SimLayout).
+///////////////
+#include <vector>
+#include <cstdint>
+
+#include "coral_sim.h"
+
+struct BvhNode {
+	AABB box;
+	int32_t first; // leaf: first primitive slot; interior: index of the right child
+	int32_t count; // primitives in the leaf, 0 for an interior node
+};
+
+struct Bvh {
+	std::vector<BvhNode> nodes; // nodes[0] is the root
+	std::vector<AABB> boxes; // primitive boxes in leaf order
+	std::vector<int> ids; // leaf slot -> primitive index
+	int depth = 0;
+};
+
+const int bvhLeafSize = 4; // primitives per leaf at most
+const int bvhBins = 12; // SAH split candidates per axis
+
+void buildBvh(Bvh& bvh, const AABB* boxes, int count);
+
+struct BvhRay {
+	float ox, oy, oz; // origin
+	float dx, dy, dz; // direction, need not be normalised; hit distances are in units of it
+	float maxT;
+};
+
+struct BvhHit {
+	float t; // entry distance along the ray (0 if the origin is inside the box)
+	int id; // primitive index, -1 = no hit
+};
+
+// visible is a bitmask over primitive indices (bit i set = primitive i takes part, like
+// AabbSoA::visible); nullptr = every primitive
+bool bvhRaycast(const Bvh& bvh, const BvhRay& ray, const uint64_t* visible, BvhHit& hit); // nearest hit
+bool bvhRayAny(const Bvh& bvh, const BvhRay& ray, const uint64_t* visible); // any hit before maxT
+void bvhQuery(const Bvh& bvh, const AABB& box, const uint64_t* visible, std::vector<int>& ids); // overlaps, touching counts
+
+// slab test: entry distance of the ray in [0, maxT] through b, or false
+bool rayBoxSlab(const AABB& b, float ox, float oy, float oz, float ix, float iy, float iz, float maxT, float& tEnter);
+
+///////////////
+// Coral BVH
+///////////////
+extern Bvh coralBvh;
+
+void updateCoralBvh(); // rebuilds coralBvh if the layout changed since the last build
+// nearest visible coral along the segment from (x0, y0, z0) to (x1, y1, z1); t in [0, 1]
+bool coralRaycast(float x0, float y0, float z0, float x1, float y1, float z1, BvhHit& hit);
+bool coralLineOfSight(float x0, float y0, float z0, float x1, float y1, float z1); // true if no coral blocks it
+void coralQuery(const AABB& box, std::vector<int>& ids); // visible coral overlapping box
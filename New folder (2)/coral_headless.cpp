@@ -0,0 +1,819 @@
+///////////////
+// Headless simulation runner
+// Advances the coral maze simulation from scripted input at full speed with no GLUT/GL,
+// for balancing runs and regression checks on machines without a display.
+//
+//   coral_headless [--script file]... [--sessions N] [--ticks N] [--sim-hz HZ] [--player-speed S] [--quiet]
+//                  [--record file] [--level file.crlv [--stream MB] [--stream-radius R]] [--agents N] [--sim-threads K]
+//   coral_headless --replay file [--replay file]... [--sessions N] [--quiet]
+//   coral_headless --bench-collision
+//   coral_headless --bench-maze [--maze N] [--maze-tile T]
+//   coral_headless --bench-aabb
+//   coral_headless --bench-bvh
+//   coral_headless --bench-agents [--maze N] [--sim-threads K]
+//   coral_headless --bench-nav [--maze N] [--sim-threads K]
+//   coral_headless --bench-snapshot [--maze N] [--sim-threads K]
+//   coral_headless --bench-level file.crlv
+//
+// Maze options (--maze N, --seed S, --maze-algo backtracker|wilson|kruskal, --maze-tile T,
+// --maze-threads K) replace the hand-made layout with a generated N x N maze; --level file
+// loads a binary level built by coral_levelc. --stream MB streams the level's chunks around
+// the diver within that memory budget instead (coral_stream.h), which is not deterministic.
+// --agents N puts N - 1 autonomous divers in the maze with the player, moved by --sim-threads K
+// job workers (default: every core); the crowd is seeded, so runs stay reproducible.
+//
+// Script lines are "<tick> <key> [repeat] [every]": movement keys (i/j/k/l/u/o) are held
+// from <tick> for <repeat> * <every> ticks (the span of that many GLUT key repeats);
+// toggle keys (m/n/v/b) are pressed before <tick> and again every <every> ticks, <repeat>
+// presses in total. '#' starts a comment.
+//
+// --record writes the first session as a binary input log (coral_replay.h); the game writes
+// the same format with --record. --replay runs logs bit-exactly at full speed, cycling
+// through them for --sessions rounds: the fast path for replaying a corpus of real sessions.
+// Sessions cycle through the given scripts; without a script the diver stays put.
+///////////////
+#include "coral_sim.h"
+#include "coral_mazegen.h"
+#include "coral_replay.h"
+#include "coral_level.h"
+#include "coral_stream.h"
+#include "coral_bvh.h"
+#include "coral_nav.h"
+#include "coral_jobs.h"
+#include "coral_snapshot.h"
+#include "coral_arena.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <map>
+
+struct ScriptEvent {
+	long long tick;
+	unsigned char key;
+	bool down; // movement keys: press or release; toggles are always presses
+};
+
+struct InputScript {
+	const char* name;
+	std::vector<ScriptEvent> events; // sorted by tick
+};
+
+static bool isMovementKey(char key) {
+	return key != 0 && strchr("ijkluo", key) != nullptr;
+}
+
+bool loadScript(const char* path, InputScript& script) {
+	FILE* f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "cannot open script %s\n", path);
+		return false;
+	}
+	script.name = path;
+	script.events.clear();
+	char line[256];
+	int lineNo = 0;
+	while (fgets(line, sizeof(line), f)) {
+		lineNo++;
+		char* hash = strchr(line, '#');
+		if (hash) *hash = 0;
+		long long tick;
+		char key;
+		int repeat = 1, every = 1;
+		int n = sscanf(line, "%lld %c %d %d", &tick, &key, &repeat, &every);
+		if (n <= 0) continue;
+		if (n < 2 || tick < 0 || repeat < 1 || every < 1) {
+			fprintf(stderr, "%s:%d: expected \"<tick> <key> [repeat] [every]\"\n", path, lineNo);
+			fclose(f);
+			return false;
+		}
+		if (isMovementKey(key)) {
+			script.events.push_back(ScriptEvent{ tick, (unsigned char)key, true });
+			script.events.push_back(ScriptEvent{ tick + (long long)repeat * every, (unsigned char)key, false });
+		}
+		else {
+			for (int r = 0;r < repeat;r++)
+				script.events.push_back(ScriptEvent{ tick + (long long)r * every, (unsigned char)key, true });
+		}
+	}
+	fclose(f);
+	// releases first, so back-to-back holds of one key stay held
+	std::stable_sort(script.events.begin(), script.events.end(),
+		[](const ScriptEvent& a, const ScriptEvent& b) { return a.tick < b.tick || (a.tick == b.tick && !a.down && b.down); });
+	return true;
+}
+
+// one round from reset until game over or maxTicks
+void runSession(const InputScript* script, long long maxTicks, float dt) {
+	resetGame();
+	clearInputKeys();
+	size_t next = 0;
+	while (!gameOver && simTick < maxTicks) {
+		if (script) {
+			while (next < script->events.size() && script->events[next].tick <= simTick) {
+				const ScriptEvent& e = script->events[next++];
+				InputEventType type = e.down ? INPUT_EVENT_KEY_DOWN : INPUT_EVENT_KEY_UP;
+				recordInputEvent(type, e.key);
+				applyInputEvent(InputEvent{ sessionTick, (uint8_t)type, e.key });
+			}
+		}
+		simulateStep(dt);
+	}
+}
+
+// FNV-1a over the end-of-round state, for regression comparisons
+unsigned stateChecksum() {
+	unsigned h = 2166136261u;
+	auto mix = [&](const void* p, size_t n) {
+		const unsigned char* b = (const unsigned char*)p;
+		for (size_t i = 0;i < n;i++) { h ^= b[i]; h *= 16777619u; }
+		};
+	for (const auto& a : agents) { mix(&a.x, sizeof(float)); mix(&a.y, sizeof(float)); mix(&a.z, sizeof(float)); }
+	mix(&gameTime, sizeof(float)); mix(&collectedGoals, sizeof(int)); mix(&simTick, sizeof(simTick));
+	for (const auto& g : goals) mix(&g.visible, sizeof(bool));
+	return h;
+}
+
+///////////////
+// Collision microbenchmark (--bench-collision)
+// Scatters N thin coral walls at constant density and compares the old linear scan
+// with the grid lookup for random player-sized boxes. Grid cost should stay flat as N grows.
+///////////////
+static bool linearCollides(const AABB& box) {
+	for (const auto& c : coralSegments)
+		if (c.visible && aabbIntersects(box, getCoralAABB(c))) return true;
+	for (const auto& m : majorObjs)
+		if (m.visible && aabbIntersects(box, getMajorAABB(m))) return true;
+	for (const auto& r : majorRocks)
+		if (aabbIntersects(box, getRockAABB(r[0], r[1], r[2], r[3]))) return true;
+	return false;
+}
+
+void runCollisionBenchmark() {
+	const int counts[] = { 10, 100, 1000, 10000, 100000, 1000000 };
+	std::mt19937 rng(1234);
+	printf("%10s %14s %14s %8s\n", "segments", "linear ns/q", "grid ns/q", "hits");
+	for (int n : counts) {
+		float side = 2.0f * sqrtf((float)n) + arenaSize; // ~one segment per 4 square units
+		std::uniform_real_distribution<float> pos(0.0f, side), len(0.4f, 2.0f);
+		coralSegments.clear();
+		for (int i = 0;i < n;i++) {
+			CoralSegment s;
+			bool alongX = (rng() & 1) != 0;
+			s.x = pos(rng); s.z = pos(rng); s.y = 0.0f;
+			s.w = alongX ? len(rng) : wallTh; s.d = alongX ? wallTh : len(rng); s.h = 0.9f;
+			s.visible = true;
+			coralSegments.push_back(s);
+		}
+		buildCollisionGrid();
+
+		std::vector<AABB> queries;
+		for (int q = 0;q < 20000;q++) {
+			float x = pos(rng), z = pos(rng);
+			queries.push_back(AABB{ x - 0.14f, 0.0f, z - 0.14f, x + 0.14f, 0.96f, z + 0.14f });
+		}
+		// keep the linear pass to ~2e8 box tests
+		int linearQueries = std::max(10, std::min((int)queries.size(), 200000000 / n));
+
+		int hitsLinear = 0, hitsGrid = 0;
+		auto t0 = std::chrono::steady_clock::now();
+		for (int q = 0;q < linearQueries;q++) hitsLinear += linearCollides(queries[q]);
+		auto t1 = std::chrono::steady_clock::now();
+		for (const auto& q : queries) hitsGrid += gridCollides(q);
+		auto t2 = std::chrono::steady_clock::now();
+
+		// sanity: both paths agree on the shared prefix
+		int hitsGridPrefix = 0;
+		for (int q = 0;q < linearQueries;q++) hitsGridPrefix += gridCollides(queries[q]);
+
+		double linearNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / linearQueries;
+		double gridNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / queries.size();
+		printf("%10d %14.1f %14.1f %8d%s\n", n, linearNs, gridNs, hitsGrid,
+			hitsGridPrefix == hitsLinear ? "" : "  MISMATCH");
+	}
+}
+
+///////////////
+// Batch AABB benchmark (--bench-aabb)
+// One query box against every coral box: the AoS aabbIntersects loop over CoralSegment
+// versus the SoA store with each supported kernel. All variants must count the same hits.
+///////////////
+void runAabbBenchmark() {
+	const int counts[] = { 10000, 1000000 };
+	std::mt19937 rng(4321);
+	printf("%10s %-8s %12s %12s %9s %10s\n", "boxes", "kernel", "ns/query", "Mbox/s", "speedup", "hits");
+	for (int n : counts) {
+		float side = 2.0f * sqrtf((float)n);
+		std::uniform_real_distribution<float> pos(0.0f, side), len(0.4f, 2.0f);
+		std::vector<CoralSegment> segments;
+		AabbSoA soa;
+		soa.reserve(n);
+		for (int i = 0;i < n;i++) {
+			CoralSegment s;
+			bool alongX = (rng() & 1) != 0;
+			s.x = pos(rng); s.z = pos(rng); s.y = 0.0f;
+			s.w = alongX ? len(rng) : wallTh; s.d = alongX ? wallTh : len(rng); s.h = 0.9f;
+			s.visible = (rng() % 10) != 0; // some hidden, like collected/toggled entities
+			segments.push_back(s);
+			soa.push(getCoralAABB(s), s.visible);
+		}
+		// larger than the player box so every query has a few hits to report
+		std::vector<AABB> queries;
+		int queryCount = std::max(20, 200000000 / n); // ~2e8 box tests per variant
+		for (int q = 0;q < queryCount;q++) {
+			float x = pos(rng), z = pos(rng);
+			queries.push_back(AABB{ x - 2.0f, 0.0f, z - 2.0f, x + 2.0f, 0.96f, z + 2.0f });
+		}
+		std::vector<int> hitBuf(n);
+
+		long long hitsAos = 0;
+		auto t0 = std::chrono::steady_clock::now();
+		for (const auto& q : queries)
+			for (const auto& c : segments)
+				if (c.visible && aabbIntersects(q, getCoralAABB(c))) hitsAos++;
+		double aosNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / queryCount;
+		printf("%10d %-8s %12.0f %12.1f %9s %10lld\n", n, "aos", aosNs, n / aosNs * 1e3, "1.00x", hitsAos);
+
+		for (int k = 0;k < AABB_KERNEL_COUNT;k++) {
+			AabbKernel kernel = (AabbKernel)k;
+			if (!aabbKernelSupported(kernel)) continue;
+			long long hits = 0;
+			auto t1 = std::chrono::steady_clock::now();
+			for (const auto& q : queries) hits += aabbBatchOverlaps(kernel, soa, q, 0, n, hitBuf.data());
+			double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t1).count() / queryCount;
+			printf("%10d %-8s %12.0f %12.1f %8.2fx %10lld%s\n", n, aabbKernelName(kernel), ns, n / ns * 1e3,
+				aosNs / ns, hits, hits == hitsAos ? "" : "  MISMATCH");
+		}
+	}
+	printf("startup kernel: %s\n", aabbKernelName(aabbKernel));
+}
+
+///////////////
+// BVH benchmark (--bench-bvh)
+// Random walls at constant density like --bench-collision. Rays are camera-length segments
+// (up to 8 units, slightly tilted): nearest hit through the coral BVH versus testing every
+// wall, which must agree on the hit distance. Box queries are checked against the grid.
+///////////////
+void runBvhBenchmark() {
+	const int counts[] = { 10, 100, 1000, 10000, 100000, 1000000 };
+	std::mt19937 rng(2468);
+	printf("%10s %10s %6s %14s %12s %12s %8s\n", "segments", "build ms", "depth", "brute ns/ray", "bvh ns/ray", "box ns/q", "hits");
+	for (int n : counts) {
+		float side = 2.0f * sqrtf((float)n) + arenaSize;
+		std::uniform_real_distribution<float> pos(0.0f, side), len(0.4f, 2.0f), unit(-1.0f, 1.0f);
+		coralSegments.clear();
+		for (int i = 0;i < n;i++) {
+			CoralSegment s;
+			bool alongX = (rng() & 1) != 0;
+			s.x = pos(rng); s.z = pos(rng); s.y = 0.0f;
+			s.w = alongX ? len(rng) : wallTh; s.d = alongX ? wallTh : len(rng); s.h = 0.9f;
+			s.visible = true;
+			coralSegments.push_back(s);
+		}
+		buildCollisionGrid();
+		layoutRevision++;
+		auto t0 = std::chrono::steady_clock::now();
+		updateCoralBvh();
+		double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+		std::vector<BvhRay> rays;
+		for (int q = 0;q < 20000;q++) {
+			float a = unit(rng) * 3.14159265f, reach = 8.0f * (0.25f + 0.75f * (unit(rng) * 0.5f + 0.5f));
+			rays.push_back(BvhRay{ pos(rng), 0.5f, pos(rng), cosf(a) * reach, unit(rng) * 0.3f, sinf(a) * reach, 1.0f });
+		}
+		int bruteRays = std::max(10, std::min((int)rays.size(), 200000000 / n));
+
+		std::vector<float> bruteT(bruteRays);
+		auto t1 = std::chrono::steady_clock::now();
+		for (int q = 0;q < bruteRays;q++) {
+			const BvhRay& r = rays[q];
+			float ix = 1.0f / r.dx, iy = r.dy != 0.0f ? 1.0f / r.dy : 1e30f, iz = 1.0f / r.dz;
+			float best = 2.0f, t;
+			for (const auto& c : coralSegments)
+				if (c.visible && rayBoxSlab(getCoralAABB(c), r.ox, r.oy, r.oz, ix, iy, iz, std::min(best, r.maxT), t)) best = std::min(best, t);
+			bruteT[q] = best;
+		}
+		auto t2 = std::chrono::steady_clock::now();
+		int hits = 0;
+		BvhHit hit;
+		for (const auto& r : rays) hits += bvhRaycast(coralBvh, r, collisionGrid.boxes.visible.data(), hit);
+		auto t3 = std::chrono::steady_clock::now();
+
+		// box queries: camera-sized boxes at the ray origins
+		std::vector<int> ids;
+		long long boxHits = 0;
+		for (const auto& r : rays) {
+			coralQuery(AABB{ r.ox - 0.5f, 0.0f, r.oz - 0.5f, r.ox + 0.5f, 1.0f, r.oz + 0.5f }, ids);
+			boxHits += ids.size();
+		}
+		auto t4 = std::chrono::steady_clock::now();
+
+		bool agree = true;
+		for (int q = 0;q < bruteRays && agree;q++) {
+			bool found = bvhRaycast(coralBvh, rays[q], collisionGrid.boxes.visible.data(), hit);
+			agree = found ? hit.t == bruteT[q] : bruteT[q] > 1.0f;
+		}
+		long long gridHits = 0;
+		for (int q = 0;q < 1000;q++) {
+			const BvhRay& r = rays[q];
+			gridQuery(AABB{ r.ox - 0.5f, 0.0f, r.oz - 0.5f, r.ox + 0.5f, 1.0f, r.oz + 0.5f }, ids);
+			for (int id : ids) gridHits += id < collisionGrid.kindBase[COLLIDER_MAJOR]; // coral only
+			coralQuery(AABB{ r.ox - 0.5f, 0.0f, r.oz - 0.5f, r.ox + 0.5f, 1.0f, r.oz + 0.5f }, ids);
+			gridHits -= ids.size();
+		}
+		agree = agree && gridHits == 0;
+
+		double bruteNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / bruteRays;
+		double bvhNs = std::chrono::duration<double, std::nano>(t3 - t2).count() / rays.size();
+		double boxNs = std::chrono::duration<double, std::nano>(t4 - t3).count() / rays.size();
+		printf("%10d %10.1f %6d %14.1f %12.1f %12.1f %8d%s\n", n, buildMs, coralBvh.depth, bruteNs, bvhNs, boxNs, hits,
+			agree ? "" : "  MISMATCH");
+	}
+}
+
+///////////////
+// Crowd benchmarks' rounds: the nav fields are built before the clock starts, and a round
+// never ends (a collected goal comes back a second later, the timer is held), so every crowd
+// runs the same number of ticks however fast it finds the goals.
+///////////////
+const long long crowdBenchTicks = 300;
+const long long crowdGoalRespawn = 60; // ticks
+
+static std::vector<long long> goalReturnTick; // per goal, 0 while it is out
+
+static void beginCrowdRound() {
+	resetGame();
+	clearInputKeys();
+	goalReturnTick.assign(goals.size(), 0);
+	syncNav();
+}
+
+// after every tick; the goals it collected are counted and left out of collectedGoals
+static int keepCrowdRound() {
+	int collected = collectedGoals;
+	collectedGoals = 0;
+	for (size_t i = 0;i < goals.size();i++) {
+		if (goals[i].visible) continue;
+		if (goalReturnTick[i] == 0) goalReturnTick[i] = simTick + crowdGoalRespawn;
+		else if (simTick >= goalReturnTick[i]) {
+			goalReturnTick[i] = 0;
+			goals[i].visible = true;
+			goalBoxes.setVisible((int)i, true);
+		}
+	}
+	gameTime = 90.0f;
+	gameOver = gameWin = false;
+	return collected;
+}
+
+///////////////
+// Crowd benchmark (--bench-agents)
+// Steps growing crowds of autonomous divers on the --maze layout (256 x 256 cells by default),
+// on one thread and on --sim-threads (default: every core), and reports agent-ticks per
+// second, the job workers' utilisation (time inside jobs over the run, mean and the least
+// busy worker), the heap allocations after the first tick (none: the collision scratch and
+// the job queues are sized before the jobs run) and the goals collected. The crowd moves the same for any thread count,
+// so both runs end in the same state.
+///////////////
+void runAgentBenchmark() {
+	if (levelMaze.cells == 0 && !levelFilePath) levelMaze.cells = 256;
+	const int counts[] = { 1, 100, 1000, 10000, 100000 };
+	const float dt = 1.0f / 60.0f;
+	const long long ticks = crowdBenchTicks;
+	int cores = simThreads > 0 ? simThreads : (int)std::max(1u, std::thread::hardware_concurrency());
+	printf("%8s %8s %7s %10s %16s %8s %11s %6s %6s %9s\n", "agents", "threads", "ticks", "us/tick", "agent-ticks/s", "speedup",
+		"util avg/min", "heap", "goals", "state");
+	std::vector<JobWorkerStats> workers;
+	for (int n : counts) {
+		double serialRate = 0.0;
+		unsigned serialState = 0;
+		for (int threads : { 1, cores }) {
+			if (threads == 1 && serialRate > 0.0) break; // one core: the threaded run is the serial one
+			agentCount = n;
+			simThreads = threads;
+			beginCrowdRound();
+			resetJobStats();
+			auto t0 = std::chrono::steady_clock::now();
+			long long heapStart = heapAllocations();
+			int collected = 0;
+			while (simTick < ticks) {
+				simulateStep(dt);
+				collected += keepCrowdRound();
+				if (simTick == 1) heapStart = heapAllocations();
+			}
+			double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+			long long heap = heapAllocations() - heapStart;
+			jobStats(workers);
+			double busy = 0.0, least = 1e30;
+			for (const auto& w : workers) { busy += w.busyMs; least = std::min(least, w.busyMs); }
+			char util[32] = "-"; // the serial path does not go through the pool
+			if (busy > 0.0) sprintf(util, "%3.0f%%/%3.0f%%", busy / workers.size() / (secs * 10.0), least / (secs * 10.0));
+			double rate = (double)n * simTick / secs;
+			unsigned state = stateChecksum();
+			if (threads == 1) { serialRate = rate; serialState = state; }
+			printf("%8d %8d %7lld %10.1f %16.0f %7.2fx %11s %6lld %6d %08x%s\n", n, threads, simTick, secs * 1e6 / simTick, rate,
+				rate / serialRate, util, heap, collected, state, state == serialState ? "" : "  MISMATCH");
+		}
+	}
+}
+
+///////////////
+// Snapshot benchmark (--bench-snapshot)
+// Per crowd size on the --maze layout (256 x 256 cells by default), in the crowd benchmarks'
+// endless round: the simulation runs on its own thread, publishing a snapshot
+// (coral_snapshot.h) after every tick, while this thread takes the newest one as fast as it
+// can, the way a renderer on another core would. Every snapshot taken is checked against
+// the divers' poses of a first, unpublished run (both ticks it holds must match, or it was
+// torn), and the slots' buffers must not move once filled (no steady-state allocation).
+// Reports the tick and publish costs.
+///////////////
+static unsigned poseHash(const AgentPose* p, size_t n) {
+	unsigned h = 2166136261u;
+	const unsigned char* b = (const unsigned char*)p;
+	for (size_t i = 0;i < n * sizeof(AgentPose);i++) h = (h ^ b[i]) * 16777619u;
+	return h;
+}
+
+static unsigned livePoseHash() {
+	static std::vector<AgentPose> poses;
+	poses.resize(agents.size());
+	for (size_t i = 0;i < agents.size();i++) poses[i] = AgentPose{ agents[i].x, agents[i].y, agents[i].z, agents[i].angleY, agents[i].pitch };
+	return poseHash(poses.data(), poses.size());
+}
+
+void runSnapshotBenchmark() {
+	if (levelMaze.cells == 0 && !levelFilePath) levelMaze.cells = 256;
+	const int counts[] = { 1, 1000, 10000, 100000 };
+	const float dt = 1.0f / 60.0f;
+	const long long ticks = crowdBenchTicks;
+	printf("%8s %7s %10s %12s %8s %8s %6s %6s\n", "agents", "ticks", "us/tick", "us/publish", "reads", "fresh", "torn", "grown");
+	for (int n : counts) {
+		agentCount = n;
+
+		// reference run: the poses after every tick
+		std::vector<unsigned> expected;
+		beginCrowdRound();
+		expected.push_back(livePoseHash());
+		while (simTick < ticks) {
+			simulateStep(dt);
+			keepCrowdRound();
+			expected.push_back(livePoseHash());
+		}
+
+		beginCrowdRound();
+		publishSnapshot(true);
+		std::atomic<bool> done{ false };
+		double stepSecs = 0.0, publishSecs = 0.0;
+		std::thread sim([&] {
+			while (simTick < ticks) {
+				auto t0 = std::chrono::steady_clock::now();
+				simulateStep(dt);
+				auto t1 = std::chrono::steady_clock::now();
+				keepCrowdRound();
+				auto t2 = std::chrono::steady_clock::now();
+				publishSnapshot();
+				stepSecs += std::chrono::duration<double>(t1 - t0).count();
+				publishSecs += std::chrono::duration<double>(std::chrono::steady_clock::now() - t2).count();
+			}
+			done = true;
+			});
+
+		// the buffers each slot had when first seen
+		struct SlotBuffers { const void* curr; const void* prev; const void* majors; const void* goals; };
+		std::map<const SimSnapshot*, SlotBuffers> seen;
+		long long reads = 0, fresh = 0, torn = 0, grown = 0;
+		unsigned lastSequence = 0;
+		for (bool last = false;!last;) {
+			last = done.load(); // one more read after the simulation stopped: its final snapshot
+			const SimSnapshot& snap = acquireSnapshot();
+			reads++;
+			if (snap.sequence == lastSequence) {
+				std::this_thread::yield();
+				continue;
+			}
+			lastSequence = snap.sequence;
+			fresh++;
+			long long t = snap.simTick;
+			bool whole = t < (long long)expected.size()
+				&& poseHash(snap.curr.agents.data(), snap.curr.agents.size()) == expected[t]
+				&& poseHash(snap.prev.agents.data(), snap.prev.agents.size()) == expected[t > 0 ? t - 1 : 0];
+			if (!whole) torn++;
+			SlotBuffers b{ snap.curr.agents.data(), snap.prev.agents.data(), snap.curr.majors.data(), snap.curr.goals.data() };
+			auto it = seen.find(&snap);
+			if (it == seen.end()) seen[&snap] = b;
+			else if (memcmp(&it->second, &b, sizeof(b)) != 0) {
+				grown++;
+				it->second = b;
+			}
+		}
+		sim.join();
+		printf("%8d %7lld %10.1f %12.1f %8lld %8lld %6lld %6lld%s\n", n, simTick, stepSecs * 1e6 / simTick, publishSecs * 1e6 / simTick,
+			reads, fresh, torn, grown, torn || grown ? "  MISMATCH" : "");
+	}
+}
+
+///////////////
+// Navigation benchmark (--bench-nav)
+// Per maze size (--maze N, or 32/128/512): rasterising the nav grid and the per-goal BFS
+// fields, the incremental nearest-goal update when a goal is collected and when it comes
+// back against the full pass (both must give the same field), flow-field steps, and A* on
+// one thread and on --sim-threads (default: every core) for random free cell pairs. Paths
+// to a goal must agree with its BFS field on reachability and never be longer.
+///////////////
+static bool sameNearestField(const std::vector<int32_t>& dist, const std::vector<int>& goal) {
+	for (size_t c = 0;c < dist.size();c++)
+		if (navGoalDistance((int)c) != dist[c] || navNearestGoal((int)c) != goal[c]) return false;
+	return true;
+}
+
+void runNavBenchmark() {
+	std::vector<int> sizes = { 32, 128, 512 };
+	if (levelMaze.cells > 0) sizes.assign(1, levelMaze.cells);
+	int cores = simThreads > 0 ? simThreads : (int)std::max(1u, std::thread::hardware_concurrency());
+	for (int size : sizes) {
+		levelMaze.cells = size;
+		resetGame();
+		syncNav();
+		const int cells = navGrid.nx * navGrid.nz;
+		int freeCells = 0;
+		for (uint8_t b : navGrid.blocked) freeCells += b ? 0 : 1;
+		printf("maze %d: nav grid %d x %d (%.2f units, %d free), %zu goals: rasterise %.1f ms, goal fields %.1f ms\n",
+			size, navGrid.nx, navGrid.nz, navGrid.cellSize, freeCells, goals.size(), navStats.gridMs, navStats.fieldsMs);
+
+		// collect goal 0, then bring it back: incremental update vs the full pass
+		std::vector<int32_t> dist(cells);
+		std::vector<int> nearest(cells);
+		for (int visible = 0;visible < 2;visible++) {
+			goals[0].visible = visible != 0;
+			goalBoxes.setVisible(0, goals[0].visible);
+			syncNav();
+			double incMs = navStats.updateMs;
+			int updated = navStats.updatedCells;
+			for (int c = 0;c < cells;c++) { dist[c] = navGoalDistance(c); nearest[c] = navNearestGoal(c); }
+			auto t0 = std::chrono::steady_clock::now();
+			rebuildNearestGoalField();
+			double fullMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+			printf("  goal %s: incremental %.2f ms (%d cells), full %.2f ms%s\n", visible ? "shown" : "hidden", incMs, updated,
+				fullMs, sameNearestField(dist, nearest) ? "" : "  MISMATCH");
+		}
+
+		// random free cells: flow steps, then A* pairs (every fourth one to goal 0)
+		std::mt19937 rng(97531 + size);
+		std::vector<int> freeList;
+		for (int c = 0;c < cells;c++)
+			if (!navGrid.blocked[c]) freeList.push_back(c);
+		std::uniform_int_distribution<int> pick(0, (int)freeList.size() - 1);
+		std::vector<int> probes(100000);
+		for (int& p : probes) p = freeList[pick(rng)];
+		long long sum = 0;
+		auto t0 = std::chrono::steady_clock::now();
+		for (int p : probes) sum += navNextCell(p);
+		double stepNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / probes.size();
+		printf("  flow step %.1f ns (checksum %lld)\n", stepNs, sum & 0xFFFF);
+
+		int goalCell = navCellAt(goals[0].x, goals[0].z);
+		std::vector<NavQuery> queries(std::max(32, 2000000 / cells)); // maze paths grow with the grid
+		for (size_t q = 0;q < queries.size();q++)
+			queries[q] = NavQuery{ freeList[pick(rng)], q % 4 == 0 && !navGrid.blocked[goalCell] ? goalCell : freeList[pick(rng)] };
+		printf("  %8s %8s %12s %10s %8s %8s\n", "threads", "queries", "us/query", "speedup", "found", "avg len");
+		std::vector<std::vector<int>> serialPaths, paths;
+		double serialUs = 0.0;
+		for (int threads : { 1, cores }) {
+			if (threads == 1 && serialUs > 0.0) break;
+			std::vector<std::vector<int>>& out = threads == 1 ? serialPaths : paths;
+			simThreads = threads;
+			auto t1 = std::chrono::steady_clock::now();
+			navFindPaths(queries, out);
+			double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t1).count() / queries.size();
+			if (threads == 1) serialUs = us;
+			int found = 0;
+			double len = 0.0;
+			bool agree = threads == 1 || out == serialPaths;
+			const std::vector<int32_t>& field = navGoalField(0);
+			for (size_t q = 0;q < queries.size();q++) {
+				if (out[q].empty()) continue;
+				found++;
+				len += navPathLength(out[q]);
+				if (queries[q].to == goalCell && navPathLength(out[q]) > field[queries[q].from] + 1e-3f) agree = false;
+			}
+			for (size_t q = 0;q < queries.size();q++)
+				if (queries[q].to == goalCell && out[q].empty() != (field[queries[q].from] == navUnreachable)) agree = false;
+			printf("  %8d %8zu %12.1f %9.2fx %8d %8.1f%s\n", threads, queries.size(), us, serialUs / us, found,
+				found ? len / found : 0.0, agree ? "" : "  MISMATCH");
+		}
+	}
+}
+
+///////////////
+// Level loading benchmark (--bench-level file)
+// Maps a binary level and runs a pass of collision queries straight out of the mapping
+// (the first touch pages the grid in), then rebuilds the same collision grid from the
+// coral the way a layout without a level file is set up, and checks both answer alike.
+///////////////
+int runLevelBenchmark(const char* path) {
+	auto t0 = std::chrono::steady_clock::now();
+	if (!loadLevelFile(path)) return 1;
+	auto t1 = std::chrono::steady_clock::now();
+
+	const int queryCount = 200000;
+	std::mt19937 rng(99);
+	std::uniform_real_distribution<float> pos(0.0f, arenaSize);
+	std::vector<AABB> queries;
+	for (int q = 0;q < queryCount;q++) {
+		float x = pos(rng), z = pos(rng);
+		queries.push_back(AABB{ x - 0.15f, 0.0f, z - 0.15f, x + 0.15f, 0.96f, z + 0.15f });
+	}
+	int hitsMapped = 0;
+	auto t2 = std::chrono::steady_clock::now();
+	for (const auto& q : queries) hitsMapped += gridCollides(q);
+	auto t3 = std::chrono::steady_clock::now();
+
+	buildCollisionGrid();
+	auto t4 = std::chrono::steady_clock::now();
+	int hitsBuilt = 0;
+	for (const auto& q : queries) hitsBuilt += gridCollides(q);
+
+	auto ms = [](std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+		return std::chrono::duration<double, std::milli>(b - a).count();
+		};
+	printf("%s: %zu coral, %d colliders, %d x %d grid cells, %zu grid slots\n", path, coralSegments.size(),
+		collisionGrid.boxes.count, collisionGrid.nx, collisionGrid.nz, collisionGrid.items.size());
+	printf("map + validate       %10.2f ms\n", ms(t0, t1));
+	printf("first %d queries %10.2f ms (%d hits)\n", queryCount, ms(t2, t3), hitsMapped);
+	printf("rebuild grid         %10.2f ms (%d hits%s)\n", ms(t3, t4), hitsBuilt,
+		hitsBuilt == hitsMapped ? "" : ", MISMATCH");
+	return hitsBuilt == hitsMapped ? 0 : 1;
+}
+
+///////////////
+// Maze generator benchmark (--bench-maze)
+// Generates an N x N maze (default 1000) with each algorithm on one thread and on all
+// hardware threads, checks both give the same maze and every cell is reachable, and
+// reports the wall count before and after merging.
+///////////////
+void runMazeBenchmark() {
+	MazeParams p = levelMaze;
+	if (p.cells <= 0) p.cells = 1000;
+	int hw = std::max(1, (int)std::thread::hardware_concurrency());
+	printf("maze %dx%d cells, tile %d, seed %u\n", p.cells, p.cells, p.tileCells, p.seed);
+	printf("%-12s %10s %10s %8s %12s %12s %10s %10s\n", "algorithm", "1 thr ms", "N thr ms", "threads",
+		"walls", "merged", "merge ms", "reachable");
+	for (int a = 0;a < MAZE_ALGORITHM_COUNT;a++) {
+		p.algorithm = (MazeAlgorithm)a;
+		MazeGrid serial, parallel;
+		p.threads = 1;
+		auto t0 = std::chrono::steady_clock::now();
+		generateMaze(p, serial);
+		auto t1 = std::chrono::steady_clock::now();
+		p.threads = hw;
+		generateMaze(p, parallel);
+		auto t2 = std::chrono::steady_clock::now();
+
+		LevelArray<CoralSegment> segments;
+		mazeToSegments(parallel, p, segments);
+		auto t3 = std::chrono::steady_clock::now();
+
+		std::vector<int> dist;
+		mazeDistances(parallel, (p.cells / 2) * p.cells + p.cells / 2, dist);
+		long long reachable = std::count_if(dist.begin(), dist.end(), [](int d) { return d >= 0; });
+
+		auto ms = [](std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+			return std::chrono::duration<double, std::milli>(b - a).count();
+			};
+		printf("%-12s %10.1f %10.1f %8d %12d %12zu %10.1f %9.1f%%%s\n", mazeAlgorithmName(p.algorithm),
+			ms(t0, t1), ms(t1, t2), hw, mazeUnmergedWallCount(parallel), segments.size(), ms(t2, t3),
+			100.0 * reachable / dist.size(), serial.walls == parallel.walls ? "" : "  THREAD MISMATCH");
+	}
+}
+
+int main(int argc, char** argv) {
+	std::vector<InputScript> scripts;
+	std::vector<InputLog> replays;
+	std::vector<const char*> replayNames;
+	const char* recordFile = nullptr;
+	int sessions = 1;
+	long long maxTicks = -1;
+	float simHz = 60.0f;
+	bool quiet = false;
+
+	for (int i = 1;i < argc;i++) {
+		if (strcmp(argv[i], "--bench-collision") == 0) {
+			initSceneObjects();
+			runCollisionBenchmark();
+			return 0;
+		}
+		else if (strcmp(argv[i], "--bench-maze") == 0) {
+			for (int k = i + 1;k < argc;k++) parseMazeArg(k, argc, argv);
+			runMazeBenchmark();
+			return 0;
+		}
+		else if (strcmp(argv[i], "--bench-aabb") == 0) {
+			runAabbBenchmark();
+			return 0;
+		}
+		else if (strcmp(argv[i], "--bench-bvh") == 0) {
+			runBvhBenchmark();
+			return 0;
+		}
+		else if (strcmp(argv[i], "--bench-nav") == 0) {
+			for (int k = i + 1;k < argc;k++) parseMazeArg(k, argc, argv);
+			runNavBenchmark();
+			return 0;
+		}
+		else if (strcmp(argv[i], "--bench-snapshot") == 0) {
+			for (int k = i + 1;k < argc;k++) parseMazeArg(k, argc, argv);
+			runSnapshotBenchmark();
+			return 0;
+		}
+		else if (strcmp(argv[i], "--bench-agents") == 0) {
+			for (int k = i + 1;k < argc;k++) parseMazeArg(k, argc, argv);
+			runAgentBenchmark();
+			return 0;
+		}
+		else if (strcmp(argv[i], "--bench-level") == 0 && i + 1 < argc) return runLevelBenchmark(argv[i + 1]);
+		else if (parseMazeArg(i, argc, argv)) continue;
+		else if (strcmp(argv[i], "--script") == 0 && i + 1 < argc) {
+			scripts.emplace_back();
+			if (!loadScript(argv[++i], scripts.back())) return 1;
+		}
+		else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+			replays.emplace_back();
+			replayNames.push_back(argv[++i]);
+			if (!loadInputLog(argv[i], replays.back())) return 1;
+		}
+		else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordFile = argv[++i];
+		else if (strcmp(argv[i], "--sessions") == 0 && i + 1 < argc) sessions = std::max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) maxTicks = atoll(argv[++i]);
+		else if (strcmp(argv[i], "--sim-hz") == 0 && i + 1 < argc) simHz = std::max(1.0f, (float)atof(argv[++i]));
+		else if (strcmp(argv[i], "--player-speed") == 0 && i + 1 < argc) playerSpeed = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--quiet") == 0) quiet = true;
+		else {
+			fprintf(stderr, "usage: %s [--script file]... [--sessions N] [--ticks N] [--sim-hz HZ] [--player-speed S] [--quiet]\n"
+				"          [--record file] [--maze N] [--seed S] [--maze-algo backtracker|wilson|kruskal] [--maze-tile T]\n"
+				"          [--maze-threads K] [--level file.crlv [--stream MB] [--stream-radius R]] [--agents N] [--sim-threads K]\n"
+				"       %s --replay file [--replay file]... [--sessions N] [--quiet]\n"
+				"       %s --bench-collision\n"
+				"       %s --bench-maze [--maze N] [--maze-tile T]\n"
+				"       %s --bench-aabb\n"
+				"       %s --bench-bvh\n"
+				"       %s --bench-agents [--maze N] [--sim-threads K]\n"
+				"       %s --bench-nav [--maze N] [--sim-threads K]\n"
+				"       %s --bench-snapshot [--maze N] [--sim-threads K]\n"
+				"       %s --bench-level file.crlv\n", argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
+			return 1;
+		}
+	}
+
+	const float dt = 1.0f / simHz;
+	if (maxTicks < 0) maxTicks = (long long)ceil(90.0 * simHz) + 1; // one full round
+
+	long long totalTicks = 0;
+	int wins = 0;
+	auto t0 = std::chrono::steady_clock::now();
+	for (int s = 0;s < sessions;s++) {
+		const char* name = nullptr;
+		if (!replays.empty()) {
+			// recorded sessions: settings come from the log, ticks span any restarts
+			size_t r = s % replays.size();
+			name = replayNames[r];
+			replaySession(replays[r]);
+			totalTicks += sessionTick;
+		}
+		else {
+			const InputScript* script = scripts.empty() ? nullptr : &scripts[s % scripts.size()];
+			name = script ? script->name : nullptr;
+			if (recordFile && s == 0) beginInputRecording(simHz);
+			runSession(script, maxTicks, dt);
+			if (recordFile && s == 0) {
+				inputRecordingOn = false;
+				if (!saveInputRecording(recordFile)) return 1;
+			}
+			totalTicks += simTick;
+		}
+		wins += gameWin ? 1 : 0;
+		if (!quiet) {
+			printf("session %d%s%s: ticks %lld goals %d/%d %s time %.2f player (%.2f %.2f %.2f) state %08x\n",
+				s, name ? " " : "", name ? name : "", simTick, collectedGoals, totalGoals,
+				gameOver ? (gameWin ? "WIN" : "LOSE") : "RUNNING", gameTime, player().x, player().y, player().z,
+				stateChecksum());
+		}
+	}
+	double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+	printf("%d sessions, %lld ticks, %d wins in %.3f s: %.0f ticks/s, %.1f sessions/s\n",
+		sessions, totalTicks, wins, secs, totalTicks / secs, sessions / secs);
+	if (worldStreamActive()) {
+		const StreamStats& st = worldStreamStats();
+		printf("stream: %d chunks, %d resident (%.0f KB, peak %.0f KB of %.0f KB), %lld loads, %lld evictions, "
+			"%lld rebuilds averaging %.2f ms\n", st.chunks, st.resident, st.residentBytes / 1024.0, st.peakBytes / 1024.0,
+			streamBudgetBytes / 1024.0, st.loads, st.evictions, st.rebuilds, st.rebuilds ? st.rebuildMs / st.rebuilds : 0.0);
+	}
+	return 0;
+}
@@ -0,0 +1,285 @@
+#include "coral_jobs.h"
+#include "coral_sim.h"
+#include "coral_profiler.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <algorithm>
+
+///////////////
+// Graph building
+///////////////
+int JobGraph::addFor(const char* name, int count, int grain, std::function<void(int begin, int end)> fn,
+	std::initializer_list<int> deps) {
+	int id = (int)nodes.size();
+	nodes.emplace_back();
+	Node& n = nodes.back();
+	n.name = name;
+	n.fn = std::move(fn);
+	n.count = count;
+	n.grain = std::max(1, grain);
+	n.deps = (int)deps.size();
+	for (int d : deps) nodes[d].next.push_back(id);
+	return id;
+}
+
+int JobGraph::add(const char* name, std::function<void()> fn, std::initializer_list<int> deps) {
+	int id = addFor(name, 1, 1, nullptr, deps);
+	nodes[id].call = std::move(fn);
+	return id;
+}
+
+static void runNode(JobGraph::Node& n, int begin, int end) {
+	PROFILE_ZONE(n.name);
+	if (n.call) n.call();
+	else n.fn(begin, end);
+}
+
+///////////////
+// Worker deques
+// A ring buffer per worker behind its own lock: the owner pushes and pops at the tail,
+// thieves take from the head. It starts with room for jobQueueTasks, made with the pool
+// rather than at a worker's first split, doubles when full and keeps its size, so a steady
+// frame does not allocate.
+///////////////
+const size_t jobQueueTasks = 64;
+
+struct JobTask {
+	JobGraph* graph;
+	int node;
+	int begin, end;
+};
+
+struct alignas(64) JobQueue {
+	std::mutex mutex;
+	std::vector<JobTask> ring;
+	size_t head = 0, tail = 0; // tail - head tasks queued
+
+	void push(const JobTask& t) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (tail - head == ring.size()) {
+			std::vector<JobTask> grown(std::max(jobQueueTasks, ring.size() * 2));
+			for (size_t i = head;i < tail;i++) grown[i - head] = ring[i % ring.size()];
+			ring.swap(grown);
+			tail -= head;
+			head = 0;
+		}
+		ring[tail++ % ring.size()] = t;
+	}
+	bool pop(JobTask& t) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (tail == head) return false;
+		t = ring[--tail % ring.size()];
+		return true;
+	}
+	bool steal(JobTask& t) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (tail == head) return false;
+		t = ring[head++ % ring.size()];
+		return true;
+	}
+};
+
+///////////////
+// Pool
+// Workers spin (yielding) on their deque and the others' while any graph runs and sleep on
+// a condition variable otherwise. The pool follows simThreads, resized between graphs.
+///////////////
+static thread_local int jobWorker = 0; // this thread's deque
+static thread_local int jobDepth = 0; // tasks running on this thread (nested runs)
+
+static struct JobPool {
+	std::vector<std::thread> threads;
+	std::unique_ptr<JobQueue[]> queues; // [0] = the thread running the graph
+	std::vector<JobWorkerStats> stats;
+	int workers = 0;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::atomic<int> activeRuns{ 0 };
+	bool quit = false;
+
+	void stop() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+		}
+		wake.notify_all();
+		for (auto& t : threads) t.join();
+		threads.clear();
+		quit = false;
+	}
+	void resize(int count) {
+		stop();
+		workers = count;
+		queues.reset(new JobQueue[count]);
+		for (int w = 0;w < count;w++) queues[w].ring.resize(jobQueueTasks);
+		stats.assign(count, JobWorkerStats{ 0.0, 0, 0 });
+		for (int w = 1;w < count;w++) threads.emplace_back(&JobPool::work, this, w);
+	}
+	void work(int w);
+	~JobPool() { stop(); }
+} pool;
+
+static int wantedWorkers() {
+	return simThreads > 0 ? simThreads : (int)std::max(1u, std::thread::hardware_concurrency());
+}
+
+// only while no graph runs on the pool, from outside it (a serial graph may be running:
+// its nodes can still start parallel work)
+static void ensurePool() {
+	if (jobWorker == 0 && pool.activeRuns.load() == 0 && pool.workers != wantedWorkers())
+		pool.resize(wantedWorkers());
+}
+
+static void finishNode(JobGraph& g, int node, int w);
+
+static void startNode(JobGraph& g, int node, int w) {
+	JobGraph::Node& n = g.nodes[node];
+	if (n.count <= 0) {
+		finishNode(g, node, w);
+		return;
+	}
+	n.remaining = n.count;
+	pool.queues[w].push(JobTask{ &g, node, 0, n.count });
+}
+
+static void finishNode(JobGraph& g, int node, int w) {
+	for (int s : g.nodes[node].next)
+		if (g.nodes[s].waiting.fetch_sub(1) == 1) startNode(g, s, w);
+	g.unfinished.fetch_sub(1); // last: the run ends only after the successors are queued
+}
+
+// split down to the grain, leaving the upper halves to thieves, then run what is left
+static void execute(JobTask t, int w) {
+	JobGraph::Node& n = t.graph->nodes[t.node];
+	while (t.end - t.begin > n.grain) {
+		int mid = t.begin + (t.end - t.begin) / 2;
+		pool.queues[w].push(JobTask{ t.graph, t.node, mid, t.end });
+		t.end = mid;
+	}
+	long long start = jobDepth == 0 ? profilerNow() : 0;
+	jobDepth++;
+	runNode(n, t.begin, t.end);
+	jobDepth--;
+	JobWorkerStats& s = pool.stats[w];
+	if (start != 0) s.busyMs += (profilerNow() - start) * 1e-6;
+	s.tasks++;
+	int items = t.end - t.begin;
+	if (n.remaining.fetch_sub(items) == items) finishNode(*t.graph, t.node, w);
+}
+
+static bool runOne(int w) {
+	JobTask t;
+	if (!pool.queues[w].pop(t)) {
+		bool stolen = false;
+		for (int k = 1;k < pool.workers && !stolen;k++) stolen = pool.queues[(w + k) % pool.workers].steal(t);
+		if (!stolen) return false;
+		pool.stats[w].steals++;
+	}
+	execute(t, w);
+	return true;
+}
+
+static void addForGraph();
+
+void JobPool::work(int w) {
+	jobWorker = w;
+	// which worker first runs a job with a parallelFor in it is up to the scheduler, so each
+	// builds its outermost graph before taking work instead of in whichever frame that is
+	addForGraph();
+	for (;;) {
+		if (runOne(w)) continue;
+		if (activeRuns.load() > 0) {
+			std::this_thread::yield();
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(mutex);
+		wake.wait(lock, [&] { return quit || activeRuns.load() > 0; });
+		if (quit) return;
+	}
+}
+
+///////////////
+// Running graphs
+///////////////
+void runJobs(JobGraph& g) {
+	if (g.nodes.empty()) return;
+	ensurePool();
+	for (auto& n : g.nodes) n.waiting = n.deps;
+	g.unfinished = (int)g.nodes.size();
+	{
+		std::lock_guard<std::mutex> lock(pool.mutex);
+		pool.activeRuns++;
+	}
+	pool.wake.notify_all();
+
+	const int w = jobWorker;
+	for (int i = 0;i < (int)g.nodes.size();i++)
+		if (g.nodes[i].deps == 0) startNode(g, i, w);
+	while (g.unfinished.load() > 0)
+		if (!runOne(w)) std::this_thread::yield();
+
+	std::lock_guard<std::mutex> lock(pool.mutex);
+	pool.activeRuns--;
+}
+
+void runJobsSerial(JobGraph& g) {
+	jobDepth++;
+	for (auto& n : g.nodes)
+		if (n.count > 0) runNode(n, 0, n.count);
+	jobDepth--;
+}
+
+// one-node graphs kept per thread and nesting level (a job waiting on its parallelFor may
+// pick up another that starts one), built once: the node calls through body, so a call
+// neither builds a graph nor copies fn
+struct ForGraph {
+	JobGraph graph;
+	const std::function<void(int begin, int end)>* body = nullptr;
+};
+static thread_local std::vector<std::unique_ptr<ForGraph>> forGraphs;
+static thread_local size_t forDepth = 0;
+
+static void addForGraph() {
+	forGraphs.emplace_back(new ForGraph);
+	ForGraph* f = forGraphs.back().get();
+	f->graph.addFor("parallelFor", 0, 1, [f](int begin, int end) { (*f->body)(begin, end); });
+}
+
+void parallelFor(int count, int grain, const std::function<void(int begin, int end)>& fn) {
+	if (count <= 0) return;
+	if (count <= grain || jobWorkerCount() == 1) {
+		fn(0, count);
+		return;
+	}
+	if (forDepth == forGraphs.size()) addForGraph();
+	ForGraph& f = *forGraphs[forDepth++];
+	f.body = &fn;
+	f.graph.nodes[0].grain = std::max(1, grain);
+	f.graph.setCount(0, count);
+	runJobs(f.graph);
+	forDepth--;
+}
+
+int jobWorkerCount() {
+	ensurePool();
+	return pool.workers;
+}
+
+int jobWorkerIndex() {
+	return jobWorker;
+}
+
+///////////////
+// Utilisation
+///////////////
+void resetJobStats() {
+	ensurePool();
+	std::fill(pool.stats.begin(), pool.stats.end(), JobWorkerStats{ 0.0, 0, 0 });
+}
+
+void jobStats(std::vector<JobWorkerStats>& out) {
+	out = pool.stats;
+}
@@ -0,0 +1,57 @@
+#pragma once
+///////////////
+// Job system
+// A pool of simThreads - 1 workers plus the thread that runs a graph (worker 0). Each worker
+// owns a deque of tasks: it pushes and pops at the back, idle workers steal from the front
+// of the others'. Work is described as a JobGraph of nodes with dependencies; a node is one
+// call or a range of items split in halves down to its grain, the upper halves left on the
+// deque for thieves. A node's successors are released by whichever worker finishes its last
+// item. Graphs are built once and run every frame (the node counts may change between
+// runs); a job may run a graph of its own and helps with any task until it completes.
+// Only one thread outside the pool may run graphs at a time.
+///////////////
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <functional>
+#include <initializer_list>
+
+struct JobGraph {
+	struct Node {
+		const char* name; // profiler zone (a string literal)
+		std::function<void(int begin, int end)> fn; // range nodes
+		std::function<void()> call; // single-call nodes (add)
+		int count, grain; // items and the most one task takes
+		std::vector<int> next; // nodes waiting on this one
+		int deps;
+		std::atomic<int> waiting; // dependencies not finished yet in this run
+		std::atomic<int> remaining; // items not finished yet in this run
+	};
+	std::deque<Node> nodes; // stable addresses, the atomics stay put
+	std::atomic<int> unfinished{ 0 }; // nodes left in the current run
+
+	int add(const char* name, std::function<void()> fn, std::initializer_list<int> deps = {});
+	int addFor(const char* name, int count, int grain, std::function<void(int begin, int end)> fn,
+		std::initializer_list<int> deps = {});
+	void setCount(int node, int count) { nodes[node].count = count; } // before the run or from a predecessor
+};
+
+void runJobs(JobGraph& graph); // to completion, on the pool and the calling thread
+// every node in the order added on the calling thread (small frames, where waking the pool
+// costs more than the work); nodes may only depend on earlier ones
+void runJobsSerial(JobGraph& graph);
+// fn over [0, count) in pieces of at most grain, as a one-node graph kept per thread (no
+// allocation once warm)
+void parallelFor(int count, int grain, const std::function<void(int begin, int end)>& fn);
+
+int jobWorkerCount(); // the pool plus the running thread (simThreads, 0 = hardware concurrency)
+int jobWorkerIndex(); // 0 for threads outside the pool, 1.. for the workers
+
+struct JobWorkerStats {
+	double busyMs; // inside tasks
+	long long tasks, steals;
+};
+void resetJobStats();
+// per worker since resetJobStats (the pool may have been resized since: then only the
+// current workers); read while no graph is running
+void jobStats(std::vector<JobWorkerStats>& out);
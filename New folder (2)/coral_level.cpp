@@ -0,0 +1,535 @@
+#include "coral_level.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+///////////////
+// File mapping (copy-on-write, so in-place visibility flips never reach the file)
+///////////////
+struct MappedFile {
+	uint8_t* base;
+	size_t size;
+#ifdef _WIN32
+	HANDLE file, mapping;
+#endif
+};
+
+static bool mapFile(const char* path, MappedFile& m) {
+	m.base = nullptr;
+	m.size = 0;
+#ifdef _WIN32
+	m.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m.file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER size;
+	GetFileSizeEx(m.file, &size);
+	m.size = (size_t)size.QuadPart;
+	m.mapping = m.size ? CreateFileMappingA(m.file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr) : nullptr;
+	if (m.mapping) m.base = (uint8_t*)MapViewOfFile(m.mapping, FILE_MAP_COPY, 0, 0, 0);
+	if (!m.base) {
+		if (m.mapping) CloseHandle(m.mapping);
+		CloseHandle(m.file);
+		return false;
+	}
+	return true;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return false;
+	}
+	m.size = (size_t)st.st_size;
+	void* p = mmap(nullptr, m.size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) return false;
+	m.base = (uint8_t*)p;
+	return true;
+#endif
+}
+
+static void unmapFile(MappedFile& m) {
+	if (!m.base) return;
+#ifdef _WIN32
+	UnmapViewOfFile(m.base);
+	CloseHandle(m.mapping);
+	CloseHandle(m.file);
+#else
+	munmap(m.base, m.size);
+#endif
+	m.base = nullptr;
+}
+
+static MappedFile levelMapping = { nullptr, 0 }; // the level the scene currently points into
+
+float levelChunkSize = 32.0f;
+
+static int levelChunkOf(const CoralSegment& c, const LevelChunkTable& t) {
+	int cx = std::min(std::max((int)floorf((c.x + c.w / 2.0f) / t.size), 0), t.nx - 1);
+	int cz = std::min(std::max((int)floorf((c.z + c.d / 2.0f) / t.size), 0), t.nz - 1);
+	return cz * t.nx + cx;
+}
+
+// coral crossing a chunk edge is cut there, so a chunk's coral stays inside its square
+// (merged maze walls run across many chunks); false if nothing needed cutting
+static bool splitCoralAtChunks(const LevelChunkTable& t) {
+	std::vector<CoralSegment> out;
+	bool split = false;
+	// cuts inside (lo, hi) along one axis; widths are taken from the original edges so the
+	// pieces end exactly where the original box did
+	auto cuts = [&](float lo, float hi, int n, std::vector<float>& at) {
+		at.assign(1, lo);
+		int first = std::max((int)floorf(lo / t.size) + 1, 1), last = std::min((int)floorf(hi / t.size), n - 1);
+		for (int i = first;i <= last;i++)
+			if (i * t.size > lo && i * t.size < hi) at.push_back(i * t.size);
+		at.push_back(hi);
+		};
+	std::vector<float> xs, zs;
+	for (const auto& c : coralSegments) {
+		cuts(c.x, c.x + c.w, t.nx, xs);
+		cuts(c.z, c.z + c.d, t.nz, zs);
+		if (xs.size() == 2 && zs.size() == 2) {
+			out.push_back(c);
+			continue;
+		}
+		split = true;
+		for (size_t j = 0;j + 1 < zs.size();j++)
+			for (size_t i = 0;i + 1 < xs.size();i++) {
+				CoralSegment piece = c;
+				piece.x = xs[i]; piece.w = xs[i + 1] - xs[i];
+				piece.z = zs[j]; piece.d = zs[j + 1] - zs[j];
+				out.push_back(piece);
+			}
+	}
+	if (split) coralSegments.assign(out.begin(), out.end());
+	return split;
+}
+
+// cuts and groups the coral by chunk (stable, so an already grouped layout is left alone)
+// and fills the table
+static void buildChunkTable(LevelChunkTable& t) {
+	t.size = levelChunkSize;
+	t.nx = std::max(1, (int)ceilf(arenaSize / t.size));
+	t.nz = t.nx;
+	int chunks = t.nx * t.nz;
+	bool grouped = !splitCoralAtChunks(t);
+	bool sorted = true;
+	for (size_t i = 1;i < coralSegments.size() && sorted;i++)
+		sorted = levelChunkOf(coralSegments[i - 1], t) <= levelChunkOf(coralSegments[i], t);
+	if (!grouped || !sorted) {
+		std::stable_sort(coralSegments.begin(), coralSegments.end(), [&](const CoralSegment& a, const CoralSegment& b) {
+			return levelChunkOf(a, t) < levelChunkOf(b, t);
+			});
+		buildCollisionGrid(); // collider ids follow the coral order
+	}
+
+	t.start.assign(chunks + 1, 0);
+	t.bounds.resize(chunks * 4);
+	for (int k = 0;k < chunks;k++) {
+		float* b = &t.bounds[k * 4];
+		b[0] = (k % t.nx) * t.size; b[1] = (k / t.nx) * t.size;
+		b[2] = b[0] + t.size; b[3] = b[1] + t.size;
+	}
+	for (const auto& c : coralSegments) {
+		int k = levelChunkOf(c, t);
+		t.start[k + 1]++;
+		float* b = &t.bounds[k * 4];
+		b[0] = std::min(b[0], c.x); b[1] = std::min(b[1], c.z);
+		b[2] = std::max(b[2], c.x + c.w); b[3] = std::max(b[3], c.z + c.d);
+	}
+	for (int k = 0;k < chunks;k++) t.start[k + 1] += t.start[k];
+}
+
+///////////////
+// Binary writer
+///////////////
+static void addSection(std::vector<uint8_t>& out, LevelFileHeader& h, LevelSectionId id, const void* data, size_t bytes) {
+	out.resize((out.size() + levelAlignment - 1) / levelAlignment * levelAlignment, 0);
+	h.sections[id].offset = out.size();
+	h.sections[id].bytes = bytes;
+	const uint8_t* p = (const uint8_t*)data;
+	out.insert(out.end(), p, p + bytes);
+}
+
+// records are copied field by field into zeroed memory so struct padding is written as zeros
+// and the same level always compiles to the same bytes
+static void copyRecord(CoralSegment& d, const CoralSegment& s) {
+	d.x = s.x; d.y = s.y; d.z = s.z;
+	d.w = s.w; d.h = s.h; d.d = s.d;
+	d.visible = s.visible;
+}
+static void copyRecord(SceneObj& d, const SceneObj& s) {
+	d.x = s.x; d.y = s.y; d.z = s.z;
+	d.sx = s.sx; d.sy = s.sy; d.sz = s.sz;
+	d.visible = s.visible; d.animating = s.animating; d.animPhase = s.animPhase;
+}
+static void copyRecord(GoalObj& d, const GoalObj& s) {
+	d.x = s.x; d.y = s.y; d.z = s.z;
+	d.visible = s.visible; d.phase = s.phase;
+}
+
+template <class T>
+static void addRecords(std::vector<uint8_t>& out, LevelFileHeader& h, LevelSectionId id, const T* p, size_t n) {
+	std::vector<uint8_t> bytes(n * sizeof(T), 0);
+	for (size_t i = 0;i < n;i++) copyRecord(*(T*)&bytes[i * sizeof(T)], p[i]);
+	addSection(out, h, id, bytes.data(), bytes.size());
+}
+
+bool saveLevelFile(const char* path) {
+	LevelChunkTable chunks;
+	buildChunkTable(chunks);
+
+	const CollisionGrid& g = collisionGrid;
+	LevelFileHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, "CRLV", 4);
+	h.version = levelFileVersion;
+	h.headerBytes = sizeof(LevelFileHeader);
+	h.coralBytes = sizeof(CoralSegment);
+	h.objectBytes = sizeof(SceneObj);
+	h.goalBytes = sizeof(GoalObj);
+	h.arenaSize = arenaSize;
+	h.playerStartX = playerStartX;
+	h.playerStartZ = playerStartZ;
+	h.coralCount = (uint32_t)coralSegments.size();
+	h.majorCount = (uint32_t)majorObjs.size();
+	h.regCount = (uint32_t)regObjs.size();
+	h.goalCount = (uint32_t)goals.size();
+	h.boxCount = (uint32_t)g.boxes.count;
+	for (int k = 0;k <= COLLIDER_KIND_COUNT;k++) h.kindBase[k] = g.kindBase[k];
+	h.gridOriginX = g.originX;
+	h.gridOriginZ = g.originZ;
+	h.gridCellSize = g.cellSize;
+	h.gridNx = g.nx;
+	h.gridNz = g.nz;
+	h.gridItemCount = (uint32_t)g.items.size();
+	h.chunkSize = chunks.size;
+	h.chunkNx = chunks.nx;
+	h.chunkNz = chunks.nz;
+
+	std::vector<uint8_t> out(sizeof(LevelFileHeader));
+	addRecords(out, h, LEVEL_CORAL, coralSegments.data(), coralSegments.size());
+	addRecords(out, h, LEVEL_MAJORS, majorObjs.data(), majorObjs.size());
+	addRecords(out, h, LEVEL_REGS, regObjs.data(), regObjs.size());
+	addRecords(out, h, LEVEL_GOALS, goals.data(), goals.size());
+	addSection(out, h, LEVEL_ROCKS, majorRocks, sizeof(majorRocks));
+	// box arrays keep their padding to a multiple of aabbBatchWidth
+	const AlignedFloats* axes[6] = { &g.boxes.minx, &g.boxes.miny, &g.boxes.minz, &g.boxes.maxx, &g.boxes.maxy, &g.boxes.maxz };
+	for (int a = 0;a < 6;a++)
+		addSection(out, h, (LevelSectionId)(LEVEL_BOX_MINX + a), axes[a]->data(), axes[a]->size() * sizeof(float));
+	addSection(out, h, LEVEL_BOX_VISIBLE, g.boxes.visible.data(), g.boxes.visible.size() * sizeof(uint64_t));
+	addSection(out, h, LEVEL_CELL_START, g.cellStart.data(), g.cellStart.size() * sizeof(int));
+	addSection(out, h, LEVEL_CELL_COUNT, g.cellCount.data(), g.cellCount.size() * sizeof(int));
+	addSection(out, h, LEVEL_CELL_ITEMS, g.items.data(), g.items.size() * sizeof(int));
+	addSection(out, h, LEVEL_CHUNK_START, chunks.start.data(), chunks.start.size() * sizeof(int));
+	addSection(out, h, LEVEL_CHUNK_BOUNDS, chunks.bounds.data(), chunks.bounds.size() * sizeof(float));
+	memcpy(out.data(), &h, sizeof(h));
+
+	FILE* f = fopen(path, "wb");
+	if (!f) {
+		fprintf(stderr, "cannot write level %s\n", path);
+		return false;
+	}
+	bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+	ok = (fclose(f) == 0) && ok;
+	if (!ok) fprintf(stderr, "cannot write level %s\n", path);
+	return ok;
+}
+
+///////////////
+// Binary loader: validate the header and section table, then borrow the arrays in place
+///////////////
+static bool levelError(const char* path, const char* what) {
+	fprintf(stderr, "%s: %s\n", path, what);
+	return false;
+}
+
+// header and section table against the file size
+static bool checkLevelHeader(const char* path, const LevelFileHeader& h, uint64_t fileSize) {
+	if (fileSize < sizeof(LevelFileHeader)) return levelError(path, "not a level file");
+	if (memcmp(h.magic, "CRLV", 4) != 0) return levelError(path, "not a level file");
+	if (h.version != levelFileVersion || h.headerBytes != sizeof(LevelFileHeader))
+		return levelError(path, "unsupported level version");
+	if (h.coralBytes != sizeof(CoralSegment) || h.objectBytes != sizeof(SceneObj) || h.goalBytes != sizeof(GoalObj))
+		return levelError(path, "level written with a different record layout");
+
+	size_t padded = (h.boxCount + aabbBatchWidth - 1) / aabbBatchWidth * aabbBatchWidth;
+	if (h.gridNx <= 0 || h.gridNz <= 0) return levelError(path, "bad collision grid");
+	if (h.chunkNx <= 0 || h.chunkNz <= 0 || !(h.chunkSize > 0.0f)) return levelError(path, "bad chunk table");
+	size_t cells = (size_t)h.gridNx * h.gridNz;
+	size_t chunks = (size_t)h.chunkNx * h.chunkNz;
+	const uint64_t expected[LEVEL_SECTION_COUNT] = {
+		(uint64_t)h.coralCount * sizeof(CoralSegment), (uint64_t)h.majorCount * sizeof(SceneObj),
+		(uint64_t)h.regCount * sizeof(SceneObj), (uint64_t)h.goalCount * sizeof(GoalObj), sizeof(majorRocks),
+		padded * sizeof(float), padded * sizeof(float), padded * sizeof(float),
+		padded * sizeof(float), padded * sizeof(float), padded * sizeof(float),
+		(padded + 63) / 64 * sizeof(uint64_t), (cells + 1) * sizeof(int), cells * sizeof(int),
+		(uint64_t)h.gridItemCount * sizeof(int), (chunks + 1) * sizeof(int), chunks * 4 * sizeof(float)
+	};
+	for (int s = 0;s < LEVEL_SECTION_COUNT;s++) {
+		const LevelSection& sec = h.sections[s];
+		if (sec.bytes != expected[s] || sec.offset % levelAlignment != 0 || sec.offset > fileSize || sec.bytes > fileSize - sec.offset)
+			return levelError(path, "truncated or corrupt level");
+	}
+	const int* kind = h.kindBase;
+	if (kind[COLLIDER_CORAL] != 0 || kind[COLLIDER_MAJOR] != (int)h.coralCount ||
+		kind[COLLIDER_ROCK] != (int)(h.coralCount + h.majorCount) || kind[COLLIDER_KIND_COUNT] != (int)h.boxCount ||
+		h.boxCount != h.coralCount + h.majorCount + 3)
+		return levelError(path, "collider table does not match the objects");
+	return true;
+}
+
+static bool checkLevel(const char* path, const MappedFile& m) {
+	if (m.size < sizeof(LevelFileHeader)) return levelError(path, "not a level file");
+	const LevelFileHeader& h = *(const LevelFileHeader*)m.base;
+	if (!checkLevelHeader(path, h, m.size)) return false;
+	// the grid is read in place, so every offset and id a query can follow is checked once
+	// here (one pass over the cells and items) rather than trusted
+	const int* cellStart = (const int*)(m.base + h.sections[LEVEL_CELL_START].offset);
+	const int* cellCount = (const int*)(m.base + h.sections[LEVEL_CELL_COUNT].offset);
+	const int* items = (const int*)(m.base + h.sections[LEVEL_CELL_ITEMS].offset);
+	size_t cells = (size_t)h.gridNx * h.gridNz;
+	if (cellStart[0] != 0 || cellStart[cells] != (int)h.gridItemCount) return levelError(path, "bad collision grid");
+	for (size_t c = 0;c < cells;c++) {
+		if (cellStart[c] > cellStart[c + 1] || cellCount[c] < 0 || cellCount[c] > cellStart[c + 1] - cellStart[c])
+			return levelError(path, "bad collision grid");
+		for (int k = cellStart[c];k < cellStart[c] + cellCount[c];k++)
+			if (items[k] < 0 || items[k] >= (int)h.boxCount) return levelError(path, "bad collision grid");
+	}
+	const int* chunkStart = (const int*)(m.base + h.sections[LEVEL_CHUNK_START].offset);
+	size_t chunks = (size_t)h.chunkNx * h.chunkNz;
+	if (chunkStart[0] != 0 || chunkStart[chunks] != (int)h.coralCount) return levelError(path, "bad chunk table");
+	for (size_t k = 0;k < chunks;k++)
+		if (chunkStart[k] > chunkStart[k + 1]) return levelError(path, "bad chunk table");
+	return true;
+}
+
+// arena, spawn and the small object arrays (copied)
+static void setLevelObjects(const LevelFileHeader& h, const SceneObj* majors, const SceneObj* regs,
+	const GoalObj* goalRecords, const void* rocks) {
+	arenaSize = h.arenaSize;
+	playerStartX = h.playerStartX;
+	playerStartZ = h.playerStartZ;
+	colorPhase = 0.0f;
+	majorObjs.assign(majors, majors + h.majorCount);
+	regObjs.assign(regs, regs + h.regCount);
+	goals.assign(goalRecords, goalRecords + h.goalCount);
+	memcpy(majorRocks, rocks, sizeof(majorRocks));
+	totalGoals = (int)h.goalCount;
+}
+
+bool loadLevelFile(const char* path) {
+	MappedFile m;
+	if (!mapFile(path, m)) {
+		fprintf(stderr, "cannot open level %s\n", path);
+		return false;
+	}
+	if (!checkLevel(path, m)) {
+		unmapFile(m);
+		return false;
+	}
+	const LevelFileHeader& h = *(const LevelFileHeader*)m.base;
+	auto at = [&](LevelSectionId id) { return m.base + h.sections[id].offset; };
+
+	// the big arrays are used in place, the handful of objects are copied
+	setLevelObjects(h, (const SceneObj*)at(LEVEL_MAJORS), (const SceneObj*)at(LEVEL_REGS),
+		(const GoalObj*)at(LEVEL_GOALS), at(LEVEL_ROCKS));
+	coralSegments.borrow((CoralSegment*)at(LEVEL_CORAL), h.coralCount);
+
+	CollisionGrid& g = collisionGrid;
+	size_t padded = h.sections[LEVEL_BOX_MINX].bytes / sizeof(float);
+	AlignedFloats* axes[6] = { &g.boxes.minx, &g.boxes.miny, &g.boxes.minz, &g.boxes.maxx, &g.boxes.maxy, &g.boxes.maxz };
+	for (int a = 0;a < 6;a++) axes[a]->borrow((float*)at((LevelSectionId)(LEVEL_BOX_MINX + a)), padded);
+	g.boxes.visible.borrow((uint64_t*)at(LEVEL_BOX_VISIBLE), h.sections[LEVEL_BOX_VISIBLE].bytes / sizeof(uint64_t));
+	g.boxes.count = (int)h.boxCount;
+	for (int k = 0;k <= COLLIDER_KIND_COUNT;k++) g.kindBase[k] = h.kindBase[k];
+	g.originX = h.gridOriginX;
+	g.originZ = h.gridOriginZ;
+	g.cellSize = h.gridCellSize;
+	g.nx = h.gridNx;
+	g.nz = h.gridNz;
+	size_t cells = (size_t)g.nx * g.nz;
+	g.cellStart.borrow((int*)at(LEVEL_CELL_START), cells + 1);
+	g.cellCount.borrow((int*)at(LEVEL_CELL_COUNT), cells);
+	g.items.borrow((int*)at(LEVEL_CELL_ITEMS), h.gridItemCount);
+	g.outside.clear();
+	buildGoalBoxes();
+
+	// everything now points into the new mapping; a fresh map also drops the last round's edits
+	unmapFile(levelMapping);
+	levelMapping = m;
+	return true;
+}
+
+///////////////
+// Streaming access (plain reads, nothing mapped)
+///////////////
+static bool seekLevel(FILE* f, uint64_t offset) {
+#ifdef _WIN32
+	return _fseeki64(f, (long long)offset, SEEK_SET) == 0;
+#else
+	return fseeko(f, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+static bool readLevelSection(FILE* f, const LevelFileHeader& h, LevelSectionId id, void* out) {
+	const LevelSection& sec = h.sections[id];
+	return seekLevel(f, sec.offset) && fread(out, 1, sec.bytes, f) == sec.bytes;
+}
+
+bool loadLevelObjects(const char* path, LevelFileHeader& h, LevelChunkTable& chunks) {
+	FILE* f = fopen(path, "rb");
+	if (!f) {
+		fprintf(stderr, "cannot open level %s\n", path);
+		return false;
+	}
+	uint64_t fileSize = 0;
+#ifdef _WIN32
+	if (_fseeki64(f, 0, SEEK_END) == 0) fileSize = (uint64_t)_ftelli64(f);
+#else
+	if (fseeko(f, 0, SEEK_END) == 0) fileSize = (uint64_t)ftello(f);
+#endif
+	bool ok = seekLevel(f, 0) && fread(&h, sizeof(h), 1, f) == 1 && checkLevelHeader(path, h, fileSize);
+	// sized only once the header checked out: the counts of a bad file mean nothing
+	std::vector<SceneObj> majors, regs;
+	std::vector<GoalObj> goalRecords;
+	float rocks[3][4];
+	if (ok) {
+		majors.resize(h.majorCount);
+		regs.resize(h.regCount);
+		goalRecords.resize(h.goalCount);
+		int count = h.chunkNx * h.chunkNz;
+		chunks.size = h.chunkSize;
+		chunks.nx = h.chunkNx;
+		chunks.nz = h.chunkNz;
+		chunks.start.resize(count + 1);
+		chunks.bounds.resize(count * 4);
+		ok = readLevelSection(f, h, LEVEL_MAJORS, majors.data()) && readLevelSection(f, h, LEVEL_REGS, regs.data()) &&
+			readLevelSection(f, h, LEVEL_GOALS, goalRecords.data()) && readLevelSection(f, h, LEVEL_ROCKS, rocks) &&
+			readLevelSection(f, h, LEVEL_CHUNK_START, chunks.start.data()) &&
+			readLevelSection(f, h, LEVEL_CHUNK_BOUNDS, chunks.bounds.data());
+		if (!ok) levelError(path, "truncated or corrupt level");
+	}
+	fclose(f);
+	if (!ok) return false;
+	for (int k = 0;k < chunks.nx * chunks.nz;k++)
+		if (chunks.start[k] < 0 || chunks.start[k] > chunks.start[k + 1]) return levelError(path, "bad chunk table");
+	if (chunks.start[0] != 0 || chunks.start.back() != (int)h.coralCount) return levelError(path, "bad chunk table");
+	setLevelObjects(h, majors.data(), regs.data(), goalRecords.data(), rocks);
+	return true;
+}
+
+bool readLevelCoral(FILE* f, const LevelFileHeader& h, uint32_t first, uint32_t count, CoralSegment* out) {
+	if (count == 0) return true;
+	return seekLevel(f, h.sections[LEVEL_CORAL].offset + (uint64_t)first * sizeof(CoralSegment)) &&
+		fread(out, sizeof(CoralSegment), count, f) == count;
+}
+
+///////////////
+// Text authoring format
+///////////////
+bool loadLevelText(const char* path) {
+	FILE* f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "cannot open level text %s\n", path);
+		return false;
+	}
+	LevelArray<CoralSegment> coral;
+	std::vector<SceneObj> majors, regs;
+	std::vector<GoalObj> goalList;
+	std::vector<float> rocks;
+	float arena = 10.0f, startX = 5.0f, startZ = 5.0f;
+
+	char line[256], word[32];
+	int lineNo = 0;
+	bool ok = true;
+	while (ok && fgets(line, sizeof(line), f)) {
+		lineNo++;
+		char* hash = strchr(line, '#');
+		if (hash) *hash = 0;
+		int off = 0;
+		if (sscanf(line, "%31s%n", word, &off) != 1) continue;
+		const char* rest = line + off;
+		float v[6];
+		char flag[16] = "";
+		if (strcmp(word, "arena") == 0) ok = sscanf(rest, "%f", &arena) == 1 && arena > 0.0f;
+		else if (strcmp(word, "start") == 0) ok = sscanf(rest, "%f %f", &startX, &startZ) == 2;
+		else if (strcmp(word, "coral") == 0) {
+			int n = sscanf(rest, "%f %f %f %f %f %f %15s", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], flag);
+			ok = n >= 6 && (n == 6 || strcmp(flag, "hidden") == 0);
+			if (ok) coral.push_back(CoralSegment{ v[0], v[1], v[2], v[3], v[4], v[5], n == 6 });
+		}
+		else if (strcmp(word, "major") == 0 || strcmp(word, "reg") == 0) {
+			int n = sscanf(rest, "%f %f %f %15s", &v[0], &v[1], &v[2], flag);
+			ok = n >= 3 && (n == 3 || strcmp(flag, "hidden") == 0);
+			SceneObj o;
+			o.x = v[0]; o.y = v[1]; o.z = v[2];
+			o.visible = n == 3; o.animating = true; o.animPhase = 0;
+			if (ok) (word[0] == 'm' ? majors : regs).push_back(o);
+		}
+		else if (strcmp(word, "goal") == 0) {
+			v[3] = 0.5f + goalList.size();
+			int n = sscanf(rest, "%f %f %f %f", &v[0], &v[1], &v[2], &v[3]);
+			ok = n >= 3;
+			if (ok) goalList.push_back(GoalObj{ v[0], v[1], v[2], true, v[3] });
+		}
+		else if (strcmp(word, "rock") == 0) {
+			ok = sscanf(rest, "%f %f %f %f", &v[0], &v[1], &v[2], &v[3]) == 4 && rocks.size() < 12;
+			if (ok) rocks.insert(rocks.end(), v, v + 4);
+		}
+		else ok = false;
+		if (!ok) fprintf(stderr, "%s:%d: bad line: %s\n", path, lineNo, line);
+	}
+	fclose(f);
+	if (!ok) return false;
+	if (rocks.size() != 12) {
+		fprintf(stderr, "%s: a level needs exactly 3 rocks\n", path);
+		return false;
+	}
+
+	arenaSize = arena;
+	playerStartX = startX;
+	playerStartZ = startZ;
+	colorPhase = 0.0f;
+	coralSegments = coral;
+	majorObjs = majors;
+	regObjs = regs;
+	goals = goalList;
+	totalGoals = (int)goals.size();
+	std::copy(rocks.begin(), rocks.end(), &majorRocks[0][0]);
+	buildCollisionGrid();
+	return true;
+}
+
+bool saveLevelText(const char* path) {
+	FILE* f = fopen(path, "w");
+	if (!f) {
+		fprintf(stderr, "cannot write level text %s\n", path);
+		return false;
+	}
+	// %.9g round-trips every float exactly
+	fprintf(f, "# Coral Maze level\narena %.9g\nstart %.9g %.9g\n", arenaSize, playerStartX, playerStartZ);
+	for (const auto& r : majorRocks) fprintf(f, "rock %.9g %.9g %.9g %.9g\n", r[0], r[1], r[2], r[3]);
+	for (const auto& m : majorObjs) fprintf(f, "major %.9g %.9g %.9g%s\n", m.x, m.y, m.z, m.visible ? "" : " hidden");
+	for (const auto& r : regObjs) fprintf(f, "reg %.9g %.9g %.9g%s\n", r.x, r.y, r.z, r.visible ? "" : " hidden");
+	for (const auto& g : goals) fprintf(f, "goal %.9g %.9g %.9g %.9g\n", g.x, g.y, g.z, g.phase);
+	for (const auto& c : coralSegments)
+		fprintf(f, "coral %.9g %.9g %.9g %.9g %.9g %.9g%s\n", c.x, c.y, c.z, c.w, c.h, c.d, c.visible ? "" : " hidden");
+	bool ok = fclose(f) == 0;
+	if (!ok) fprintf(stderr, "cannot write level text %s\n", path);
+	return ok;
+}
@@ -0,0 +1,84 @@
+#pragma once
+///////////////
+// Level files
+// Binary levels (.crlv) hold everything initSceneObjects would otherwise build: coral boxes,
+// majors, regulars, goals, rocks and the prebuilt collision grid (boxes + CSR cells). Every
+// array starts on a 64-byte boundary in the layout the simulation uses, so loading maps the
+// file (copy-on-write) and points coralSegments and the collision grid straight at it.
+// Coral is stored grouped by square chunk with a chunk table, so a streamed world
+// (coral_stream.h) can read any chunk's coral as one contiguous range.
+// The text format is for authoring; coral_levelc compiles it to the binary form.
+//
+// Text format, one item per line ('#' starts a comment):
+//   arena <size>
+//   start <x> <z>
+//   coral <x> <y> <z> <w> <h> <d> [hidden]
+//   major <x> <y> <z> [hidden]
+//   reg <x> <y> <z> [hidden]
+//   goal <x> <y> <z> [phase]
+//   rock <x> <y> <z> <size>        (exactly three)
+///////////////
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "coral_sim.h"
+
+struct LevelSection {
+	uint64_t offset; // from the start of the file, multiple of levelAlignment
+	uint64_t bytes;
+};
+
+enum LevelSectionId {
+	LEVEL_CORAL, LEVEL_MAJORS, LEVEL_REGS, LEVEL_GOALS, LEVEL_ROCKS,
+	LEVEL_BOX_MINX, LEVEL_BOX_MINY, LEVEL_BOX_MINZ, LEVEL_BOX_MAXX, LEVEL_BOX_MAXY, LEVEL_BOX_MAXZ,
+	LEVEL_BOX_VISIBLE, LEVEL_CELL_START, LEVEL_CELL_COUNT, LEVEL_CELL_ITEMS,
+	LEVEL_CHUNK_START, LEVEL_CHUNK_BOUNDS,
+	LEVEL_SECTION_COUNT
+};
+
+struct LevelFileHeader {
+	char magic[4]; // "CRLV"
+	uint32_t version;
+	uint32_t headerBytes; // sizeof(LevelFileHeader)
+	uint16_t coralBytes, objectBytes, goalBytes, reserved; // record sizes the file was written with
+	float arenaSize;
+	float playerStartX, playerStartZ;
+	uint32_t coralCount, majorCount, regCount, goalCount;
+	uint32_t boxCount; // colliders: coral, then majors, then the rocks
+	int32_t kindBase[COLLIDER_KIND_COUNT + 1];
+	float gridOriginX, gridOriginZ, gridCellSize;
+	int32_t gridNx, gridNz;
+	uint32_t gridItemCount;
+	float chunkSize; // streaming chunks: squares from the origin, coral goes to the chunk of its centre
+	int32_t chunkNx, chunkNz;
+	LevelSection sections[LEVEL_SECTION_COUNT];
+};
+
+const uint32_t levelFileVersion = 2;
+const int levelAlignment = 64;
+
+extern float levelChunkSize; // chunk side saveLevelFile groups coral by (coral_levelc --chunk-size)
+
+// chunk c holds coral [start[c], start[c+1]); bounds are minx, minz, maxx, maxz per chunk
+// (the chunk square grown to cover its coral)
+struct LevelChunkTable {
+	float size;
+	int nx, nz;
+	std::vector<int> start;
+	std::vector<float> bounds;
+};
+
+// current layout and collision grid (call after a fresh initSceneObjects); regroups the coral
+// by chunk first, rebuilding the collision grid, when it isn't grouped already
+bool saveLevelFile(const char* path);
+bool loadLevelFile(const char* path); // maps the file and points the scene at it; false leaves the scene as it was
+
+// streaming access: loadLevelObjects sets everything but the coral and the collision grid
+// (arena, spawn, majors, regulars, goals, rocks) and returns the header and chunk table;
+// readLevelCoral reads coral [first, first + count) from an open level file
+bool loadLevelObjects(const char* path, LevelFileHeader& header, LevelChunkTable& chunks);
+bool readLevelCoral(FILE* f, const LevelFileHeader& header, uint32_t first, uint32_t count, CoralSegment* out);
+
+bool loadLevelText(const char* path); // authoring format -> scene objects + collision grid
+bool saveLevelText(const char* path);
@@ -0,0 +1,67 @@
+///////////////
+// Level compiler
+// Builds a binary level (.crlv, coral_level.h) from the text authoring format, or from the
+// built-in / generated layout, and can write the text form of any of them.
+//
+//   coral_levelc level.txt -o level.crlv
+//   coral_levelc [--maze N] [--seed S] [--maze-algo name] -o maze.crlv [--text maze.txt]
+//   coral_levelc --level level.crlv --text level.txt
+//
+// --chunk-size S sets the streaming chunk side (default 32 units); coral crossing a chunk
+// edge is cut there in the binary level.
+///////////////
+#include "coral_sim.h"
+#include "coral_mazegen.h"
+#include "coral_level.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <chrono>
+
+int main(int argc, char** argv) {
+	const char* textIn = nullptr;
+	const char* binaryOut = nullptr;
+	const char* textOut = nullptr;
+	for (int i = 1;i < argc;i++) {
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) binaryOut = argv[++i];
+		else if (strcmp(argv[i], "--text") == 0 && i + 1 < argc) textOut = argv[++i];
+		else if (strcmp(argv[i], "--chunk-size") == 0 && i + 1 < argc) levelChunkSize = std::max(1.0f, (float)atof(argv[++i]));
+		else if (parseMazeArg(i, argc, argv)) continue;
+		else if (argv[i][0] != '-' && !textIn) textIn = argv[i];
+		else {
+			fprintf(stderr, "usage: %s level.txt -o level.crlv\n"
+				"       %s [--maze N] [--seed S] [--maze-algo backtracker|wilson|kruskal] [--maze-tile T]\n"
+				"          [--level in.crlv] [-o out.crlv] [--text out.txt] [--chunk-size S]\n", argv[0], argv[0]);
+			return 1;
+		}
+	}
+	if (!binaryOut && !textOut) {
+		fprintf(stderr, "nothing to write (-o level.crlv and/or --text level.txt)\n");
+		return 1;
+	}
+
+	auto t0 = std::chrono::steady_clock::now();
+	if (textIn) {
+		if (!loadLevelText(textIn)) return 1;
+	}
+	else {
+		// built-in, generated (--maze) or an existing binary level (--level)
+		const char* level = levelFilePath;
+		initSceneObjects();
+		if (level && !levelFilePath) return 1; // the level failed to load
+	}
+	auto t1 = std::chrono::steady_clock::now();
+
+	if (binaryOut && !saveLevelFile(binaryOut)) return 1;
+	if (textOut && !saveLevelText(textOut)) return 1;
+	auto t2 = std::chrono::steady_clock::now();
+
+	printf("%zu coral, %zu majors, %zu regulars, %zu goals, %d grid cells, %zu grid slots\n",
+		coralSegments.size(), majorObjs.size(), regObjs.size(), goals.size(),
+		collisionGrid.nx * collisionGrid.nz, collisionGrid.items.size());
+	printf("build %.1f ms, write %.1f ms\n", std::chrono::duration<double, std::milli>(t1 - t0).count(),
+		std::chrono::duration<double, std::milli>(t2 - t1).count());
+	return 0;
+}
@@ -0,0 +1,300 @@
+#include "coral_mazegen.h"
+#include "coral_stream.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+MazeParams levelMaze = { 0, 1u, MAZE_BACKTRACKER, 64, 0, 2.0f, 0.4f, 0.9f };
+
+static const char* const mazeAlgorithmNames[MAZE_ALGORITHM_COUNT] = { "backtracker", "wilson", "kruskal" };
+
+const char* mazeAlgorithmName(MazeAlgorithm a) {
+	return mazeAlgorithmNames[a];
+}
+
+bool parseMazeArg(int& i, int argc, char** argv) {
+	if (i + 1 >= argc) return false;
+	const char* arg = argv[i];
+	const char* val = argv[i + 1];
+	if (strcmp(arg, "--maze") == 0) levelMaze.cells = std::max(0, std::min(atoi(val), 4096));
+	else if (strcmp(arg, "--seed") == 0) levelMaze.seed = (unsigned)strtoul(val, nullptr, 10);
+	else if (strcmp(arg, "--maze-tile") == 0) levelMaze.tileCells = std::max(2, atoi(val));
+	else if (strcmp(arg, "--maze-threads") == 0) levelMaze.threads = std::max(0, atoi(val));
+	else if (strcmp(arg, "--level") == 0) levelFilePath = val;
+	else if (strcmp(arg, "--stream") == 0) streamBudgetBytes = (size_t)(std::max(0.0, atof(val)) * 1024 * 1024);
+	else if (strcmp(arg, "--stream-radius") == 0) streamRadius = std::max(1.0f, (float)atof(val));
+	else if (strcmp(arg, "--agents") == 0) agentCount = std::max(1, atoi(val));
+	else if (strcmp(arg, "--sim-threads") == 0) simThreads = std::max(0, atoi(val));
+	else if (strcmp(arg, "--maze-algo") == 0) {
+		int a = 0;
+		while (a < MAZE_ALGORITHM_COUNT && strcmp(val, mazeAlgorithmNames[a]) != 0) a++;
+		if (a == MAZE_ALGORITHM_COUNT) {
+			fprintf(stderr, "unknown maze algorithm %s (backtracker, wilson, kruskal)\n", val);
+			return false;
+		}
+		levelMaze.algorithm = (MazeAlgorithm)a;
+	}
+	else return false;
+	i++;
+	return true;
+}
+
+bool MazeGrid::open(int cell, int dx, int dz) const {
+	int x = cell % n, z = cell / n;
+	if (dx == 1) return x < n - 1 && !(walls[cell] & MAZE_WALL_EAST);
+	if (dx == -1) return x > 0 && !(walls[cell - 1] & MAZE_WALL_EAST);
+	if (dz == 1) return z < n - 1 && !(walls[cell] & MAZE_WALL_SOUTH);
+	if (dz == -1) return z > 0 && !(walls[cell - n] & MAZE_WALL_SOUTH);
+	return false;
+}
+
+///////////////
+// Per-tile carving
+// A tile is a w x h window of the grid; every algorithm carves a spanning tree of the
+// tile's cells and only writes wall bits of cells inside the tile, so tiles can run
+// concurrently on one shared grid.
+///////////////
+struct MazeTile {
+	MazeGrid* grid;
+	int x0, z0, w, h;
+	int global(int local) const { return (z0 + local / w) * grid->n + x0 + local % w; }
+	// remove the wall between two neighbouring local cells
+	void carve(int a, int b) const {
+		if (a > b) std::swap(a, b);
+		// (a one-cell-wide tile has no east neighbours, so b == a + w wins)
+		if (b == a + w) grid->walls[global(a)] &= ~MAZE_WALL_SOUTH;
+		else grid->walls[global(a)] &= ~MAZE_WALL_EAST;
+	}
+	// local neighbours of a cell, returned count
+	int neighbours(int cell, int* out) const {
+		int x = cell % w, z = cell / w, k = 0;
+		if (x > 0) out[k++] = cell - 1;
+		if (x < w - 1) out[k++] = cell + 1;
+		if (z > 0) out[k++] = cell - w;
+		if (z < h - 1) out[k++] = cell + w;
+		return k;
+	}
+};
+
+static void carveBacktracker(const MazeTile& t, MazeRng& rng) {
+	std::vector<char> visited(t.w * t.h, 0);
+	std::vector<int> stack;
+	int start = rng.below(t.w * t.h);
+	visited[start] = 1;
+	stack.push_back(start);
+	while (!stack.empty()) {
+		int cell = stack.back();
+		int nb[4], open[4], k = 0;
+		int count = t.neighbours(cell, nb);
+		for (int i = 0;i < count;i++) if (!visited[nb[i]]) open[k++] = nb[i];
+		if (k == 0) {
+			stack.pop_back();
+			continue;
+		}
+		int next = open[rng.below(k)];
+		t.carve(cell, next);
+		visited[next] = 1;
+		stack.push_back(next);
+	}
+}
+
+// loop-erased random walks into the growing tree (uniform spanning tree)
+static void carveWilson(const MazeTile& t, MazeRng& rng) {
+	int cells = t.w * t.h;
+	std::vector<char> inTree(cells, 0);
+	std::vector<int> walkNext(cells, -1); // last exit taken from each cell on the current walk
+	inTree[rng.below(cells)] = 1;
+	for (int start = 0;start < cells;start++) {
+		if (inTree[start]) continue;
+		int cell = start;
+		while (!inTree[cell]) {
+			int nb[4];
+			int count = t.neighbours(cell, nb);
+			walkNext[cell] = nb[rng.below(count)];
+			cell = walkNext[cell];
+		}
+		// retrace the walk; overwritten exits have already erased the loops
+		for (cell = start;!inTree[cell];cell = walkNext[cell]) {
+			inTree[cell] = 1;
+			t.carve(cell, walkNext[cell]);
+		}
+	}
+}
+
+static int findRoot(std::vector<int>& parent, int a) {
+	while (parent[a] != a) a = parent[a] = parent[parent[a]];
+	return a;
+}
+
+// shuffled edges joined with union-find
+static void carveKruskal(const MazeTile& t, MazeRng& rng) {
+	std::vector<int> edges; // cell * 2 + (0 = east, 1 = south)
+	for (int z = 0;z < t.h;z++)
+		for (int x = 0;x < t.w;x++) {
+			if (x < t.w - 1) edges.push_back((z * t.w + x) * 2);
+			if (z < t.h - 1) edges.push_back((z * t.w + x) * 2 + 1);
+		}
+	for (int i = (int)edges.size() - 1;i > 0;i--) std::swap(edges[i], edges[rng.below(i + 1)]);
+	std::vector<int> parent(t.w * t.h);
+	for (int i = 0;i < (int)parent.size();i++) parent[i] = i;
+	for (int e : edges) {
+		int a = e / 2, b = (e & 1) ? a + t.w : a + 1;
+		int ra = findRoot(parent, a), rb = findRoot(parent, b);
+		if (ra == rb) continue;
+		parent[ra] = rb;
+		t.carve(a, b);
+	}
+}
+
+///////////////
+// Whole maze: tiles in parallel, then one door per edge of a spanning tree over the tiles
+///////////////
+static uint64_t mazeTileSeed(unsigned seed, int tile) {
+	MazeRng mix(((uint64_t)seed << 32) ^ (uint64_t)(unsigned)tile);
+	return mix.next();
+}
+
+void generateMaze(const MazeParams& p, MazeGrid& grid) {
+	int n = std::max(p.cells, 1);
+	int ts = std::max(p.tileCells, 2);
+	int tilesPerSide = (n + ts - 1) / ts;
+	int tileCount = tilesPerSide * tilesPerSide;
+	grid.n = n;
+	grid.walls.assign((size_t)n * n, MAZE_WALL_EAST | MAZE_WALL_SOUTH);
+
+	auto runTile = [&](int tile) {
+		int tx = tile % tilesPerSide, tz = tile / tilesPerSide;
+		MazeTile t;
+		t.grid = &grid;
+		t.x0 = tx * ts; t.z0 = tz * ts;
+		t.w = std::min(ts, n - t.x0); t.h = std::min(ts, n - t.z0);
+		MazeRng rng(mazeTileSeed(p.seed, tile));
+		switch (p.algorithm) {
+		case MAZE_WILSON: carveWilson(t, rng); break;
+		case MAZE_KRUSKAL: carveKruskal(t, rng); break;
+		default: carveBacktracker(t, rng); break;
+		}
+		};
+
+	int threads = p.threads > 0 ? p.threads : (int)std::thread::hardware_concurrency();
+	threads = std::max(1, std::min(threads, tileCount));
+	if (threads == 1) {
+		for (int tile = 0;tile < tileCount;tile++) runTile(tile);
+	}
+	else {
+		std::atomic<int> nextTile(0);
+		std::vector<std::thread> workers;
+		for (int w = 0;w < threads;w++)
+			workers.emplace_back([&]() {
+			for (int tile = nextTile++;tile < tileCount;tile = nextTile++) runTile(tile);
+				});
+		for (auto& w : workers) w.join();
+	}
+
+	// stitch: Kruskal over the tile graph, one random door in each chosen shared border
+	MazeRng rng(mazeTileSeed(p.seed, -1));
+	std::vector<int> edges;
+	for (int tz = 0;tz < tilesPerSide;tz++)
+		for (int tx = 0;tx < tilesPerSide;tx++) {
+			if (tx < tilesPerSide - 1) edges.push_back((tz * tilesPerSide + tx) * 2);
+			if (tz < tilesPerSide - 1) edges.push_back((tz * tilesPerSide + tx) * 2 + 1);
+		}
+	for (int i = (int)edges.size() - 1;i > 0;i--) std::swap(edges[i], edges[rng.below(i + 1)]);
+	std::vector<int> parent(tileCount);
+	for (int i = 0;i < tileCount;i++) parent[i] = i;
+	for (int e : edges) {
+		int a = e / 2, b = (e & 1) ? a + tilesPerSide : a + 1;
+		int ra = findRoot(parent, a), rb = findRoot(parent, b);
+		if (ra == rb) continue;
+		parent[ra] = rb;
+		int tx = a % tilesPerSide, tz = a / tilesPerSide;
+		if (e & 1) {
+			// south border of tile a: pick a column, open the last row's south wall
+			int x = tx * ts + rng.below(std::min(ts, n - tx * ts));
+			int z = tz * ts + ts - 1;
+			grid.walls[(size_t)z * n + x] &= ~MAZE_WALL_SOUTH;
+		}
+		else {
+			int z = tz * ts + rng.below(std::min(ts, n - tz * ts));
+			int x = tx * ts + ts - 1;
+			grid.walls[(size_t)z * n + x] &= ~MAZE_WALL_EAST;
+		}
+	}
+}
+
+void mazeDistances(const MazeGrid& grid, int startCell, std::vector<int>& dist) {
+	dist.assign((size_t)grid.n * grid.n, -1);
+	static thread_local std::vector<int> queue;
+	queue.clear();
+	queue.reserve(dist.size());
+	dist[startCell] = 0;
+	queue.push_back(startCell);
+	static const int steps[4][2] = { {1,0},{-1,0},{0,1},{0,-1} };
+	for (size_t head = 0;head < queue.size();head++) {
+		int cell = queue[head];
+		for (const auto& s : steps) {
+			if (!grid.open(cell, s[0], s[1])) continue;
+			int next = cell + s[0] + s[1] * grid.n;
+			if (dist[next] >= 0) continue;
+			dist[next] = dist[cell] + 1;
+			queue.push_back(next);
+		}
+	}
+}
+
+///////////////
+// Wall boxes
+// Consecutive cells sharing a wall line are merged into one box; each box is stretched by
+// half a thickness at both ends so corners and T-junctions stay closed. The outer border
+// is left to the arena's boundary walls.
+///////////////
+void mazeToSegments(const MazeGrid& grid, const MazeParams& p, LevelArray<CoralSegment>& out) {
+	const int n = grid.n;
+	const float cs = p.cellSize, t = p.wallThickness, half = t / 2.0f;
+	const float limit = n * cs;
+	auto addBox = [&](float x, float z, float w, float d) {
+		CoralSegment s;
+		s.x = std::max(x, 0.0f); s.z = std::max(z, 0.0f); s.y = 0.0f;
+		s.w = std::min(x + w, limit) - s.x; s.d = std::min(z + d, limit) - s.z; s.h = p.wallHeight;
+		s.visible = true;
+		out.push_back(s);
+		};
+
+	// east walls: vertical runs along z at each inner column line
+	for (int x = 0;x < n - 1;x++) {
+		for (int z = 0;z < n;) {
+			if (!(grid.walls[(size_t)z * n + x] & MAZE_WALL_EAST)) { z++; continue; }
+			int z1 = z;
+			while (z1 < n && (grid.walls[(size_t)z1 * n + x] & MAZE_WALL_EAST)) z1++;
+			addBox((x + 1) * cs - half, z * cs - half, t, (z1 - z) * cs + t);
+			z = z1;
+		}
+	}
+	// south walls: horizontal runs along x at each inner row line
+	for (int z = 0;z < n - 1;z++) {
+		const uint8_t* row = &grid.walls[(size_t)z * n];
+		for (int x = 0;x < n;) {
+			if (!(row[x] & MAZE_WALL_SOUTH)) { x++; continue; }
+			int x1 = x;
+			while (x1 < n && (row[x1] & MAZE_WALL_SOUTH)) x1++;
+			addBox(x * cs - half, (z + 1) * cs - half, (x1 - x) * cs + t, t);
+			x = x1;
+		}
+	}
+}
+
+// inner wall pieces before merging (one per closed cell side)
+int mazeUnmergedWallCount(const MazeGrid& grid) {
+	int count = 0;
+	for (int z = 0;z < grid.n;z++)
+		for (int x = 0;x < grid.n;x++) {
+			uint8_t w = grid.walls[(size_t)z * grid.n + x];
+			if (x < grid.n - 1 && (w & MAZE_WALL_EAST)) count++;
+			if (z < grid.n - 1 && (w & MAZE_WALL_SOUTH)) count++;
+		}
+	return count;
+}
@@ -0,0 +1,58 @@
+#pragma once
+///////////////
+// Procedural maze generator
+// Seeded perfect mazes on an N x N cell grid, generated in square tiles on worker
+// threads and stitched into one spanning tree, then emitted as merged CoralSegment walls.
+// The same seed gives the same maze for any thread count.
+///////////////
+#include <vector>
+#include <cstdint>
+
+#include "coral_sim.h"
+
+enum MazeAlgorithm { MAZE_BACKTRACKER, MAZE_WILSON, MAZE_KRUSKAL, MAZE_ALGORITHM_COUNT };
+
+struct MazeParams {
+	int cells; // cells per side; 0 = the hand-made 10x10 layout
+	unsigned seed;
+	MazeAlgorithm algorithm;
+	int tileCells; // cells per tile side (unit of parallel work)
+	int threads; // 0 = hardware concurrency
+	float cellSize; // world units per cell
+	float wallThickness;
+	float wallHeight;
+};
+
+// cell wall bits; north/west walls are the south/east walls of the neighbour
+enum { MAZE_WALL_EAST = 1, MAZE_WALL_SOUTH = 2 };
+
+struct MazeGrid {
+	int n; // cells per side
+	std::vector<uint8_t> walls; // n*n, row-major (z * n + x)
+	bool open(int cell, int dx, int dz) const; // passage from cell to its neighbour (one step)
+};
+
+// small seeded generator (splitmix64), identical on every platform
+struct MazeRng {
+	uint64_t state;
+	explicit MazeRng(uint64_t seed) : state(seed) {}
+	uint64_t next() {
+		uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+	int below(int n) { return (int)(next() % (uint64_t)n); }
+};
+
+extern MazeParams levelMaze; // layout used by buildMazeLayout()
+
+const char* mazeAlgorithmName(MazeAlgorithm a);
+// consumes --maze/--seed/--maze-algo/--maze-tile/--maze-threads/--level/--stream MB/--stream-radius R,
+// and --agents N/--sim-threads K (divers in the maze, job system workers)
+bool parseMazeArg(int& i, int argc, char** argv);
+
+void generateMaze(const MazeParams& p, MazeGrid& grid);
+void mazeDistances(const MazeGrid& grid, int startCell, std::vector<int>& dist); // BFS steps, -1 = unreachable
+void mazeToSegments(const MazeGrid& grid, const MazeParams& p, LevelArray<CoralSegment>& out);
+int mazeUnmergedWallCount(const MazeGrid& grid);
@@ -0,0 +1,474 @@
+#include "coral_nav.h"
+#include "coral_jobs.h"
+#include "coral_stream.h"
+
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+
+NavGrid navGrid;
+NavStats navStats;
+
+static unsigned navRevision = ~0u; // layoutRevision the grid and goal fields were built from
+static std::vector<std::vector<int32_t>> goalFields; // per goal, BFS steps from every cell
+// per goal too, not per worker: whichever worker rebuilds a field, the next rebuild of the
+// same layout allocates nothing
+static std::vector<std::vector<int>> goalQueues;
+static std::vector<uint8_t> fieldGoalVisible; // goal visibility the nearest-goal field reflects
+static std::vector<int32_t> nearestDist;
+static std::vector<int32_t> nearestGoal;
+
+static const int navStepX[8] = { 1, -1, 0, 0, 1, -1, 1, -1 };
+static const int navStepZ[8] = { 0, 0, 1, -1, 1, 1, -1, -1 };
+
+///////////////
+// Rasterising
+// A cell is blocked when its centre lies within the diver's half extents of a live collider
+// that reaches the diver's height on the seabed, of a streamed chunk that is not in memory
+// (solid to the diver, as streamBlockers tells collision) or of the arena wall.
+///////////////
+static const float navHalf = 0.14f; // getAgentAABB
+
+struct NavRect {
+	int x0, z0, x1, z1; // cells, inclusive
+};
+
+// the cells whose centres lie within the diver's half extents of b
+static NavRect navCellsUnder(const AABB& b) {
+	const NavGrid& n = navGrid;
+	const float cs = n.cellSize;
+	NavRect r;
+	r.x0 = std::max(0, (int)ceilf((b.minx - navHalf) / cs - 0.5f));
+	r.x1 = std::min(n.nx - 1, (int)floorf((b.maxx + navHalf) / cs - 0.5f));
+	r.z0 = std::max(0, (int)ceilf((b.minz - navHalf) / cs - 0.5f));
+	r.z1 = std::min(n.nz - 1, (int)floorf((b.maxz + navHalf) / cs - 0.5f));
+	return r;
+}
+
+static CollisionScratch navScratch; // syncNav runs on the simulation thread, but not always between its queries
+static std::vector<int> navIds;
+static std::vector<AABB> navBlockers;
+
+// rewrites the cells of r from what is there now
+static void rasteriseRect(const NavRect& r) {
+	NavGrid& n = navGrid;
+	const float cs = n.cellSize;
+	const float yLo = groundY - 0.48f, yHi = groundY + 0.48f; // the diver on the seabed
+	for (int z = r.z0;z <= r.z1;z++)
+		std::fill(&n.blocked[z * n.nx + r.x0], &n.blocked[z * n.nx + r.x1] + 1, 0);
+
+	auto block = [&](const AABB& b) {
+		if (b.maxy <= yLo || b.miny >= yHi) return;
+		NavRect c = navCellsUnder(b);
+		c.x0 = std::max(c.x0, r.x0); c.x1 = std::min(c.x1, r.x1);
+		c.z0 = std::max(c.z0, r.z0); c.z1 = std::min(c.z1, r.z1);
+		for (int z = c.z0;z <= c.z1;z++)
+			for (int x = c.x0;x <= c.x1;x++) n.blocked[z * n.nx + x] = 1;
+		};
+	// a cell further out all round, so rounding at the edges can't drop a collider
+	AABB area = AABB{ (r.x0 - 0.5f) * cs - navHalf, yLo, (r.z0 - 0.5f) * cs - navHalf,
+		(r.x1 + 1.5f) * cs + navHalf, yHi, (r.z1 + 1.5f) * cs + navHalf };
+	gridQuery(area, navIds, navScratch);
+	for (int id : navIds) block(collisionGrid.boxes.get(id));
+	streamBlockers(area, navBlockers);
+	for (const AABB& b : navBlockers) block(b);
+	const float lo = wallTh + navHalf, hi = arenaSize - wallTh - navHalf;
+	for (int z = r.z0;z <= r.z1;z++)
+		for (int x = r.x0;x <= r.x1;x++) {
+			float cx = (x + 0.5f) * cs, cz = (z + 0.5f) * cs;
+			if (cx < lo || cx > hi || cz < lo || cz > hi) n.blocked[z * n.nx + x] = 1;
+		}
+}
+
+static void rasteriseNavGrid() {
+	NavGrid& n = navGrid;
+	n.cellSize = std::max(navCellSize, arenaSize / sqrtf((float)navMaxCells));
+	n.nx = n.nz = std::max(1, (int)ceilf(arenaSize / n.cellSize));
+	n.blocked.assign((size_t)n.nx * n.nz, 0);
+	rasteriseRect(NavRect{ 0, 0, n.nx - 1, n.nz - 1 });
+}
+
+int navCellAt(float x, float z) {
+	const NavGrid& n = navGrid;
+	int cx = (int)floorf(x / n.cellSize), cz = (int)floorf(z / n.cellSize);
+	if (cx < 0 || cz < 0 || cx >= n.nx || cz >= n.nz) return -1;
+	return cz * n.nx + cx;
+}
+
+void navCellCentre(int cell, float& x, float& z) {
+	x = (cell % navGrid.nx + 0.5f) * navGrid.cellSize;
+	z = (cell / navGrid.nx + 0.5f) * navGrid.cellSize;
+}
+
+///////////////
+// Goal fields
+// One BFS per goal from the goal's cell (which may itself be blocked: goals sit close to
+// walls), run as jobs, one goal each.
+///////////////
+static void goalBfs(const GoalObj& goal, std::vector<int32_t>& dist, std::vector<int>& queue) {
+	const NavGrid& n = navGrid;
+	dist.assign(n.blocked.size(), navUnreachable);
+	int start = navCellAt(goal.x, goal.z);
+	if (start < 0) return;
+	queue.clear();
+	dist[start] = 0;
+	queue.push_back(start);
+	for (size_t head = 0;head < queue.size();head++) {
+		int c = queue[head];
+		int x = c % n.nx, z = c / n.nx;
+		int32_t d = dist[c] + 1;
+		for (int k = 0;k < 4;k++) {
+			int tx = x + navStepX[k], tz = z + navStepZ[k];
+			if (tx < 0 || tz < 0 || tx >= n.nx || tz >= n.nz) continue;
+			int t = tz * n.nx + tx;
+			if (n.blocked[t] || dist[t] != navUnreachable) continue;
+			dist[t] = d;
+			queue.push_back(t);
+		}
+	}
+}
+
+static void buildGoalFields() {
+	goalFields.resize(goals.size());
+	goalQueues.resize(goals.size());
+	parallelFor((int)goals.size(), 1, [](int begin, int end) {
+		for (int g = begin;g < end;g++) goalBfs(goals[g], goalFields[g], goalQueues[g]);
+		});
+}
+
+// goal g's step count beats the current nearest one (ties go to the lower goal index, like the full pass)
+static bool nearer(int g, int32_t d, int cell) {
+	return d < nearestDist[cell] || (d == nearestDist[cell] && d != navUnreachable && g < nearestGoal[cell]);
+}
+
+void rebuildNearestGoalField() {
+	size_t cells = navGrid.blocked.size();
+	nearestDist.assign(cells, navUnreachable);
+	nearestGoal.assign(cells, -1);
+	fieldGoalVisible.assign(goals.size(), 0);
+	for (size_t g = 0;g < goals.size();g++) {
+		fieldGoalVisible[g] = goals[g].visible;
+		if (!goals[g].visible) continue;
+		const std::vector<int32_t>& f = goalFields[g];
+		for (size_t c = 0;c < cells;c++)
+			if (f[c] < nearestDist[c]) { nearestDist[c] = f[c]; nearestGoal[c] = (int32_t)g; }
+	}
+}
+
+// goal g was collected (hidden) or came back; only the cells it can change are touched
+static int updateNearestGoalField(int g) {
+	const std::vector<int32_t>& f = goalFields[g];
+	size_t cells = navGrid.blocked.size();
+	int updated = 0;
+	if (goals[g].visible) {
+		for (size_t c = 0;c < cells;c++)
+			if (nearer(g, f[c], (int)c)) { nearestDist[c] = f[c]; nearestGoal[c] = g; updated++; }
+	}
+	else {
+		for (size_t c = 0;c < cells;c++) {
+			if (nearestGoal[c] != g) continue;
+			int32_t best = navUnreachable, bestGoal = -1;
+			for (size_t k = 0;k < goals.size();k++)
+				if (fieldGoalVisible[k] && (int)k != g && goalFields[k][c] < best) { best = goalFields[k][c]; bestGoal = (int32_t)k; }
+			nearestDist[c] = best;
+			nearestGoal[c] = bestGoal;
+			updated++;
+		}
+	}
+	fieldGoalVisible[g] = goals[g].visible;
+	return updated;
+}
+
+///////////////
+// Streamed chunks
+// A chunk loading or going away only flips the cells under it. Each goal field is repaired
+// around the flips instead of rerun: cells that lost every neighbour one step nearer the
+// goal give up their distance (spreading outwards), then the cells that can be reached again
+// are refilled from their surviving neighbours nearest first. A field the flips don't touch
+// costs a look at the flipped cells.
+///////////////
+static std::vector<int> flippedCells;
+static std::vector<std::vector<int>> fieldTouched; // per goal, cells the repair rewrote
+
+static void repairGoalField(const GoalObj& goal, std::vector<int32_t>& dist, std::vector<int>& touched) {
+	const NavGrid& n = navGrid;
+	touched.clear();
+	int start = navCellAt(goal.x, goal.z);
+	if (start < 0) return;
+	// the goal's own cell counts even when blocked, as in goalBfs
+	auto open = [&](int c) { return c == start || !n.blocked[c]; };
+	auto neighbour = [&](int c, int k) {
+		int tx = c % n.nx + navStepX[k], tz = c / n.nx + navStepZ[k];
+		return tx < 0 || tz < 0 || tx >= n.nx || tz >= n.nz ? -1 : tz * n.nx + tx;
+		};
+	static thread_local std::vector<std::pair<int32_t, int>> lost, seeds, queue;
+
+	// cells that became blocked lose their distance, and so does whatever only reached the
+	// goal through them
+	lost.clear();
+	for (int c : flippedCells) {
+		if (c == start || !n.blocked[c] || dist[c] == navUnreachable) continue;
+		lost.push_back({ dist[c], c });
+		dist[c] = navUnreachable;
+		touched.push_back(c);
+	}
+	for (size_t head = 0;head < lost.size();head++) {
+		int32_t d = lost[head].first + 1;
+		int c = lost[head].second;
+		for (int k = 0;k < 4;k++) {
+			int t = neighbour(c, k);
+			if (t < 0 || t == start || dist[t] != d) continue;
+			bool held = false;
+			for (int j = 0;j < 4 && !held;j++) {
+				int u = neighbour(t, j);
+				held = u >= 0 && dist[u] == d - 1 && open(u);
+			}
+			if (held) continue;
+			lost.push_back({ d, t });
+			dist[t] = navUnreachable;
+			touched.push_back(t);
+		}
+	}
+
+	// cells that lost their distance or became free take the best of their neighbours, then
+	// lower whatever they lead to, nearest first (sorted seeds merged with a FIFO that only grows)
+	seeds.clear();
+	auto reseed = [&](int t) {
+		if (t == start || n.blocked[t]) return;
+		int32_t best = dist[t];
+		for (int k = 0;k < 4;k++) {
+			int u = neighbour(t, k);
+			if (u >= 0 && open(u) && dist[u] != navUnreachable) best = std::min(best, dist[u] + 1);
+		}
+		if (best == dist[t]) return;
+		dist[t] = best;
+		seeds.push_back({ best, t });
+		touched.push_back(t);
+		};
+	for (const auto& l : lost) reseed(l.second);
+	for (int c : flippedCells) reseed(c);
+	std::sort(seeds.begin(), seeds.end());
+	queue.clear();
+	size_t seed = 0, head = 0;
+	while (seed < seeds.size() || head < queue.size()) {
+		bool fromSeeds = head == queue.size() || (seed < seeds.size() && seeds[seed].first <= queue[head].first);
+		std::pair<int32_t, int> top = fromSeeds ? seeds[seed++] : queue[head++];
+		int c = top.second;
+		if (dist[c] != top.first) continue; // lowered again since
+		for (int k = 0;k < 4;k++) {
+			int t = neighbour(c, k);
+			if (t < 0 || t == start || n.blocked[t] || dist[t] <= top.first + 1) continue;
+			dist[t] = top.first + 1;
+			queue.push_back({ dist[t], t });
+			touched.push_back(t);
+		}
+	}
+}
+
+// re-rasterises the chunks' cells and repairs the goal fields and the nearest-goal field
+// around the cells that flipped
+static void updateNavChunks(const std::vector<AABB>& chunks) {
+	NavGrid& n = navGrid;
+	static std::vector<uint8_t> before;
+	flippedCells.clear();
+	for (const AABB& chunk : chunks) {
+		NavRect r = navCellsUnder(chunk);
+		if (r.x0 > r.x1 || r.z0 > r.z1) continue;
+		int w = r.x1 - r.x0 + 1;
+		before.resize((size_t)w * (r.z1 - r.z0 + 1));
+		for (int z = r.z0;z <= r.z1;z++)
+			std::copy(&n.blocked[z * n.nx + r.x0], &n.blocked[z * n.nx + r.x1] + 1, &before[(z - r.z0) * w]);
+		rasteriseRect(r);
+		for (int z = r.z0;z <= r.z1;z++)
+			for (int x = r.x0;x <= r.x1;x++)
+				if (n.blocked[z * n.nx + x] != before[(z - r.z0) * w + x - r.x0]) flippedCells.push_back(z * n.nx + x);
+	}
+	navStats.flippedCells = (int)flippedCells.size();
+	if (flippedCells.empty()) return;
+
+	fieldTouched.resize(goals.size());
+	parallelFor((int)goals.size(), 1, [](int begin, int end) {
+		for (int g = begin;g < end;g++) repairGoalField(goals[g], goalFields[g], fieldTouched[g]);
+		});
+	// the same per-cell minimum as the full pass, over the cells any visible field changed at
+	for (size_t g = 0;g < goals.size();g++) {
+		if (!fieldGoalVisible[g]) continue;
+		for (int c : fieldTouched[g]) {
+			int32_t best = navUnreachable, bestGoal = -1;
+			for (size_t k = 0;k < goals.size();k++)
+				if (fieldGoalVisible[k] && goalFields[k][c] < best) { best = goalFields[k][c]; bestGoal = (int32_t)k; }
+			nearestDist[c] = best;
+			nearestGoal[c] = bestGoal;
+		}
+	}
+}
+
+void syncNav() {
+	static std::vector<AABB> changedChunks;
+	if (navRevision != layoutRevision && goalFields.size() == goals.size() && streamChangedChunks(navRevision, changedChunks)) {
+		auto t0 = std::chrono::steady_clock::now();
+		updateNavChunks(changedChunks);
+		navStats.chunkMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+		navRevision = layoutRevision;
+	}
+	if (navRevision != layoutRevision || goalFields.size() != goals.size()) {
+		auto t0 = std::chrono::steady_clock::now();
+		rasteriseNavGrid();
+		auto t1 = std::chrono::steady_clock::now();
+		buildGoalFields();
+		rebuildNearestGoalField();
+		auto t2 = std::chrono::steady_clock::now();
+		navStats.gridMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+		navStats.fieldsMs = std::chrono::duration<double, std::milli>(t2 - t1).count();
+		navRevision = layoutRevision;
+		return;
+	}
+	for (size_t g = 0;g < goals.size();g++) {
+		if (goals[g].visible == (fieldGoalVisible[g] != 0)) continue;
+		auto t0 = std::chrono::steady_clock::now();
+		navStats.updatedCells = updateNearestGoalField((int)g);
+		navStats.updateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+	}
+}
+
+int32_t navGoalDistance(int cell) {
+	return cell >= 0 && cell < (int)nearestDist.size() ? nearestDist[cell] : navUnreachable;
+}
+
+int navNearestGoal(int cell) {
+	return cell >= 0 && cell < (int)nearestGoal.size() ? nearestGoal[cell] : -1;
+}
+
+const std::vector<int32_t>& navGoalField(int goal) {
+	return goalFields[goal];
+}
+
+// diagonal steps need both orthogonal neighbours free, so a path never clips a corner
+static bool navStepOpen(int x, int z, int k) {
+	const NavGrid& n = navGrid;
+	int tx = x + navStepX[k], tz = z + navStepZ[k];
+	if (tx < 0 || tz < 0 || tx >= n.nx || tz >= n.nz || n.blocked[tz * n.nx + tx]) return false;
+	return k < 4 || (!n.blocked[z * n.nx + tx] && !n.blocked[tz * n.nx + x]);
+}
+
+int navNextCell(int cell) {
+	if (cell < 0 || cell >= (int)nearestDist.size()) return -1;
+	const NavGrid& n = navGrid;
+	int x = cell % n.nx, z = cell / n.nx;
+	// a diver pressed into a blocked cell steps to any reachable neighbour
+	int32_t best = n.blocked[cell] ? navUnreachable : nearestDist[cell];
+	int next = -1;
+	for (int k = 0;k < 8;k++) {
+		if (!navStepOpen(x, z, k)) continue;
+		int t = (z + navStepZ[k]) * n.nx + x + navStepX[k];
+		if (nearestDist[t] < best) { best = nearestDist[t]; next = t; }
+	}
+	return next;
+}
+
+void navHintPath(float x, float z, std::vector<float>& xz) {
+	syncNav();
+	xz.clear();
+	xz.insert(xz.end(), { x, z });
+	int cell = navCellAt(x, z);
+	int goal = navNearestGoal(cell);
+	for (int steps = 0;steps < (int)navGrid.blocked.size();steps++) {
+		cell = navNextCell(cell);
+		if (cell < 0) break;
+		float cx, cz;
+		navCellCentre(cell, cx, cz);
+		xz.insert(xz.end(), { cx, cz });
+		goal = navNearestGoal(cell);
+	}
+	if (goal < 0) {
+		xz.clear();
+		return;
+	}
+	xz.insert(xz.end(), { goals[goal].x, goals[goal].z });
+}
+
+///////////////
+// A*
+// Octile distance heuristic (consistent for 8-connected moves), binary heap with lazy
+// deletion, per-thread scratch stamped per query so nothing is cleared between queries.
+///////////////
+struct AStarScratch {
+	std::vector<float> g;
+	std::vector<int> parent;
+	std::vector<unsigned> stamp;
+	unsigned generation = 0;
+	std::vector<std::pair<float, int>> heap; // (f, cell), min-heap
+};
+static thread_local AStarScratch astarScratch;
+
+bool navFindPath(int from, int to, std::vector<int>& path) {
+	path.clear();
+	const NavGrid& n = navGrid;
+	int cells = (int)n.blocked.size();
+	if (from < 0 || to < 0 || from >= cells || to >= cells || n.blocked[to]) return false;
+	AStarScratch& s = astarScratch;
+	if ((int)s.stamp.size() != cells) {
+		s.g.resize(cells);
+		s.parent.resize(cells);
+		s.stamp.assign(cells, 0);
+		s.generation = 0;
+	}
+	if (++s.generation == 0) {
+		std::fill(s.stamp.begin(), s.stamp.end(), 0);
+		s.generation = 1;
+	}
+	const float diagonal = 1.41421356f;
+	const int tx = to % n.nx, tz = to / n.nx;
+	auto heuristic = [&](int c) {
+		int dx = abs(c % n.nx - tx), dz = abs(c / n.nx - tz);
+		return (float)std::max(dx, dz) + (diagonal - 1.0f) * std::min(dx, dz);
+		};
+	auto later = [](const std::pair<float, int>& a, const std::pair<float, int>& b) { return a.first > b.first; };
+
+	s.heap.clear();
+	s.g[from] = 0.0f;
+	s.parent[from] = -1;
+	s.stamp[from] = s.generation;
+	s.heap.push_back({ heuristic(from), from });
+	while (!s.heap.empty()) {
+		std::pop_heap(s.heap.begin(), s.heap.end(), later);
+		std::pair<float, int> top = s.heap.back();
+		s.heap.pop_back();
+		int c = top.second;
+		if (top.first > s.g[c] + heuristic(c) + 1e-4f) continue; // stale entry
+		if (c == to) {
+			for (int p = to;p >= 0;p = s.parent[p]) path.push_back(p);
+			std::reverse(path.begin(), path.end());
+			return true;
+		}
+		int x = c % n.nx, z = c / n.nx;
+		for (int k = 0;k < 8;k++) {
+			if (!navStepOpen(x, z, k)) continue;
+			int t = (z + navStepZ[k]) * n.nx + x + navStepX[k];
+			float cost = s.g[c] + (k < 4 ? 1.0f : diagonal);
+			if (s.stamp[t] == s.generation && cost >= s.g[t]) continue;
+			s.stamp[t] = s.generation;
+			s.g[t] = cost;
+			s.parent[t] = c;
+			s.heap.push_back({ cost + heuristic(t), t });
+			std::push_heap(s.heap.begin(), s.heap.end(), later);
+		}
+	}
+	return false;
+}
+
+void navFindPaths(const std::vector<NavQuery>& queries, std::vector<std::vector<int>>& paths) {
+	paths.resize(queries.size());
+	parallelFor((int)queries.size(), 1, [&](int begin, int end) {
+		for (int q = begin;q < end;q++) navFindPath(queries[q].from, queries[q].to, paths[q]);
+		});
+}
+
+float navPathLength(const std::vector<int>& path) {
+	float len = 0.0f;
+	for (size_t i = 1;i < path.size();i++) {
+		int d = abs(path[i] - path[i - 1]);
+		len += (d == 1 || d == navGrid.nx) ? 1.0f : 1.41421356f;
+	}
+	return len;
+}
@@ -0,0 +1,63 @@
+#pragma once
+///////////////
+// Navigation grid & goal flow fields
+// The arena is rasterised into square cells a diver standing on the seabed can or can't
+// occupy (its box against the live coral, majors and rocks). Every goal gets a BFS distance
+// field over the free cells (4-connected steps); the nearest-goal field is the minimum over
+// the visible goals and follows goal visibility incrementally: a collected goal only
+// recomputes the cells it was nearest for, a goal coming back only lowers cells. Divers
+// follow the field downhill. A* answers one-off cell-to-cell queries, in batches across
+// threads. Everything rebuilds lazily when layoutRevision moves on, except for streamed
+// chunks coming and going: only their cells are rasterised again and the fields repaired
+// around the cells that flipped.
+///////////////
+#include <vector>
+#include <cstdint>
+
+#include "coral_sim.h"
+
+struct NavGrid {
+	float cellSize; // at least navCellSize, grown so the grid stays under navMaxCells
+	int nx, nz; // cells from the arena origin
+	std::vector<uint8_t> blocked; // 1 = no room for a diver on the seabed here
+};
+
+const float navCellSize = 0.5f;
+const int navMaxCells = 2048 * 2048;
+const int32_t navUnreachable = INT32_MAX;
+
+extern NavGrid navGrid;
+
+struct NavStats {
+	double gridMs, fieldsMs; // last full rebuild: rasterising, one BFS per goal
+	double updateMs; // last incremental nearest-goal update
+	int updatedCells; // cells it rewrote
+	double chunkMs; // last streamed chunk update: re-rasterising its cells, repairing the fields
+	int flippedCells; // cells it blocked or freed
+};
+extern NavStats navStats;
+
+void syncNav(); // rebuilds after a layout change, applies goal visibility flips; not thread-safe
+void rebuildNearestGoalField(); // full nearest-goal pass over the visible goals (the incremental path's reference)
+
+int navCellAt(float x, float z); // -1 outside the grid
+void navCellCentre(int cell, float& x, float& z);
+// reads the synced fields only, so any number of threads can call these after syncNav
+int32_t navGoalDistance(int cell); // steps to the nearest visible goal, navUnreachable if none
+int navNearestGoal(int cell); // goal index, -1 if none is reachable
+int navNextCell(int cell); // the neighbour one step closer to the nearest goal (diagonals allowed), -1 at a goal or cut off
+const std::vector<int32_t>& navGoalField(int goal); // per-goal BFS steps
+// the flow path from (x, z) to the nearest visible goal as x, z pairs, empty if none is
+// reachable (syncs first)
+void navHintPath(float x, float z, std::vector<float>& xz);
+
+// A* over the free cells (8-connected, no corner cutting); path runs from..to inclusive.
+// Safe to call from several threads at once.
+bool navFindPath(int from, int to, std::vector<int>& path);
+
+struct NavQuery {
+	int from, to;
+};
+// one path per query (empty if unreachable), spread over the job system (coral_jobs.h)
+void navFindPaths(const std::vector<NavQuery>& queries, std::vector<std::vector<int>>& paths);
+float navPathLength(const std::vector<int>& path); // in cells (diagonal steps count sqrt 2)
@@ -0,0 +1,143 @@
+#include "coral_profiler.h"
+
+#include <cstdio>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+
+///////////////
+// Ring buffer
+// Writers claim slots with one atomic increment, so zones may close on any thread;
+// readers (overlay, export) run on the main thread between frames.
+///////////////
+const unsigned profileRingSize = 1u << 15; // events kept (power of two)
+
+bool profilerEnabled = false;
+thread_local int profilerDepth = 0;
+
+static ProfileEvent profileRing[profileRingSize];
+static std::atomic<unsigned> profileHead(0); // total events ever recorded
+static std::atomic<unsigned> profileFrame(0);
+static std::atomic<int> profileThreadCount(0);
+
+static int profilerThreadId() {
+	thread_local int id = profileThreadCount.fetch_add(1);
+	return id;
+}
+
+long long profilerNow() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void profilerBeginFrame() {
+	profileFrame.fetch_add(1);
+}
+
+void profilerRecord(const char* name, long long startNs, long long endNs, int depth) {
+	unsigned slot = profileHead.fetch_add(1) & (profileRingSize - 1);
+	ProfileEvent& e = profileRing[slot];
+	e.name = name;
+	e.startNs = startNs;
+	e.endNs = endNs;
+	e.frame = profileFrame.load(std::memory_order_relaxed);
+	e.depth = (short)depth;
+	e.thread = (short)profilerThreadId();
+}
+
+void profilerClear() {
+	profileHead = 0;
+}
+
+// number of events still in the ring and the index of the oldest one
+static unsigned ringSpan(unsigned& oldest) {
+	unsigned head = profileHead.load();
+	unsigned count = std::min(head, profileRingSize);
+	oldest = head - count;
+	return count;
+}
+
+static const ProfileEvent& ringAt(unsigned i) {
+	return profileRing[i & (profileRingSize - 1)];
+}
+
+///////////////
+// Overlay stats
+///////////////
+void profilerCollectStats(std::vector<ProfileStat>& out, int frames) {
+	out.clear();
+	unsigned current = profileFrame.load();
+	if (current <= 1 || frames <= 0) return;
+	// completed frames only: [first, current - 1]
+	unsigned last = current - 1;
+	unsigned first = last >= (unsigned)frames ? last - frames + 1 : 1;
+
+	std::vector<long long> orderStart; // first call of the zone in the newest frame it appears in
+	std::vector<unsigned> orderFrame;
+	unsigned oldest;
+	unsigned count = ringSpan(oldest);
+	for (unsigned i = 0;i < count;i++) {
+		const ProfileEvent& e = ringAt(oldest + i);
+		if (e.frame < first || e.frame > last) continue;
+		size_t k = 0;
+		while (k < out.size() && out[k].name != e.name) k++;
+		if (k == out.size()) {
+			out.push_back(ProfileStat{ e.name, e.depth, 0.0, 0.0, 0 });
+			orderStart.push_back(e.startNs);
+			orderFrame.push_back(e.frame);
+		}
+		double ms = (e.endNs - e.startNs) * 1e-6;
+		ProfileStat& s = out[k];
+		s.avgMs += ms;
+		s.maxMs = std::max(s.maxMs, ms);
+		s.calls++;
+		s.depth = std::min(s.depth, (int)e.depth);
+		if (e.frame > orderFrame[k] || (e.frame == orderFrame[k] && e.startNs < orderStart[k])) {
+			orderStart[k] = e.startNs;
+			orderFrame[k] = e.frame;
+		}
+	}
+
+	// zones of the newest frame in start order (parents before children), then older ones
+	std::vector<size_t> idx(out.size());
+	for (size_t i = 0;i < idx.size();i++) idx[i] = i;
+	std::sort(idx.begin(), idx.end(), [&](size_t a, size_t b) {
+		if (orderFrame[a] != orderFrame[b]) return orderFrame[a] > orderFrame[b];
+		return orderStart[a] < orderStart[b];
+		});
+	std::vector<ProfileStat> sorted;
+	for (size_t i : idx) {
+		sorted.push_back(out[i]);
+		sorted.back().avgMs /= (double)(last - first + 1);
+	}
+	out.swap(sorted);
+}
+
+///////////////
+// Chrome trace export
+///////////////
+bool profilerWriteChromeTrace(const char* path) {
+	FILE* f = fopen(path, "w");
+	if (!f) {
+		fprintf(stderr, "cannot write %s\n", path);
+		return false;
+	}
+	unsigned oldest;
+	unsigned count = ringSpan(oldest);
+	// events are stored as zones close, so parents come after their children
+	long long base = count > 0 ? ringAt(oldest).startNs : 0;
+	for (unsigned i = 0;i < count;i++) base = std::min(base, ringAt(oldest + i).startNs);
+
+	// complete events ("X"), timestamps in microseconds from the oldest event
+	fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	for (unsigned i = 0;i < count;i++) {
+		const ProfileEvent& e = ringAt(oldest + i);
+		fprintf(f, "%s\n{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+			"\"pid\":1,\"tid\":%d,\"args\":{\"frame\":%u}}",
+			i == 0 ? "" : ",", e.name, (e.startNs - base) * 1e-3, (e.endNs - e.startNs) * 1e-3,
+			e.thread, e.frame);
+	}
+	fprintf(f, "\n]}\n");
+	fclose(f);
+	return true;
+}
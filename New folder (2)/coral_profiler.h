@@ -0,0 +1,65 @@
+#pragma once
+///////////////
+// Hot-path profiler
+// Scoped zones record (name, start, end, depth, thread, frame) into a fixed ring buffer.
+// While profilerEnabled is false a zone costs one branch; building with
+// CORAL_DISABLE_PROFILER compiles the zones out entirely.
+// Zone names must be string literals (events keep the pointer).
+///////////////
+#include <vector>
+
+struct ProfileEvent {
+	const char* name;
+	long long startNs, endNs; // steady clock
+	unsigned frame;
+	short depth;
+	short thread;
+};
+
+// per-zone aggregate over the last few frames, in the order the zones start
+struct ProfileStat {
+	const char* name;
+	int depth;
+	double avgMs; // per frame
+	double maxMs; // slowest single call
+	int calls;
+};
+
+extern bool profilerEnabled;
+
+long long profilerNow();
+void profilerBeginFrame(); // starts frame N+1; call once at the top of the frame
+void profilerRecord(const char* name, long long startNs, long long endNs, int depth);
+void profilerClear();
+
+void profilerCollectStats(std::vector<ProfileStat>& out, int frames);
+bool profilerWriteChromeTrace(const char* path); // trace-event JSON (chrome://tracing, Perfetto)
+
+extern thread_local int profilerDepth;
+
+class ProfileZone {
+public:
+	explicit ProfileZone(const char* zoneName) : name(zoneName), start(0) {
+		if (!profilerEnabled) return;
+		start = profilerNow();
+		profilerDepth++;
+	}
+	~ProfileZone() {
+		if (start == 0) return;
+		profilerDepth--;
+		profilerRecord(name, start, profilerNow(), profilerDepth);
+	}
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+private:
+	const char* name;
+	long long start;
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#ifdef CORAL_DISABLE_PROFILER
+#define PROFILE_ZONE(name) ((void)0)
+#else
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#endif
@@ -0,0 +1,1214 @@
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include "coral_render.h"
+#include "coral_profiler.h"
+#include "coral_arena.h"
+#include "coral_stream.h"
+#include "coral_bvh.h"
+
+///////////////
+// Globals (camera & render targets)
+///////////////
+Camera camera;
+int cameraViewMode = 1; //1=behind,2=top,3=side
+float viewAspect = 640.0f / 480.0f;
+float renderAlpha = 1.0f;
+
+///////////////
+// Lighting & primitives (minor aesthetic changes)
+///////////////
+void setupLights() {
+	// Soft underwater ambient
+	GLfloat ambient[] = { 0.05f,0.12f,0.18f,1.0f };
+	GLfloat diffuse[] = { 0.2f,0.4f,0.6f,1.0f };
+	GLfloat specular[] = { 0.3f,0.6f,0.8f,1.0f };
+	GLfloat shininess[] = { 30.0f };
+
+	glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, ambient);
+	glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, diffuse);
+	glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, specular);
+	glMaterialfv(GL_FRONT_AND_BACK, GL_SHININESS, shininess);
+
+	GLfloat lightColor[] = { 0.4f,0.6f,0.9f,1.0f };
+	GLfloat lightPos[] = { -4.0f,6.0f,3.0f,1.0f };
+
+	glLightfv(GL_LIGHT0, GL_POSITION, lightPos);
+	glLightfv(GL_LIGHT0, GL_DIFFUSE, lightColor);
+	glLightfv(GL_LIGHT0, GL_SPECULAR, lightColor);
+}
+
+void setupCameraProjection() {
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	gluPerspective(60.0, viewAspect, 0.1, 200.0);
+
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+	camera.look();
+}
+
+void initRenderState() {
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_LIGHTING);
+	glEnable(GL_LIGHT0);
+	glEnable(GL_NORMALIZE);
+	glEnable(GL_COLOR_MATERIAL);
+	glShadeModel(GL_SMOOTH);
+}
+
+///////////////
+// Primitive mesh cache
+// Unit cube/sphere/cylinder/torus are tessellated once per LOD level into interleaved
+// normal+vertex arrays (GL_N3F_V3F triangles) and drawn by reference, instead of
+// re-tessellating through GLUT and allocating a GLU quadric on every call.
+///////////////
+Mesh meshCache[MESH_COUNT][LOD_COUNT];
+int meshDrawCount[MESH_COUNT]; // meshes drawn or queued since last reset (stats/benchmarks)
+int drawCallCount = 0;
+int stateChangeCount = 0;
+
+// LOD_HIGH matches the glutSolidSphere/gluCylinder/glutSolidTorus parameters used before
+const int sphereSlices[LOD_COUNT] = { 20, 12, 8, 6 };
+const int sphereStacks[LOD_COUNT] = { 12, 8, 5, 4 };
+const int cylinderSlices[LOD_COUNT] = { 16, 10, 6, 4 };
+const int cylinderStacks[LOD_COUNT] = { 2, 1, 1, 1 };
+const int torusSides[LOD_COUNT] = { 16, 10, 6, 4 };
+const int torusRings[LOD_COUNT] = { 30, 18, 10, 6 };
+const float torusTubeRatio = 0.15f; // tube radius / ring radius (0.03 / 0.20 of the goal ring)
+
+static void meshVertex(Mesh& m, float nx, float ny, float nz, float x, float y, float z) {
+	const float v[6] = { nx, ny, nz, x, y, z };
+	m.data.insert(m.data.end(), v, v + 6);
+}
+
+// quad a-b-c-d (counter-clockwise) as two triangles; each corner is nx,ny,nz,x,y,z
+static void meshQuad(Mesh& m, const float* a, const float* b, const float* c, const float* d) {
+	const float* tri[6] = { a, b, c, a, c, d };
+	for (const float* v : tri) meshVertex(m, v[0], v[1], v[2], v[3], v[4], v[5]);
+}
+
+static void buildCubeMesh(Mesh& m) {
+	// unit cube centred on the origin, flat normals (like glutSolidCube(1.0))
+	static const float n[6][3] = { {1,0,0},{-1,0,0},{0,1,0},{0,-1,0},{0,0,1},{0,0,-1} };
+	for (int f = 0;f < 6;f++) {
+		float nx = n[f][0], ny = n[f][1], nz = n[f][2];
+		// two tangents spanning the face
+		float ux = ny, uy = nz, uz = nx;
+		float vx = ny * uz - nz * uy, vy = nz * ux - nx * uz, vz = nx * uy - ny * ux;
+		float c[4][6];
+		const float su[4] = { -1, 1, 1, -1 }, sv[4] = { -1, -1, 1, 1 };
+		for (int k = 0;k < 4;k++) {
+			c[k][0] = nx; c[k][1] = ny; c[k][2] = nz;
+			c[k][3] = 0.5f * (nx + su[k] * ux + sv[k] * vx);
+			c[k][4] = 0.5f * (ny + su[k] * uy + sv[k] * vy);
+			c[k][5] = 0.5f * (nz + su[k] * uz + sv[k] * vz);
+		}
+		meshQuad(m, c[0], c[1], c[2], c[3]);
+	}
+}
+
+static void buildSphereMesh(Mesh& m, int slices, int stacks) {
+	// radius 0.5, poles on the z axis (like glutSolidSphere)
+	const float PI = 3.14159265f;
+	auto corner = [](float* out, float phi, float theta) {
+		out[0] = sinf(phi) * cosf(theta);
+		out[1] = sinf(phi) * sinf(theta);
+		out[2] = cosf(phi);
+		out[3] = 0.5f * out[0]; out[4] = 0.5f * out[1]; out[5] = 0.5f * out[2];
+		};
+	for (int i = 0;i < stacks;i++) {
+		float p0 = PI * i / stacks, p1 = PI * (i + 1) / stacks;
+		for (int j = 0;j < slices;j++) {
+			float t0 = 2.0f * PI * j / slices, t1 = 2.0f * PI * (j + 1) / slices;
+			float a[6], b[6], c[6], d[6];
+			corner(a, p0, t0); corner(b, p1, t0); corner(c, p1, t1); corner(d, p0, t1);
+			meshQuad(m, a, b, c, d);
+		}
+	}
+}
+
+static void buildCylinderMesh(Mesh& m, int slices, int stacks) {
+	// radius 0.5 from z=0 to z=1, no caps (like gluCylinder)
+	const float PI = 3.14159265f;
+	for (int i = 0;i < stacks;i++) {
+		float z0 = (float)i / stacks, z1 = (float)(i + 1) / stacks;
+		for (int j = 0;j < slices;j++) {
+			float t0 = 2.0f * PI * j / slices, t1 = 2.0f * PI * (j + 1) / slices;
+			float c0 = cosf(t0), s0 = sinf(t0), c1 = cosf(t1), s1 = sinf(t1);
+			float a[6] = { c0, s0, 0, 0.5f * c0, 0.5f * s0, z0 };
+			float b[6] = { c1, s1, 0, 0.5f * c1, 0.5f * s1, z0 };
+			float c[6] = { c1, s1, 0, 0.5f * c1, 0.5f * s1, z1 };
+			float d[6] = { c0, s0, 0, 0.5f * c0, 0.5f * s0, z1 };
+			meshQuad(m, a, b, c, d);
+		}
+	}
+}
+
+static void buildTorusMesh(Mesh& m, int sides, int rings) {
+	// ring radius 1 around the z axis, tube radius torusTubeRatio (like glutSolidTorus)
+	const float PI = 3.14159265f;
+	auto corner = [](float* out, float u, float v) {
+		out[0] = cosf(v) * cosf(u);
+		out[1] = cosf(v) * sinf(u);
+		out[2] = sinf(v);
+		out[3] = cosf(u) + torusTubeRatio * out[0];
+		out[4] = sinf(u) + torusTubeRatio * out[1];
+		out[5] = torusTubeRatio * out[2];
+		};
+	for (int i = 0;i < rings;i++) {
+		float u0 = 2.0f * PI * i / rings, u1 = 2.0f * PI * (i + 1) / rings;
+		for (int j = 0;j < sides;j++) {
+			float v0 = 2.0f * PI * j / sides, v1 = 2.0f * PI * (j + 1) / sides;
+			float a[6], b[6], c[6], d[6];
+			corner(a, u0, v0); corner(b, u1, v0); corner(c, u1, v1); corner(d, u0, v1);
+			meshQuad(m, a, b, c, d);
+		}
+	}
+}
+
+void initPrimitiveMeshes() {
+	for (int lod = 0;lod < LOD_COUNT;lod++) {
+		for (int id = 0;id < MESH_COUNT;id++) meshCache[id][lod].data.clear();
+		buildCubeMesh(meshCache[MESH_CUBE][lod]);
+		buildSphereMesh(meshCache[MESH_SPHERE][lod], sphereSlices[lod], sphereStacks[lod]);
+		buildCylinderMesh(meshCache[MESH_CYLINDER][lod], cylinderSlices[lod], cylinderStacks[lod]);
+		buildTorusMesh(meshCache[MESH_TORUS][lod], torusSides[lod], torusRings[lod]);
+	}
+}
+
+static void drawMeshArrays(const Mesh& m) {
+	glInterleavedArrays(GL_N3F_V3F, 0, m.data.data());
+	glDrawArrays(GL_TRIANGLES, 0, m.vertexCount());
+	drawCallCount++;
+	stateChangeCount++;
+}
+
+void drawMesh(MeshId id, MeshLod lod) {
+	drawMeshArrays(meshCache[id][lod]);
+	meshDrawCount[id]++;
+}
+
+static void drawUnitCube() { drawMesh(MESH_CUBE); }
+static void drawUnitSphere() { drawMesh(MESH_SPHERE); }
+
+///////////////
+// Prop batches
+// Repeated props are submitted as instances into per-type SoA arrays (transform, colour,
+// animation phase) and expanded on the CPU, all types back to back, into one C4F_N3F_V3F
+// vertex array, so every prop costs the same single draw call. The fixed-function pipeline
+// has no per-instance attributes, so CPU expansion is the instanced path here. Every
+// instance carries its own mesh level, so near and far copies still share the one draw.
+// Instances live in the scene bins; the array is laid out serially (one vertex offset per
+// piece of up to propPieceSize instances) and the pieces are expanded as jobs.
+///////////////
+PropBatch propBatches[PROP_COUNT];
+std::vector<float> propVerts; // expanded r,g,b,a, nx,ny,nz, x,y,z; capacity reused
+size_t propVertexCount = 0;
+
+struct PropPiece {
+	int type, bin;
+	int first, last; // instances
+	size_t vertex; // first vertex in propVerts
+};
+const int propPieceSize = 1024;
+std::vector<PropPiece> propPieces;
+Mesh seaweedBladeMesh; // one blade triangle, height 1
+Mesh impostorMesh; // hexagonal disc of diameter 1 facing +z
+float billboardBasis[9]; // camera right, up and back as columns (row-major), set by beginLodFrame
+
+void initPropBatches() {
+	seaweedBladeMesh.data.clear();
+	meshVertex(seaweedBladeMesh, 0, 0, 1, 0.0f, 0.0f, 0);
+	meshVertex(seaweedBladeMesh, 0, 0, 1, -0.08f, 0.5f, 0);
+	meshVertex(seaweedBladeMesh, 0, 0, 1, 0.08f, 1.0f, 0);
+
+	impostorMesh.data.clear();
+	for (int k = 0;k < 6;k++) {
+		float a0 = DEG2RAD(60.0f * k), a1 = DEG2RAD(60.0f * (k + 1));
+		meshVertex(impostorMesh, 0, 0, 1, 0.0f, 0.0f, 0);
+		meshVertex(impostorMesh, 0, 0, 1, 0.5f * cosf(a0), 0.5f * sinf(a0), 0);
+		meshVertex(impostorMesh, 0, 0, 1, 0.5f * cosf(a1), 0.5f * sinf(a1), 0);
+	}
+
+	const struct { const Mesh* mesh; int levels; float baseRotX; PropAnim anim; } types[PROP_COUNT] = {
+		{ meshCache[MESH_CYLINDER], LOD_COUNT, -90.0f, ANIM_DRIFT_Z }, // PROP_CORAL_TUBE
+		{ &seaweedBladeMesh, 1, 0.0f, ANIM_SWAY }, // PROP_SEAWEED
+		{ meshCache[MESH_SPHERE], LOD_COUNT, 0.0f, ANIM_NONE }, // PROP_ROCK
+		{ meshCache[MESH_TORUS], LOD_COUNT, 0.0f, ANIM_NONE }, // PROP_GOAL_RING
+		{ meshCache[MESH_SPHERE], LOD_COUNT, 0.0f, ANIM_NONE }, // PROP_GOAL_ORB
+		{ meshCache[MESH_CYLINDER], LOD_COUNT, -90.0f, ANIM_NONE }, // PROP_GOAL_STEM
+		{ &impostorMesh, 1, 0.0f, ANIM_BILLBOARD }, // PROP_IMPOSTOR
+	};
+	for (int i = 0;i < PROP_COUNT;i++) {
+		propBatches[i].mesh = types[i].mesh;
+		propBatches[i].levels = types[i].levels;
+		propBatches[i].baseRotX = types[i].baseRotX;
+		propBatches[i].anim = types[i].anim;
+	}
+}
+
+void addPropInstance(PropType type, float x, float y, float z, float yaw,
+	float sx, float sy, float sz, float r, float g, float b, float phase, MeshLod lod) {
+	PropInstances& in = sceneBin->props[type];
+	in.x.push_back(x); in.y.push_back(y); in.z.push_back(z);
+	in.yaw.push_back(yaw);
+	in.sx.push_back(sx); in.sy.push_back(sy); in.sz.push_back(sz);
+	in.r.push_back(r); in.g.push_back(g); in.b.push_back(b);
+	in.phase.push_back(phase);
+	in.lod.push_back((unsigned char)lod);
+}
+
+static const Mesh& propMesh(const PropBatch& pb, const PropInstances& in, size_t i) {
+	return pb.mesh[std::min((int)in.lod[i], pb.levels - 1)];
+}
+
+// expand instances [first, last) into world-space vertices at out: p' = Ry(yaw) Rx(base) S p + t
+// (billboards: p' = B S p + t with B the camera basis)
+static void expandPropInstances(const PropBatch& pb, const PropInstances& in, int first, int last, float t, float* out) {
+	float baseRad = DEG2RAD(pb.baseRotX);
+	float cx = cosf(baseRad), sx = sinf(baseRad);
+	for (int i = first;i < last;i++) {
+		float yaw = in.yaw[i];
+		float tz = in.z[i];
+		if (pb.anim == ANIM_SWAY) yaw += sinf(t + in.phase[i]) * 20.0f;
+		else if (pb.anim == ANIM_DRIFT_Z) tz += sinf(t + in.phase[i]) * 0.03f;
+		float yawRad = DEG2RAD(yaw);
+		float cy = cosf(yawRad), sy = sinf(yawRad);
+		// R = Ry * Rx (row-major)
+		float R[9] = {
+			cy, sy * sx, sy * cx,
+			0.0f, cx, -sx,
+			-sy, cy * sx, cy * cx
+		};
+		if (pb.anim == ANIM_BILLBOARD) std::copy(billboardBasis, billboardBasis + 9, R);
+		float s0 = in.sx[i], s1 = in.sy[i], s2 = in.sz[i];
+		float i0 = 1.0f / s0, i1 = 1.0f / s1, i2 = 1.0f / s2;
+		float tx = in.x[i], ty = in.y[i];
+		float cr = in.r[i], cg = in.g[i], cb = in.b[i];
+		const Mesh& m = propMesh(pb, in, i);
+		const float* v = m.data.data();
+		const int nv = m.vertexCount();
+		for (int k = 0;k < nv;k++, v += 6) {
+			float nx = v[0] * i0, ny = v[1] * i1, nz = v[2] * i2; // normals use S^-1 (GL_NORMALIZE rescales)
+			float px = v[3] * s0, py = v[4] * s1, pz = v[5] * s2;
+			out[0] = cr; out[1] = cg; out[2] = cb; out[3] = 1.0f;
+			out[4] = R[0] * nx + R[1] * ny + R[2] * nz;
+			out[5] = R[3] * nx + R[4] * ny + R[5] * nz;
+			out[6] = R[6] * nx + R[7] * ny + R[8] * nz;
+			out[7] = R[0] * px + R[1] * py + R[2] * pz + tx;
+			out[8] = R[3] * px + R[4] * py + R[5] * pz + ty;
+			out[9] = R[6] * px + R[7] * py + R[8] * pz + tz;
+			out += 10;
+		}
+	}
+}
+
+void expandPropBatches(const SceneBin* bins, int count, float t) {
+	propPieces.clear();
+	size_t total = 0;
+	for (int type = 0;type < PROP_COUNT;type++) {
+		const PropBatch& pb = propBatches[type];
+		for (int b = 0;b < count;b++) {
+			const PropInstances& in = bins[b].props[type];
+			for (int first = 0;first < (int)in.size();first += propPieceSize) {
+				int last = std::min(first + propPieceSize, (int)in.size());
+				propPieces.push_back(PropPiece{ type, b, first, last, total });
+				for (int i = first;i < last;i++) total += propMesh(pb, in, i).vertexCount();
+			}
+		}
+	}
+	propVertexCount = total;
+	propVerts.resize(total * 10);
+	parallelFor((int)propPieces.size(), 1, [&](int begin, int end) {
+		for (int k = begin;k < end;k++) {
+			const PropPiece& pc = propPieces[k];
+			expandPropInstances(propBatches[pc.type], bins[pc.bin].props[pc.type], pc.first, pc.last, t,
+				propVerts.data() + pc.vertex * 10);
+		}
+		});
+}
+
+void drawPropBatches() {
+	if (propVertexCount == 0) return;
+	glInterleavedArrays(GL_C4F_N3F_V3F, 0, propVerts.data());
+	glDrawArrays(GL_TRIANGLES, 0, (GLsizei)propVertexCount);
+	glDisableClientState(GL_COLOR_ARRAY);
+	drawCallCount++;
+	stateChangeCount += 2;
+}
+
+///////////////
+// Render queue
+// Multi-part models (diver, major objects) and the boundary walls submit one record per
+// part: mesh, level, world transform built on the CPU and colour. The batched flush orders
+// the records by state key (mesh, then level) and expands them into one C4F_N3F_V3F array,
+// colour per vertex like the prop batches, so the whole queue is a single draw with no
+// glColor or matrix stack calls. --unbatched replays the records one by one (push,
+// multiply, colour, draw, pop) for before/after counts. Records are queued into the scene
+// bins; the sort is serial, the expansion runs as jobs over the sorted records.
+///////////////
+bool renderQueueBatched = true;
+std::vector<RenderItem> renderQueue; // the bins' records in submission order
+std::vector<uint64_t> renderQueueOrder; // state key << 32 | submission index
+std::vector<size_t> renderQueueFirst; // first vertex of each sorted record
+std::vector<float> renderQueueVerts; // capacity reused across frames
+size_t renderQueueVertexCount = 0;
+
+Xform Xform::identity() {
+	return Xform{ { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0 } };
+}
+
+void Xform::translate(float x, float y, float z) {
+	for (int r = 0;r < 3;r++) m[r * 4 + 3] += m[r * 4 + 0] * x + m[r * 4 + 1] * y + m[r * 4 + 2] * z;
+}
+
+// same matrix as glRotatef
+void Xform::rotate(float angle, float ax, float ay, float az) {
+	float rad = DEG2RAD(angle);
+	float c = cosf(rad), s = sinf(rad), k = 1.0f - c;
+	const float R[9] = {
+		ax * ax * k + c, ax * ay * k - az * s, ax * az * k + ay * s,
+		ay * ax * k + az * s, ay * ay * k + c, ay * az * k - ax * s,
+		az * ax * k - ay * s, az * ay * k + ax * s, az * az * k + c
+	};
+	for (int r = 0;r < 3;r++) {
+		float a0 = m[r * 4 + 0], a1 = m[r * 4 + 1], a2 = m[r * 4 + 2];
+		for (int j = 0;j < 3;j++) m[r * 4 + j] = a0 * R[j] + a1 * R[3 + j] + a2 * R[6 + j];
+	}
+}
+
+void Xform::scale(float x, float y, float z) {
+	for (int r = 0;r < 3;r++) {
+		m[r * 4 + 0] *= x; m[r * 4 + 1] *= y; m[r * 4 + 2] *= z;
+	}
+}
+
+void queueMesh(MeshId id, MeshLod lod, const Xform& xf, float r, float g, float b) {
+	sceneBin->items.push_back(RenderItem{ id, lod, xf, r, g, b });
+	sceneBin->meshDraws[id]++;
+}
+
+// p' = A p + t; normals by the cofactor matrix of A (inverse transpose up to scale,
+// GL_NORMALIZE rescales)
+static void expandRenderItem(const RenderItem& it, float* out) {
+	const float* a = it.xf.m;
+	float c0[3] = { a[0], a[4], a[8] }, c1[3] = { a[1], a[5], a[9] }, c2[3] = { a[2], a[6], a[10] };
+	auto cross = [](const float* u, const float* v, float* w) {
+		w[0] = u[1] * v[2] - u[2] * v[1];
+		w[1] = u[2] * v[0] - u[0] * v[2];
+		w[2] = u[0] * v[1] - u[1] * v[0];
+		};
+	float n0[3], n1[3], n2[3];
+	cross(c1, c2, n0); cross(c2, c0, n1); cross(c0, c1, n2);
+
+	const Mesh& mesh = meshCache[it.mesh][it.lod];
+	const float* v = mesh.data.data();
+	for (int k = 0;k < mesh.vertexCount();k++, v += 6) {
+		out[0] = it.r; out[1] = it.g; out[2] = it.b; out[3] = 1.0f;
+		out[4] = n0[0] * v[0] + n1[0] * v[1] + n2[0] * v[2];
+		out[5] = n0[1] * v[0] + n1[1] * v[1] + n2[1] * v[2];
+		out[6] = n0[2] * v[0] + n1[2] * v[1] + n2[2] * v[2];
+		out[7] = a[0] * v[3] + a[1] * v[4] + a[2] * v[5] + a[3];
+		out[8] = a[4] * v[3] + a[5] * v[4] + a[6] * v[5] + a[7];
+		out[9] = a[8] * v[3] + a[9] * v[4] + a[10] * v[5] + a[11];
+		out += 10;
+	}
+}
+
+void expandRenderQueue(const SceneBin* bins, int count) {
+	renderQueue.clear();
+	for (int b = 0;b < count;b++) renderQueue.insert(renderQueue.end(), bins[b].items.begin(), bins[b].items.end());
+	if (!renderQueueBatched) return;
+
+	// everything else (material, lighting) is shared, so the key is the mesh array alone
+	renderQueueOrder.clear();
+	for (size_t i = 0;i < renderQueue.size();i++) {
+		const RenderItem& it = renderQueue[i];
+		uint64_t key = (uint64_t)(it.mesh * LOD_COUNT + it.lod);
+		renderQueueOrder.push_back(key << 32 | i);
+	}
+	std::sort(renderQueueOrder.begin(), renderQueueOrder.end());
+
+	renderQueueFirst.resize(renderQueueOrder.size());
+	size_t total = 0;
+	for (size_t k = 0;k < renderQueueOrder.size();k++) {
+		const RenderItem& it = renderQueue[(uint32_t)renderQueueOrder[k]];
+		renderQueueFirst[k] = total;
+		total += meshCache[it.mesh][it.lod].vertexCount();
+	}
+	renderQueueVertexCount = total;
+	renderQueueVerts.resize(total * 10);
+	parallelFor((int)renderQueueOrder.size(), 256, [](int begin, int end) {
+		for (int k = begin;k < end;k++)
+			expandRenderItem(renderQueue[(uint32_t)renderQueueOrder[k]], renderQueueVerts.data() + renderQueueFirst[k] * 10);
+		});
+}
+
+void drawRenderQueue() {
+	if (renderQueue.empty()) return;
+	if (!renderQueueBatched) {
+		for (const RenderItem& it : renderQueue) {
+			const float* a = it.xf.m;
+			const GLfloat m[16] = { a[0], a[4], a[8], 0, a[1], a[5], a[9], 0, a[2], a[6], a[10], 0, a[3], a[7], a[11], 1 };
+			glPushMatrix();
+			glMultMatrixf(m);
+			glColor3f(it.r, it.g, it.b);
+			drawMeshArrays(meshCache[it.mesh][it.lod]);
+			glPopMatrix();
+			stateChangeCount += 4;
+		}
+		return;
+	}
+	glInterleavedArrays(GL_C4F_N3F_V3F, 0, renderQueueVerts.data());
+	glDrawArrays(GL_TRIANGLES, 0, (GLsizei)renderQueueVertexCount);
+	glDisableClientState(GL_COLOR_ARRAY);
+	drawCallCount++;
+	stateChangeCount += 2;
+}
+
+///////////////
+// Arena drawing helpers
+///////////////
+void DrawSeabed(float width, float depth) {
+	glPushMatrix();
+	glColor3f(0.06f, 0.2f, 0.12f); // deep seabed
+	glTranslatef(width / 2.0f, 0.0f, depth / 2.0f);
+	glScalef(width, 0.05f, depth);
+	drawUnitCube();
+	glPopMatrix();
+}
+
+// animated colour from the wall's corner, through the render queue
+void QueueBoundaryWallBox(const AABB& box, float colorPhaseLocal) {
+	float x = box.minx, z = box.minz;
+	float r = 0.4f + 0.2f * sinf(colorPhaseLocal + x + z);
+	float g = 0.2f + 0.15f * cosf(colorPhaseLocal * 1.1f + x - z);
+	float b = 0.25f + 0.15f * sinf(colorPhaseLocal * 0.7f - x + z);
+	Xform xf = Xform::identity();
+	xf.translate((box.minx + box.maxx) / 2.0f, (box.miny + box.maxy) / 2.0f, (box.minz + box.maxz) / 2.0f);
+	xf.scale(box.maxx - box.minx, box.maxy - box.miny, box.maxz - box.minz);
+	queueMesh(MESH_CUBE, LOD_HIGH, xf, r, g, b);
+}
+
+void DrawCoralBox(const CoralSegment& c) {
+	if (!c.visible) return;
+	glPushMatrix();
+	glTranslatef(c.x + c.w / 2.0f, c.y + c.h / 2.0f, c.z + c.d / 2.0f);
+	glColor3f(0.9f, 0.35f, 0.5f);
+	glScalef(c.w, c.h, c.d);
+	drawUnitCube();
+	glPopMatrix();
+}
+
+void BatchCoralTubes(const CoralSegment& c, MeshLod lod) {
+	if (!c.visible) return;
+	float cx = c.x + c.w / 2.0f, cy = c.y + c.h / 2.0f, cz = c.z + c.d / 2.0f;
+
+	// small tubes (non-colliding decoration); drift phase = tube index
+	int tubes = 3;
+	for (int i = 0;i < tubes;i++) {
+		float dx = (i - 1) * 0.15f;
+		addPropInstance(PROP_CORAL_TUBE, cx + dx, cy + c.h / 2.0f + 0.12f, cz, 0.0f,
+			0.18f, 0.18f, 0.4f, 0.9f, 0.35f, 0.5f, (float)i, lod);
+	}
+}
+
+// the three tubes on top of the box (their size sets the LOD, not the box's)
+AABB getCoralTubesAABB(const CoralSegment& c) {
+	float cx = c.x + c.w / 2.0f, top = c.y + c.h, cz = c.z + c.d / 2.0f;
+	return AABB{ cx - 0.25f, top, cz - 0.13f, cx + 0.25f, top + 0.55f, cz + 0.13f };
+}
+
+void DrawRock(float x, float y, float z, float s) {
+	glPushMatrix();
+	glColor3f(0.2f, 0.2f, 0.25f);
+	glTranslatef(x, y, z);
+	glScalef(s, s * 0.6f, s);
+	drawUnitSphere();
+	glPopMatrix();
+}
+
+// phaseOffset is added to the frame time; the blade sways by sin(t + phaseOffset + x + z)
+void BatchSeaweed(float x, float y, float z, float height, float phaseOffset) {
+	addPropInstance(PROP_SEAWEED, x, y, z, 0.0f, 1.0f, height, 1.0f,
+		0.05f, 0.6f, 0.2f, phaseOffset + x + z);
+}
+
+///////////////
+// Diver
+// Up close (LOD_HIGH/MEDIUM) the full seven-part model; from the fixed views the diver is a
+// few pixels tall, so LOD_LOW merges the legs and drops the arms (four parts) and
+// LOD_MINIMAL is one body box and the head.
+///////////////
+void QueueDiverModel(float x, float y, float z, float angleY, float pitch, float scale, MeshLod lod) {
+	Xform base = Xform::identity();
+	base.translate(x, y, z);
+	// apply yaw (y-axis) then pitch (x-axis) so airborne tilt keeps facing direction
+	base.rotate(angleY, 0, 1, 0);
+	base.rotate(pitch, 1, 0, 0);
+	base.scale(scale, scale, scale);
+
+	// one part: offset, optional tilt about x, size
+	auto part = [&](MeshId id, float tx, float ty, float tz, float tilt, float sx, float sy, float sz,
+		float r, float g, float b) {
+			Xform xf = base;
+			xf.translate(tx, ty, tz);
+			if (tilt != 0.0f) xf.rotate(tilt, 1, 0, 0);
+			xf.scale(sx, sy, sz);
+			queueMesh(id, id == MESH_CUBE ? LOD_HIGH : lod, xf, r, g, b);
+		};
+
+	if (lod == LOD_MINIMAL) {
+		// torso down to the feet, and the head
+		part(MESH_CUBE, 0.0f, 0.425f, 0.0f, 0.0f, 0.6f, 1.25f, 0.35f, 0.15f, 0.45f, 0.7f);
+		part(MESH_SPHERE, 0.0f, 1.15f, 0.0f, 0.0f, 0.45f, 0.45f, 0.45f, 0.95f, 0.85f, 0.75f);
+		return;
+	}
+
+	part(MESH_CUBE, 0.0f, 0.6f, 0.0f, 0.0f, 0.6f, 0.9f, 0.35f, 0.15f, 0.45f, 0.7f); // torso
+	part(MESH_SPHERE, 0.0f, 1.15f, 0.0f, 0.0f, 0.45f, 0.45f, 0.45f, 0.95f, 0.85f, 0.75f); // head
+	if (lod == LOD_LOW) {
+		part(MESH_CUBE, 0.0f, 0.1f, 0.0f, 0.0f, 0.54f, 0.6f, 0.18f, 0.1f, 0.1f, 0.2f); // both legs as one box
+	}
+	else {
+		part(MESH_CUBE, -0.5f, 0.7f, 0.0f, 0.0f, 0.18f, 0.6f, 0.18f, 0.15f, 0.45f, 0.7f); // left arm
+		part(MESH_CUBE, 0.5f, 0.7f, 0.0f, 0.0f, 0.18f, 0.6f, 0.18f, 0.15f, 0.45f, 0.7f); // right arm
+		part(MESH_CUBE, -0.18f, 0.1f, 0.0f, 0.0f, 0.18f, 0.6f, 0.18f, 0.1f, 0.1f, 0.2f); // left leg
+		part(MESH_CUBE, 0.18f, 0.1f, 0.0f, 0.0f, 0.18f, 0.6f, 0.18f, 0.1f, 0.1f, 0.2f); // right leg
+	}
+	part(MESH_CYLINDER, 0.0f, 0.6f, -0.35f, -90.0f, 0.35f, 0.35f, 0.8f, 0.02f, 0.45f, 0.25f); // oxygen tank
+}
+
+// model extents (unit model x +-0.6, y -0.2..1.4, tank at z -0.75) around the diver's feet
+AABB getDiverModelAABB(float x, float y, float z, float scale) {
+	return AABB{ x - 0.6f * scale, y - 0.2f * scale, z - 0.8f * scale,
+		x + 0.6f * scale, y + 1.4f * scale, z + 0.8f * scale };
+}
+
+///////////////
+// Goal portal (visible & always non-blocking)
+///////////////
+void BatchGoalPortal(const GoalObj& g, float tphase, MeshLod lod) {
+	if (!g.visible) return;
+	float y = g.y + 0.18f * sinf(tphase * 2.0f);
+	float spin = tphase * 40.0f;
+
+	if (lod == LOD_IMPOSTOR) {
+		// far away: one gold disc the size of the ring
+		addPropInstance(PROP_IMPOSTOR, g.x, y, g.z, 0.0f, 0.46f, 0.46f, 1.0f, 0.95f, 0.65f, 0.08f, 0.0f);
+		return;
+	}
+	addPropInstance(PROP_GOAL_RING, g.x, y, g.z, spin, 0.20f, 0.20f, 0.20f, 0.9f, 0.5f, 0.05f, 0.0f, lod);
+	addPropInstance(PROP_GOAL_ORB, g.x, y, g.z, spin, 0.24f, 0.24f, 0.24f, 1.0f, 0.8f, 0.1f, 0.0f, lod);
+	addPropInstance(PROP_GOAL_STEM, g.x, y - 0.55f, g.z, spin, 0.05f, 0.05f, 1.0f, 0.95f, 0.7f, 0.15f, 0.0f, lod);
+}
+
+///////////////
+// Major object (>=5 primitives)
+///////////////
+void QueueMajorObj(const SceneObj& o, MeshLod lod) {
+	if (!o.visible) return;
+	Xform base = Xform::identity();
+	base.translate(o.x, o.y, o.z);
+	base.rotate(o.animPhase * 60.0f, 0, 1, 0);
+
+	// one part: offset, optional tilt (degrees about the axis), size
+	auto part = [&](MeshId id, float tx, float ty, float tz, float tilt, float ax, float ay, float az,
+		float sx, float sy, float sz, float r, float g, float b) {
+			Xform xf = base;
+			xf.translate(tx, ty, tz);
+			if (tilt != 0.0f) xf.rotate(tilt, ax, ay, az);
+			xf.scale(sx, sy, sz);
+			queueMesh(id, id == MESH_CUBE ? LOD_HIGH : lod, xf, r, g, b);
+		};
+
+	part(MESH_CUBE, 0, 0.10f, 0, 0, 0, 0, 0, 0.7f, 0.20f, 0.7f, 0.6f, 0.6f, 0.6f); // base
+	part(MESH_CYLINDER, 0, 0.24f, 0, -90, 1, 0, 0, 0.12f, 0.12f, 0.9f, 0.45f, 0.45f, 0.5f); // mast
+	part(MESH_CUBE, 0.20f, 0.72f, 0, 20, 0, 0, 1, 0.40f, 0.09f, 0.09f, 0.8f, 0.4f, 0.2f); // arms
+	part(MESH_CUBE, 0.40f, 0.82f, 0, 10, 0, 0, 1, 0.28f, 0.08f, 0.08f, 0.7f, 0.35f, 0.2f);
+	part(MESH_SPHERE, 0.48f, 0.90f, 0, 0, 0, 0, 0, 0.08f, 0.08f, 0.08f, 0.95f, 0.9f, 0.3f); // hook
+}
+
+///////////////
+// Regular object (>=3 primitives)
+///////////////
+void BatchRegularObj(const SceneObj& o, MeshLod lod) {
+	if (!o.visible) return;
+	if (lod == LOD_IMPOSTOR) {
+		// far away: one disc in the mix of the rock and its seaweed
+		addPropInstance(PROP_IMPOSTOR, o.x, o.y + 0.2f, o.z, 0.0f, 0.5f, 0.5f, 1.0f, 0.15f, 0.42f, 0.24f, 0.0f);
+		return;
+	}
+	float yaw = o.animPhase * 90.0f;
+	float rad = DEG2RAD(yaw);
+	// local (+-0.12, 0, 0) offsets rotated by the object's yaw
+	float ox = 0.12f * cosf(rad), oz = -0.12f * sinf(rad);
+
+	// rock base
+	addPropInstance(PROP_ROCK, o.x, o.y, o.z, yaw, 0.5f, 0.28f, 0.5f, 0.25f, 0.25f, 0.28f, 0.0f, lod);
+
+	// seaweed (sway phase uses the blade's local position, as before)
+	addPropInstance(PROP_SEAWEED, o.x + ox, o.y, o.z + oz, yaw, 1.0f, 0.9f, 1.0f,
+		0.05f, 0.6f, 0.2f, o.x + 0.12f);
+	addPropInstance(PROP_SEAWEED, o.x - ox, o.y, o.z - oz, yaw, 1.0f, 0.7f, 1.0f,
+		0.05f, 0.6f, 0.2f, -o.x - 0.12f);
+}
+
+///////////////
+// View-frustum culling
+// Planes are extracted from projection * modelview right after setupCameraProjection()
+// (gluPerspective + Camera::look()) and every drawable is tested by its AABB first.
+///////////////
+Frustum viewFrustum;
+CullStats cullStats;
+bool showCullStats = false;
+
+void extractViewFrustum(Frustum& f) {
+	GLfloat proj[16], view[16], m[16];
+	glGetFloatv(GL_PROJECTION_MATRIX, proj);
+	glGetFloatv(GL_MODELVIEW_MATRIX, view);
+	// m = proj * view (column-major)
+	for (int c = 0;c < 4;c++)
+		for (int r = 0;r < 4;r++)
+			m[c * 4 + r] = proj[0 * 4 + r] * view[c * 4 + 0] + proj[1 * 4 + r] * view[c * 4 + 1] +
+			proj[2 * 4 + r] * view[c * 4 + 2] + proj[3 * 4 + r] * view[c * 4 + 3];
+
+	// left, right, bottom, top, near, far = row3 +- row0/1/2
+	for (int i = 0;i < 6;i++) {
+		int row = i / 2;
+		float sign = (i % 2 == 0) ? 1.0f : -1.0f;
+		for (int k = 0;k < 4;k++)
+			f.planes[i][k] = m[k * 4 + 3] + sign * m[k * 4 + row];
+	}
+}
+
+bool frustumTestAABB(const Frustum& f, const AABB& b) {
+	for (int i = 0;i < 6;i++) {
+		const float* p = f.planes[i];
+		// farthest corner along the plane normal
+		float x = p[0] >= 0 ? b.maxx : b.minx;
+		float y = p[1] >= 0 ? b.maxy : b.miny;
+		float z = p[2] >= 0 ? b.maxz : b.minz;
+		if (p[0] * x + p[1] * y + p[2] * z + p[3] < 0) return false;
+	}
+	return true;
+}
+
+// count = how many scene objects the box stands for
+bool cullVisible(const AABB& b, int count) {
+	if (frustumTestAABB(viewFrustum, b)) {
+		sceneBin->cull.drawn += count;
+		return true;
+	}
+	sceneBin->cull.culled += count;
+	return false;
+}
+
+AABB aabbGrow(const AABB& b, float dx, float dyDown, float dyUp, float dz) {
+	return AABB{ b.minx - dx, b.miny - dyDown, b.minz - dz, b.maxx + dx, b.maxy + dyUp, b.maxz + dz };
+}
+
+///////////////
+// Level of detail
+// A drawable's level comes from the radius its bounding sphere projects to on screen, so
+// detail falls off with distance and object size alike, and a bigger window keeps more of
+// it. Goals and regular objects under lodImpostorPixels are billboards (PROP_IMPOSTOR).
+///////////////
+bool lodEnabled = true;
+const float lodPixels[LOD_MINIMAL] = { 16.0f, 8.0f, 4.0f }; // smallest radius for HIGH, MEDIUM, LOW
+const float lodImpostorPixels = 3.0f;
+float lodPixelScale = 1.0f; // pixels per world unit at distance 1
+int lodObjectCount[LOD_COUNT + 1];
+
+void beginLodFrame() {
+	// gluPerspective(60, ...) in setupCameraProjection
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	lodPixelScale = viewport[3] / (2.0f * tanf(DEG2RAD(30.0f)));
+
+	Vector3f back = (camera.eye - camera.center).unit();
+	Vector3f right = camera.up.cross(back).unit();
+	Vector3f up = back.cross(right);
+	const float basis[9] = {
+		right.x, up.x, back.x,
+		right.y, up.y, back.y,
+		right.z, up.z, back.z
+	};
+	std::copy(basis, basis + 9, billboardBasis);
+}
+
+MeshLod selectLod(const AABB& b, bool impostor) {
+	int lod = LOD_HIGH;
+	if (lodEnabled) {
+		float hx = (b.maxx - b.minx) * 0.5f, hy = (b.maxy - b.miny) * 0.5f, hz = (b.maxz - b.minz) * 0.5f;
+		float dx = b.minx + hx - camera.eye.x, dy = b.miny + hy - camera.eye.y, dz = b.minz + hz - camera.eye.z;
+		float radius = sqrtf(hx * hx + hy * hy + hz * hz);
+		float dist = std::max(sqrtf(dx * dx + dy * dy + dz * dz), radius);
+		float pixels = radius * lodPixelScale / dist;
+		while (lod < LOD_MINIMAL && pixels < lodPixels[lod]) lod++;
+		if (impostor && pixels < lodImpostorPixels) lod = LOD_IMPOSTOR;
+	}
+	sceneBin->lod[lod]++;
+	return (MeshLod)lod;
+}
+
+///////////////
+// Static geometry cache
+// Seabed, coral boxes and major rocks never move, so they are compiled into display lists
+// once and replayed each frame. Coral and rocks are bucketed into square chunks with their
+// own list and bounds so whole chunks can be culled. The boundary walls change colour every
+// frame and go through the render queue.
+// The lists are rebuilt lazily from renderScene() whenever the front snapshot's
+// layoutRevision moves on (initSceneObjects(), a coral visibility change or a streamed
+// chunk), from that snapshot's layout generation. Culling the chunks is a job; replaying the
+// visible ones stays on the GL thread.
+///////////////
+const float staticChunkSize = 4.0f;
+std::vector<StaticChunk> staticChunks;
+GLuint seabedList = 0;
+AABB boundaryWallBoxes[4];
+unsigned staticGeometryRevision = ~0u; // layoutRevision the lists were built from
+AABB seabedBox;
+bool seabedVisible = false;
+std::vector<int> staticVisible; // chunks cullStaticGeometry picked, in order
+
+void buildStaticGeometry(const SimLayout& layout) {
+	const float size = layout.arenaSize;
+	const std::vector<CoralSegment>& coral = layout.coral;
+	for (auto& ch : staticChunks) glDeleteLists(ch.list, 1);
+	staticChunks.clear();
+	if (seabedList == 0) seabedList = glGenLists(1);
+
+	glNewList(seabedList, GL_COMPILE);
+	DrawSeabed(size, size);
+	glEndList();
+	seabedBox = AABB{ 0.0f, -0.025f, 0.0f, size, 0.025f, size };
+
+	// bucket coral segments and rocks by the chunk holding their centre; sorted (chunk, item)
+	// pairs rather than a bucket per chunk, so a huge arena with little coral in memory (a
+	// streamed world) rebuilds in time proportional to what is there
+	int chunksPerSide = (int)ceilf(size / staticChunkSize);
+	auto chunkOf = [&](float x, float z) {
+		int cx = std::min(std::max((int)(x / staticChunkSize), 0), chunksPerSide - 1);
+		int cz = std::min(std::max((int)(z / staticChunkSize), 0), chunksPerSide - 1);
+		return cz * chunksPerSide + cx;
+		};
+	static std::vector<std::pair<int, int>> items; // (chunk, coral index, or -1 - rock index)
+	items.clear();
+	for (int i = 0;i < (int)coral.size();i++) {
+		const CoralSegment& c = coral[i];
+		if (c.visible) items.push_back(std::make_pair(chunkOf(c.x + c.w / 2.0f, c.z + c.d / 2.0f), i));
+	}
+	for (int i = 0;i < 3;i++)
+		items.push_back(std::make_pair(chunkOf(layout.rocks[i][0], layout.rocks[i][2]), -1 - i));
+	// coral first within a chunk, each in its original order
+	std::sort(items.begin(), items.end(), [](const std::pair<int, int>& a, const std::pair<int, int>& b) {
+		if (a.first != b.first) return a.first < b.first;
+		if ((a.second < 0) != (b.second < 0)) return a.second >= 0;
+		return a.second >= 0 ? a.second < b.second : a.second > b.second;
+		});
+
+	std::vector<int> coralIn, rocksIn;
+	for (size_t first = 0, last;first < items.size();first = last) {
+		coralIn.clear();
+		rocksIn.clear();
+		for (last = first;last < items.size() && items[last].first == items[first].first;last++) {
+			int i = items[last].second;
+			if (i >= 0) coralIn.push_back(i);
+			else rocksIn.push_back(-1 - i);
+		}
+		StaticChunk ch;
+		ch.list = glGenLists(1);
+		ch.objectCount = (int)(coralIn.size() + rocksIn.size());
+		ch.bounds = AABB{ 1e30f, 1e30f, 1e30f, -1e30f, -1e30f, -1e30f };
+		auto grow = [&](const AABB& b) {
+			ch.bounds.minx = std::min(ch.bounds.minx, b.minx); ch.bounds.maxx = std::max(ch.bounds.maxx, b.maxx);
+			ch.bounds.miny = std::min(ch.bounds.miny, b.miny); ch.bounds.maxy = std::max(ch.bounds.maxy, b.maxy);
+			ch.bounds.minz = std::min(ch.bounds.minz, b.minz); ch.bounds.maxz = std::max(ch.bounds.maxz, b.maxz);
+			};
+		glNewList(ch.list, GL_COMPILE);
+		for (int i : coralIn) {
+			DrawCoralBox(coral[i]);
+			grow(getCoralAABB(coral[i]));
+		}
+		for (int i : rocksIn) {
+			const float* r = layout.rocks[i];
+			DrawRock(r[0], r[1], r[2], r[3]);
+			grow(getRockAABB(r[0], r[1], r[2], r[3]));
+		}
+		glEndList();
+		staticChunks.push_back(ch);
+	}
+
+	const float walls[4][6] = {
+		{ 0.0f, 0.0f, 0.0f, size, wallHeight, wallTh },
+		{ 0.0f, 0.0f, size - wallTh, size, wallHeight, wallTh },
+		{ 0.0f, 0.0f, 0.0f, wallTh, wallHeight, size },
+		{ size - wallTh, 0.0f, 0.0f, wallTh, wallHeight, size },
+	};
+	for (int i = 0;i < 4;i++) {
+		const float* w = walls[i];
+		boundaryWallBoxes[i] = AABB{ w[0], w[1], w[2], w[0] + w[3], w[1] + w[4], w[2] + w[5] };
+	}
+
+	staticGeometryRevision = layout.revision;
+}
+
+void cullStaticGeometry(float colorPhaseLocal) {
+	seabedVisible = cullVisible(seabedBox);
+	staticVisible.clear();
+	for (int i = 0;i < (int)staticChunks.size();i++)
+		if (cullVisible(staticChunks[i].bounds, staticChunks[i].objectCount)) staticVisible.push_back(i);
+
+	// boundary walls keep their animated colour (queued, drawn with the multi-part models)
+	for (int i = 0;i < 4;i++) {
+		if (cullVisible(boundaryWallBoxes[i]))
+			QueueBoundaryWallBox(boundaryWallBoxes[i], colorPhaseLocal + (float)i);
+	}
+}
+
+void DrawStaticGeometry() {
+	if (seabedVisible) {
+		glCallList(seabedList);
+		drawCallCount++;
+	}
+	for (int i : staticVisible) {
+		glCallList(staticChunks[i].list);
+		drawCallCount++;
+	}
+}
+
+///////////////
+// Camera functions (kept; added top/side view)
+///////////////
+const float cameraWallGap = 0.2f; // eye kept this far in front of the coral hiding the diver
+const float cameraMinDistance = 0.3f;
+
+void SetCameraBehindPlayer()
+{
+	float distance = 3.0f;
+	float height = 1.5f;
+
+	const SimSnapshot& snap = frontSnapshot();
+	AgentPose p = snapshotAgent(snap, 0);
+	float rad = DEG2RAD(p.angleY);
+	camera.eye.x = p.x + sin(rad) * distance;
+	camera.eye.z = p.z + cos(rad) * distance;
+	camera.eye.y = height;
+
+	camera.center.x = p.x;
+	camera.center.y = p.y + 0.8f;
+	camera.center.z = p.z;
+
+	// coral between the diver and the eye: pull the eye in front of it so the view never
+	// starts inside a wall
+	const SimLayout& layout = *snap.layout;
+	BvhRay ray = { camera.center.x, camera.center.y, camera.center.z,
+		camera.eye.x - camera.center.x, camera.eye.y - camera.center.y, camera.eye.z - camera.center.z, 1.0f };
+	BvhHit hit;
+	if (bvhRaycast(layout.coralBvh, ray, layout.coralLive.data(), hit)) {
+		Vector3f toEye = camera.eye - camera.center;
+		float len = sqrtf(toEye.x * toEye.x + toEye.y * toEye.y + toEye.z * toEye.z);
+		float keep = std::max(hit.t * len - cameraWallGap, cameraMinDistance);
+		camera.eye = camera.center + toEye * (keep / len);
+	}
+
+	camera.up = Vector3f(0, 1, 0);
+}
+
+void SetCameraTopView() {
+	const float size = frontSnapshot().layout->arenaSize;
+	camera.eye = Vector3f(size / 2.0f, 20.0f, size / 2.0f);
+	camera.center = Vector3f(size / 2.0f, 0.0f, size / 2.0f);
+	camera.up = Vector3f(0.0f, 0.0f, -1.0f);
+}
+
+void SetCameraSideView() {
+	const float size = frontSnapshot().layout->arenaSize;
+	camera.eye = Vector3f(-8.0f, 3.0f, size / 2.0f);
+	camera.center = Vector3f(size / 2.0f, 0.8f, size / 2.0f);
+	camera.up = Vector3f(0.0f, 1.0f, 0.0f);
+}
+
+void SetCameraFrontView() {
+	const SimSnapshot& snap = frontSnapshot();
+	const float size = snap.layout->arenaSize;
+	camera.eye = Vector3f(size / 2.0f, 6.0f, size + 12.0f);
+	AgentPose p = snapshotAgent(snap, 0);
+	camera.center = Vector3f(p.x, p.y + 0.8f, p.z);
+	camera.up = Vector3f(0.0f, 1.0f, 0.0f);
+}
+
+void SetCameraFreeView() {
+	// leave camera where it is but allow free controls (WASD/QE, arrows)
+	// if starting from a fixed view, move camera to a reasonable default behind the map center
+	const float size = frontSnapshot().layout->arenaSize;
+	camera.eye = Vector3f(size / 2.0f, 3.0f, size + 2.0f);
+	camera.center = Vector3f(size / 2.0f, 0.8f, size / 2.0f);
+	camera.up = Vector3f(0.0f, 1.0f, 0.0f);
+}
+
+///////////////
+// Streaming focus: the ground the active camera mode shows, around its look-at point and
+// wider the farther the camera stands back (out to the far plane)
+///////////////
+void setStreamFocusFromCamera() {
+	Vector3f d = camera.center - camera.eye;
+	float dist = std::min(sqrtf(d.x * d.x + d.y * d.y + d.z * d.z), 200.0f);
+	float reach = dist * tanf(DEG2RAD(30.0f)) * std::max(viewAspect, 1.0f) + 4.0f;
+	setStreamCameraFocus(camera.center.x, camera.center.z, reach);
+}
+
+///////////////
+// Path hint
+///////////////
+void DrawNavHint(const std::vector<float>& path) {
+	size_t points = path.size() / 2;
+	float* verts = frameArena.allocArray<float>(points * 3);
+	const float lift = 0.08f; // just above the seabed
+	for (size_t k = 0;k < points;k++) {
+		verts[k * 3 + 0] = path[k * 2];
+		verts[k * 3 + 1] = lift;
+		verts[k * 3 + 2] = path[k * 2 + 1];
+	}
+
+	glDisable(GL_LIGHTING);
+	glColor3f(1.0f, 0.85f, 0.2f);
+	glLineWidth(2.0f);
+	glInterleavedArrays(GL_V3F, 0, verts);
+	glDrawArrays(GL_LINE_STRIP, 0, (GLsizei)points);
+	glLineWidth(1.0f);
+	glEnable(GL_LIGHTING);
+	drawCallCount++;
+	stateChangeCount++;
+}
+
+///////////////
+// Render interpolation
+// renderScene() draws between the front snapshot's two ticks (renderAlpha), so motion stays
+// smooth when the render rate and the fixed simulation rate differ.
+///////////////
+float lerpf(float a, float b, float t) { return a + (b - a) * t; }
+
+// a diver new in this tick (or a restart) has no earlier pose: drawn where it is
+AgentPose snapshotAgent(const SimSnapshot& s, size_t i) {
+	AgentPose a = s.curr.agents[i];
+	if (i < s.prev.agents.size()) {
+		const AgentPose& p = s.prev.agents[i];
+		a.x = lerpf(p.x, a.x, renderAlpha);
+		a.y = lerpf(p.y, a.y, renderAlpha);
+		a.z = lerpf(p.z, a.z, renderAlpha);
+	}
+	return a;
+}
+
+// animation phase of object i, likewise
+static float snapshotPhase(const std::vector<SceneObj>& prev, size_t i, float curr) {
+	return i < prev.size() ? lerpf(prev[i].animPhase, curr, renderAlpha) : curr;
+}
+
+///////////////
+// Scene pass
+// The GL thread sets up the camera, lights and clear; one job graph builds the draw lists:
+// the static chunks, majors, coral tubes in blocks, regulars, seaweed, goals and divers in
+// blocks each fill a bin, then the props and the queued parts are expanded. The GL thread
+// sums the bins' counts and submits: static lists, props, queue, path hint. Everything
+// comes from the front snapshot: objects, goals and divers from its ticks, coral and the
+// static chunks from its layout generation.
+///////////////
+SceneJobStats sceneJobStats;
+static SceneBin spareBin; // sceneBin outside the scene jobs
+thread_local SceneBin* sceneBin = &spareBin;
+std::vector<SceneBin> sceneBins; // only grows, so the bins keep their capacity
+const int coralBlock = 2048, diverBlock = 256; // coral segments / divers per bin
+
+void SceneBin::clear() {
+	for (auto& p : props) p.clear();
+	items.clear();
+	cull = CullStats{ 0, 0 };
+	std::fill(lod, lod + LOD_COUNT + 1, 0);
+	std::fill(meshDraws, meshDraws + MESH_COUNT, 0);
+}
+
+// the frame being built. Bins in submission order: static chunks & walls, majors, coral
+// blocks, regulars, seaweed, goals, diver blocks
+static struct {
+	const SimSnapshot* snap;
+	const SimLayout* layout; // snap's
+	float phase;
+	int coralBin, regBin, seaweedBin, goalBin, diverBin;
+	int binCount;
+} frame;
+
+static JobGraph sceneGraph;
+static int coralNode, diverNode;
+
+static void buildSceneGraph() {
+	int staticNode = sceneGraph.add("cullStatic", [] {
+		sceneBin = &sceneBins[0];
+		cullStaticGeometry(frame.phase);
+		});
+	int majorNode = sceneGraph.add("majorObjects", [] {
+		sceneBin = &sceneBins[1];
+		const SimFrame& f = frame.snap->curr;
+		for (size_t i = 0;i < f.majors.size();i++) {
+			SceneObj m = f.majors[i];
+			m.animPhase = snapshotPhase(frame.snap->prev.majors, i, m.animPhase);
+			if (m.visible && cullVisible(getMajorAABB(m)))
+				QueueMajorObj(m, selectLod(getMajorAABB(m)));
+		}
+		});
+	// Coral tubes (animated decoration)
+	// (tubes stick out up to ~0.55 above the box)
+	coralNode = sceneGraph.addFor("coralTubes", 0, 1, [](int begin, int end) {
+		for (int b = begin;b < end;b++) {
+			sceneBin = &sceneBins[frame.coralBin + b];
+			const std::vector<CoralSegment>& coral = frame.layout->coral;
+			size_t last = std::min(coral.size(), (size_t)(b + 1) * coralBlock);
+			for (size_t i = (size_t)b * coralBlock;i < last;i++) {
+				const CoralSegment& c = coral[i];
+				if (c.visible && cullVisible(aabbGrow(getCoralAABB(c), 0.1f, 0.0f, 0.6f, 0.1f)))
+					BatchCoralTubes(c, selectLod(getCoralTubesAABB(c)));
+			}
+		}
+		});
+	int regNode = sceneGraph.add("regularObjects", [] {
+		sceneBin = &sceneBins[frame.regBin];
+		const SimFrame& f = frame.snap->curr;
+		for (size_t i = 0;i < f.regs.size();i++) {
+			SceneObj r = f.regs[i];
+			r.animPhase = snapshotPhase(frame.snap->prev.regs, i, r.animPhase);
+			if (r.visible && cullVisible(getRegAABB(r)))
+				BatchRegularObj(r, selectLod(getRegAABB(r), true));
+		}
+		});
+	int seaweedNode = sceneGraph.add("seaweed", [] {
+		sceneBin = &sceneBins[frame.seaweedBin];
+		const float seaweed[3][5] = {
+			{ 2.2f, 0.0f, 3.5f, 0.9f, 0.3f },
+			{ 6.8f, 0.0f, 2.2f, 0.7f, -0.6f },
+			{ 4.5f, 0.0f, 6.0f, 0.8f, 1.2f },
+		};
+		for (const auto& w : seaweed) {
+			if (cullVisible(AABB{ w[0] - 0.1f, w[1], w[2] - 0.1f, w[0] + 0.1f, w[1] + w[3], w[2] + 0.1f }))
+				BatchSeaweed(w[0], w[1], w[2], w[3], w[4]);
+		}
+		});
+	// Goals (box grown for the bobbing and the stem below the orb)
+	int goalNode = sceneGraph.add("goals", [] {
+		sceneBin = &sceneBins[frame.goalBin];
+		const SimFrame& f = frame.snap->curr;
+		for (size_t i = 0;i < f.goals.size();i++) {
+			const GoalObj& g = f.goals[i];
+			float phase = i < frame.snap->prev.goals.size() ? lerpf(frame.snap->prev.goals[i].phase, g.phase, renderAlpha) : g.phase;
+			AABB box = aabbGrow(getGoalAABB(g), 0.0f, 0.75f, 0.2f, 0.0f);
+			if (g.visible && cullVisible(box))
+				BatchGoalPortal(g, phase, selectLod(box, true));
+		}
+		});
+	// Player and the other divers
+	diverNode = sceneGraph.addFor("diverModel", 0, 1, [](int begin, int end) {
+		for (int b = begin;b < end;b++) {
+			sceneBin = &sceneBins[frame.diverBin + b];
+			size_t last = std::min(frame.snap->curr.agents.size(), (size_t)(b + 1) * diverBlock);
+			for (size_t i = (size_t)b * diverBlock;i < last;i++) {
+				AgentPose a = snapshotAgent(*frame.snap, i);
+				AABB box = getDiverModelAABB(a.x, a.y, a.z, 0.22f);
+				if (i == 0 || cullVisible(box))
+					QueueDiverModel(a.x, a.y, a.z, a.angleY + 180.0f, a.pitch, 0.22f, selectLod(box));
+			}
+		}
+		});
+	sceneGraph.add("expandProps", [] {
+		expandPropBatches(sceneBins.data(), frame.binCount, frame.phase);
+		}, { coralNode, regNode, seaweedNode, goalNode });
+	sceneGraph.add("expandQueue", [] {
+		expandRenderQueue(sceneBins.data(), frame.binCount);
+		}, { staticNode, majorNode, diverNode });
+}
+
+void renderScene() {
+	PROFILE_ZONE("renderScene");
+	frame.snap = &frontSnapshot();
+	frame.layout = frame.snap->layout.get();
+	{
+		PROFILE_ZONE("setupCamera");
+		setupCameraProjection();
+		extractViewFrustum(viewFrustum);
+		beginLodFrame();
+		if (staticGeometryRevision != frame.snap->layoutRevision) buildStaticGeometry(*frame.layout);
+	}
+	{
+		PROFILE_ZONE("setupLights");
+		setupLights();
+	}
+	{
+		PROFILE_ZONE("clear");
+		glClearColor(0.02f, 0.07f, 0.12f, 1.0f); // underwater blue
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
+
+	// animated state interpolated between the front snapshot's two ticks
+	frame.phase = lerpf(frame.snap->prev.colorPhase, frame.snap->curr.colorPhase, renderAlpha);
+	int coralBins = (int)((frame.layout->coral.size() + coralBlock - 1) / coralBlock);
+	int diverBins = (int)((frame.snap->curr.agents.size() + diverBlock - 1) / diverBlock);
+	frame.coralBin = 2;
+	frame.regBin = frame.coralBin + coralBins;
+	frame.seaweedBin = frame.regBin + 1;
+	frame.goalBin = frame.regBin + 2;
+	frame.diverBin = frame.regBin + 3;
+	frame.binCount = frame.diverBin + diverBins;
+	if ((int)sceneBins.size() < frame.binCount) sceneBins.resize(frame.binCount);
+	for (int b = 0;b < frame.binCount;b++) sceneBins[b].clear();
+
+	if (sceneGraph.nodes.empty()) buildSceneGraph();
+	sceneGraph.setCount(coralNode, coralBins);
+	sceneGraph.setCount(diverNode, diverBins);
+	{
+		PROFILE_ZONE("buildDrawLists");
+		static std::vector<JobWorkerStats> before;
+		jobWorkerCount(); // the pool resizes before the snapshot, not inside the run
+		jobStats(before);
+		long long t0 = profilerNow();
+		runJobs(sceneGraph);
+		sceneJobStats.graphMs = (profilerNow() - t0) * 1e-6;
+		jobStats(sceneJobStats.workers);
+		for (size_t w = 0;w < sceneJobStats.workers.size() && w < before.size();w++) {
+			sceneJobStats.workers[w].busyMs -= before[w].busyMs;
+			sceneJobStats.workers[w].tasks -= before[w].tasks;
+			sceneJobStats.workers[w].steals -= before[w].steals;
+		}
+	}
+
+	cullStats = CullStats{ 0, 0 };
+	std::fill(lodObjectCount, lodObjectCount + LOD_COUNT + 1, 0);
+	for (int b = 0;b < frame.binCount;b++) {
+		const SceneBin& bin = sceneBins[b];
+		cullStats.drawn += bin.cull.drawn;
+		cullStats.culled += bin.cull.culled;
+		for (int l = 0;l <= LOD_COUNT;l++) lodObjectCount[l] += bin.lod[l];
+		for (int m = 0;m < MESH_COUNT;m++) meshDrawCount[m] += bin.meshDraws[m];
+	}
+
+	// Seabed, coral boxes and major rocks (cached display lists), then the props and the
+	// queue (walls, multi-part models)
+	{
+		PROFILE_ZONE("staticGeometry");
+		DrawStaticGeometry();
+	}
+	{
+		PROFILE_ZONE("flushProps");
+		drawPropBatches();
+	}
+	{
+		PROFILE_ZONE("flushQueue");
+		drawRenderQueue();
+	}
+	if (!frame.snap->hintPath.empty()) {
+		PROFILE_ZONE("navHint");
+		DrawNavHint(frame.snap->hintPath);
+	}
+}
@@ -0,0 +1,306 @@
+#pragma once
+///////////////
+// Coral maze renderer: camera, primitive meshes, prop batches, culling and the scene pass.
+// Plain OpenGL 1.1 + GLU (no GLUT), so it is shared by the GLUT game and the offscreen benchmark.
+///////////////
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <GL/gl.h>
+#include <GL/glu.h>
+#include <cmath>
+#include <vector>
+
+#include "coral_sim.h"
+#include "coral_jobs.h"
+#include "coral_snapshot.h"
+
+///////////////
+// Simple Vector
+///////////////
+class Vector3f {
+public:
+	float x, y, z;
+	Vector3f(float _x = 0.0f, float _y = 0.0f, float _z = 0.0f) {
+		x = _x; y = _y; z = _z;
+	}
+	Vector3f operator+(Vector3f v) const { return Vector3f(x + v.x, y + v.y, z + v.z); }
+	Vector3f operator-(Vector3f v) const { return Vector3f(x - v.x, y - v.y, z - v.z); }
+	Vector3f operator*(float n) const { return Vector3f(x * n, y * n, z * n); }
+	Vector3f operator/(float n) const { return Vector3f(x / n, y / n, z / n); }
+	Vector3f unit() const {
+		float L = sqrtf(x * x + y * y + z * z);
+		if (L == 0) return Vector3f(0, 0, 0);
+		return *this / L;
+	}
+	Vector3f cross(Vector3f v) const {
+		return Vector3f(
+			y * v.z - z * v.y,
+			z * v.x - x * v.z,
+			x * v.y - y * v.x
+		);
+	}
+};
+
+///////////////
+// Camera (kept as in lab code)
+///////////////
+class Camera {
+public:
+	Vector3f eye, center, up;
+	Camera(float eyeX = 1.0f, float eyeY = 1.0f, float eyeZ = 1.0f,
+		float centerX = 0.0f, float centerY = 0.0f, float centerZ = 0.0f,
+		float upX = 0.0f, float upY = 1.0f, float upZ = 0.0f)
+	{
+		eye = Vector3f(eyeX, eyeY, eyeZ);
+		center = Vector3f(centerX, centerY, centerZ);
+		up = Vector3f(upX, upY, upZ);
+	}
+	void moveX(float d) { // strafe left/right
+		Vector3f right = up.cross(center - eye).unit();
+		eye = eye + right * d;
+		center = center + right * d;
+	}
+	void moveY(float d) { // move up/down
+		eye = eye + up.unit() * d;
+		center = center + up.unit() * d;
+	}
+	void moveZ(float d) { // move forward/back
+		Vector3f view = (center - eye).unit();
+		eye = eye + view * d;
+		center = center + view * d;
+	}
+	void rotateX(float a) { // pitch
+		Vector3f view = (center - eye).unit();
+		Vector3f right = up.cross(view).unit();
+		float s = sinf(DEG2RAD(a)), c = cosf(DEG2RAD(a));
+		view = view * c + up * s;
+		up = view.cross(right);
+		center = eye + view;
+	}
+	void rotateY(float a) { // yaw
+		Vector3f view = (center - eye).unit();
+		Vector3f right = up.cross(view).unit();
+		float s = sinf(DEG2RAD(a)), c = cosf(DEG2RAD(a));
+		view = view * c + right * s;
+		right = view.cross(up);
+		center = eye + view;
+	}
+	void look() {
+		gluLookAt(eye.x, eye.y, eye.z,
+			center.x, center.y, center.z,
+			up.x, up.y, up.z);
+	}
+};
+
+extern Camera camera;
+extern int cameraViewMode; //1=behind,2=top,3=side
+extern float viewAspect; // width / height of the render target
+
+void setupLights();
+void setupCameraProjection();
+void initRenderState(); // fixed-function state shared by every front end
+void setStreamFocusFromCamera(); // streamed worlds (coral_stream.h): keep what the camera shows loaded
+
+///////////////
+// Primitive mesh cache
+///////////////
+enum MeshId { MESH_CUBE, MESH_SPHERE, MESH_CYLINDER, MESH_TORUS, MESH_COUNT };
+// LOD_IMPOSTOR is not a mesh level: goals and regular objects that small are billboards
+enum MeshLod { LOD_HIGH, LOD_MEDIUM, LOD_LOW, LOD_MINIMAL, LOD_COUNT, LOD_IMPOSTOR = LOD_COUNT };
+
+struct Mesh {
+	std::vector<float> data; // nx,ny,nz, x,y,z per vertex
+	int vertexCount() const { return (int)(data.size() / 6); }
+};
+
+extern Mesh meshCache[MESH_COUNT][LOD_COUNT];
+extern int meshDrawCount[MESH_COUNT]; // meshes drawn or queued since last reset (stats/benchmarks)
+extern int drawCallCount; // glDrawArrays + glCallList submissions since last reset
+// glColor, matrix stack and vertex array calls since last reset (a display list replay
+// counts as its glCallList only)
+extern int stateChangeCount;
+
+void initPrimitiveMeshes();
+void drawMesh(MeshId id, MeshLod lod = LOD_HIGH);
+
+///////////////
+// Prop batches
+///////////////
+enum PropType { PROP_CORAL_TUBE, PROP_SEAWEED, PROP_ROCK, PROP_GOAL_RING, PROP_GOAL_ORB, PROP_GOAL_STEM, PROP_IMPOSTOR, PROP_COUNT };
+enum PropAnim { ANIM_NONE, ANIM_DRIFT_Z, ANIM_SWAY, ANIM_BILLBOARD };
+
+struct PropInstances {
+	std::vector<float> x, y, z; // translation
+	std::vector<float> yaw; // degrees about +y
+	std::vector<float> sx, sy, sz; // scale
+	std::vector<float> r, g, b;
+	std::vector<float> phase; // animation phase offset
+	std::vector<unsigned char> lod; // MeshLod
+	size_t size() const { return x.size(); }
+	void clear() {
+		x.clear(); y.clear(); z.clear(); yaw.clear();
+		sx.clear(); sy.clear(); sz.clear();
+		r.clear(); g.clear(); b.clear(); phase.clear(); lod.clear();
+	}
+};
+
+struct PropBatch {
+	const Mesh* mesh; // unit mesh per level, LOD_HIGH first
+	int levels; // meshes at mesh[0..levels); finer instance levels use the last one
+	float baseRotX; // fixed mesh pre-rotation about x (upright cylinders)
+	PropAnim anim;
+};
+
+extern PropBatch propBatches[PROP_COUNT];
+
+struct SceneBin;
+
+void initPropBatches();
+void addPropInstance(PropType type, float x, float y, float z, float yaw,
+	float sx, float sy, float sz, float r, float g, float b, float phase, MeshLod lod = LOD_HIGH); // into sceneBin
+// every instance of the bins, type by type and bin by bin, into one vertex array (as jobs);
+// t drives the sway/drift animations
+void expandPropBatches(const SceneBin* bins, int count, float t);
+void drawPropBatches(); // the one glDrawArrays
+
+///////////////
+// Render queue
+///////////////
+// affine transform, row-major 3x4; the methods post-multiply like glTranslatef & co.
+struct Xform {
+	float m[12];
+	static Xform identity();
+	void translate(float x, float y, float z);
+	void rotate(float angle, float ax, float ay, float az); // degrees about a unit axis
+	void scale(float x, float y, float z);
+};
+
+struct RenderItem {
+	MeshId mesh;
+	MeshLod lod;
+	Xform xf; // world transform
+	float r, g, b;
+};
+
+extern bool renderQueueBatched; // false = one draw per item in submission order (--unbatched)
+
+void queueMesh(MeshId id, MeshLod lod, const Xform& xf, float r, float g, float b); // into sceneBin
+void expandRenderQueue(const SceneBin* bins, int count); // the bins' items in order; sorted and expanded as jobs
+void drawRenderQueue();
+
+///////////////
+// Scene drawing
+///////////////
+void DrawSeabed(float width, float depth);
+void QueueBoundaryWallBox(const AABB& box, float colorPhaseLocal);
+void DrawCoralBox(const CoralSegment& c);
+void BatchCoralTubes(const CoralSegment& c, MeshLod lod = LOD_HIGH);
+AABB getCoralTubesAABB(const CoralSegment& c);
+void DrawRock(float x, float y, float z, float s);
+void BatchSeaweed(float x, float y, float z, float height, float phaseOffset);
+void QueueDiverModel(float x, float y, float z, float angleY, float pitch, float scale = 0.22f, MeshLod lod = LOD_HIGH);
+AABB getDiverModelAABB(float x, float y, float z, float scale = 0.22f);
+void BatchGoalPortal(const GoalObj& g, float tphase, MeshLod lod = LOD_HIGH);
+void QueueMajorObj(const SceneObj& o, MeshLod lod = LOD_HIGH);
+void BatchRegularObj(const SceneObj& o, MeshLod lod = LOD_HIGH);
+
+///////////////
+// View-frustum culling
+///////////////
+struct Frustum {
+	float planes[6][4]; // a,b,c,d with the inside at a*x+b*y+c*z+d >= 0
+};
+
+struct CullStats {
+	int drawn;
+	int culled;
+};
+
+extern Frustum viewFrustum;
+extern CullStats cullStats;
+extern bool showCullStats;
+
+void extractViewFrustum(Frustum& f);
+bool frustumTestAABB(const Frustum& f, const AABB& b);
+bool cullVisible(const AABB& b, int count = 1); // test and count one drawable
+AABB aabbGrow(const AABB& b, float dx, float dyDown, float dyUp, float dz);
+
+///////////////
+// Level of detail
+///////////////
+extern bool lodEnabled; // false = every mesh at LOD_HIGH (--no-lod, comparisons)
+extern int lodObjectCount[LOD_COUNT + 1]; // objects per level in the last scene pass, impostors last
+
+void beginLodFrame(); // after setupCameraProjection: pixel scale, billboard basis, counters
+// level for a drawable from the screen radius of its box; LOD_IMPOSTOR only when allowed
+MeshLod selectLod(const AABB& b, bool impostor = false);
+
+///////////////
+// Scene bins
+// renderScene builds the frame's draw lists as a job graph (coral_jobs.h). Every job writes
+// what its share of the scene produces (prop instances, queued parts, cull and LOD counts)
+// into a bin of its own through the thread's sceneBin, and the bins are read back in a fixed
+// order, so the frame comes out the same for any worker count.
+///////////////
+struct SceneBin {
+	PropInstances props[PROP_COUNT];
+	std::vector<RenderItem> items;
+	CullStats cull;
+	int lod[LOD_COUNT + 1];
+	int meshDraws[MESH_COUNT];
+	void clear();
+};
+
+extern thread_local SceneBin* sceneBin; // where addPropInstance, queueMesh, cullVisible and selectLod write
+
+///////////////
+// Static geometry cache
+///////////////
+struct StaticChunk {
+	GLuint list;
+	AABB bounds;
+	int objectCount; // coral segments + rocks in the chunk
+};
+
+void buildStaticGeometry(const SimLayout& layout); // GL thread; renderScene calls it when the snapshot's layoutRevision moved on
+void cullStaticGeometry(float colorPhaseLocal); // picks the visible chunks, queues the boundary walls (a job)
+void DrawStaticGeometry(); // replays the chunks cullStaticGeometry picked
+
+///////////////
+// Camera functions
+///////////////
+void SetCameraBehindPlayer(); // this and the front view aim at the front snapshot's player
+void SetCameraTopView();
+void SetCameraSideView();
+void SetCameraFrontView();
+void SetCameraFreeView();
+
+///////////////
+// Path hint: the nearest-goal flow path the snapshot carries (snapshotNavHint), drawn on the
+// seabed
+///////////////
+void DrawNavHint(const std::vector<float>& path); // one line strip through the x, z pairs (vertices in frameArena)
+
+///////////////
+// Render interpolation
+// The scene draws the front snapshot (coral_snapshot.h) between its two ticks
+///////////////
+extern float renderAlpha; // position of the rendered frame between the last two ticks
+
+float lerpf(float a, float b, float t);
+AgentPose snapshotAgent(const SimSnapshot& s, size_t i); // diver i's pose at renderAlpha
+
+///////////////
+// Scene pass
+///////////////
+struct SceneJobStats {
+	double graphMs; // building the draw lists
+	std::vector<JobWorkerStats> workers; // busy time and tasks per worker in that graph
+};
+extern SceneJobStats sceneJobStats; // the last scene pass
+
+// clear + draw frontSnapshot() from the current camera (no HUD, no swap); GL calls stay on
+// this thread, which owns the render side of the snapshots and begins each frame of
+// frameArena (coral_arena.h) first
+void renderScene();
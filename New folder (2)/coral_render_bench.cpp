@@ -0,0 +1,352 @@
+///////////////
+// Offscreen render benchmark
+// Draws the scene pass into an EGL pbuffer (surfaceless Mesa platform when available, so
+// llvmpipe works with no GPU and no X server) for a fixed camera path through the maze in
+// each of the five camera modes, and reports frame-time percentiles and draw calls.
+//
+//   coral_render_bench [--frames N] [--size WxH] [--dump dir] [--dump-every N] [--trace file]
+//                      [--maze N] [--seed S] [--maze-algo name] [--level file.crlv [--stream MB]] [--no-lod]
+//                      [--unbatched] [--agents N] [--sim-threads K] [--laps N]
+//
+// Each mode restarts the round and moves the diver along the same loop around the arena,
+// so runs are repeatable; --dump writes every Nth frame as <dir>/<mode>_<frame>.ppm for
+// visual diffing; --trace records profiler zones and writes them as a Chrome trace. The HUD is not drawn (it needs GLUT's bitmap fonts).
+// A second table gives the objects drawn per level of detail; --no-lod draws everything at
+// full detail for comparison. "state chg" counts glColor, matrix stack and vertex array
+// calls; --unbatched draws the render queue one record at a time for the before numbers.
+// A third table covers the job graph that builds the draw lists (coral_jobs.h): its wall
+// time and how busy each worker was inside it (--sim-threads K sets the workers).
+// The last one counts heap allocations (coral_arena.h) per frame, simulation step and scene
+// pass: --laps N drives the same loop N times, restarting the round (crowd included) before
+// each, so every lap replays the first one and the buffers it grew hold the later ones. A
+// later lap that allocates fails the run (exit code 2), except on a streamed level: chunks
+// keep arriving across laps, and what is resident when is up to the I/O thread.
+///////////////
+#include "coral_render.h"
+#include "coral_profiler.h"
+#include "coral_mazegen.h"
+#include "coral_stream.h"
+#include "coral_arena.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+
+const char* benchModes[5] = { "behind", "top", "side", "front", "free" };
+
+struct FrameSample {
+	double ms;
+	int drawCalls;
+	int stateChanges;
+	int drawn, culled;
+	int lod[LOD_COUNT + 1]; // objects per level, impostors last
+	double graphMs; // the scene pass's job graph
+	std::vector<double> busyMs; // per job worker in that graph
+	long long steals;
+	long long heap; // operator new calls in the step and the scene pass
+	int lap;
+};
+
+///////////////
+// EGL context
+///////////////
+bool createOffscreenContext(int w, int h) {
+	EGLDisplay dpy = EGL_NO_DISPLAY;
+	const char* ext = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (ext && strstr(ext, "EGL_MESA_platform_surfaceless") && getPlatformDisplay)
+		dpy = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	if (dpy == EGL_NO_DISPLAY) dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, &major, &minor)) {
+		fprintf(stderr, "EGL: no display\n");
+		return false;
+	}
+	const EGLint configAttribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+		EGL_DEPTH_SIZE, 24,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint configCount = 0;
+	if (!eglChooseConfig(dpy, configAttribs, &config, 1, &configCount) || configCount == 0) {
+		fprintf(stderr, "EGL: no pbuffer config with desktop GL\n");
+		return false;
+	}
+	const EGLint pbufferAttribs[] = { EGL_WIDTH, w, EGL_HEIGHT, h, EGL_NONE };
+	EGLSurface surface = eglCreatePbufferSurface(dpy, config, pbufferAttribs);
+	eglBindAPI(EGL_OPENGL_API);
+	// default attributes give a compatibility context, which the fixed-function renderer needs
+	EGLContext ctx = eglCreateContext(dpy, config, EGL_NO_CONTEXT, nullptr);
+	if (surface == EGL_NO_SURFACE || ctx == EGL_NO_CONTEXT || !eglMakeCurrent(dpy, surface, surface, ctx)) {
+		fprintf(stderr, "EGL: cannot create a %dx%d pbuffer context (0x%x)\n", w, h, eglGetError());
+		return false;
+	}
+	return true;
+}
+
+///////////////
+// Camera path
+///////////////
+// diver loop around the arena centre; one lap per mode
+void placeDiverOnPath(float t) {
+	const float PI = 3.14159265f;
+	float a = 2.0f * PI * t;
+	float r = arenaSize * 0.35f;
+	Agent& p = player();
+	p.x = arenaSize / 2.0f + r * cosf(a);
+	p.z = arenaSize / 2.0f + r * sinf(a);
+	// face along the loop (the diver looks down -z at angle 0)
+	float dx = -sinf(a), dz = cosf(a);
+	p.angleY = atan2f(-dx, -dz) * 57.2957795f;
+	p.prevX = p.x; p.prevY = p.y; p.prevZ = p.z;
+}
+
+void setBenchCamera(int mode, float t);
+
+// fresh round with the diver at the start of the loop, then one untimed frame (the static
+// display lists are compiled on the first draw after a layout change)
+void beginLap(int mode) {
+	resetGame();
+	placeDiverOnPath(0.0f);
+	publishSnapshot(true);
+	acquireSnapshot();
+	setBenchCamera(mode, 0.0f);
+	frameArena.beginFrame();
+	renderScene();
+	glFinish();
+}
+
+void setBenchCamera(int mode, float t) {
+	switch (mode) {
+	case 0: SetCameraBehindPlayer(); break;
+	case 1: SetCameraTopView(); break;
+	case 2: SetCameraSideView(); break;
+	case 3: SetCameraFrontView(); break;
+	case 4: {
+		// free camera orbiting the arena
+		const float PI = 3.14159265f;
+		float a = 2.0f * PI * t;
+		float r = arenaSize * 0.9f;
+		camera.eye = Vector3f(arenaSize / 2.0f + r * sinf(a), 3.0f, arenaSize / 2.0f + r * cosf(a));
+		camera.center = Vector3f(arenaSize / 2.0f, 0.8f, arenaSize / 2.0f);
+		camera.up = Vector3f(0.0f, 1.0f, 0.0f);
+		break;
+	}
+	}
+}
+
+///////////////
+// Frame dump (binary PPM, top row first)
+///////////////
+bool dumpFrame(const std::string& path, int w, int h) {
+	std::vector<unsigned char> px((size_t)w * h * 3);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, w, h, GL_RGB, GL_UNSIGNED_BYTE, px.data());
+	FILE* f = fopen(path.c_str(), "wb");
+	if (!f) {
+		fprintf(stderr, "cannot write %s\n", path.c_str());
+		return false;
+	}
+	fprintf(f, "P6\n%d %d\n255\n", w, h);
+	for (int y = h - 1;y >= 0;y--) fwrite(&px[(size_t)y * w * 3], 1, (size_t)w * 3, f);
+	fclose(f);
+	return true;
+}
+
+///////////////
+// Report
+///////////////
+double percentile(std::vector<double> v, double p) {
+	if (v.empty()) return 0.0;
+	std::sort(v.begin(), v.end());
+	size_t rank = (size_t)ceil(p / 100.0 * v.size());
+	return v[std::min(std::max(rank, (size_t)1), v.size()) - 1];
+}
+
+void printRow(const char* name, const std::vector<FrameSample>& s) {
+	std::vector<double> ms;
+	double sum = 0.0, calls = 0.0, states = 0.0, drawn = 0.0, culled = 0.0;
+	for (const auto& f : s) {
+		ms.push_back(f.ms);
+		sum += f.ms; calls += f.drawCalls; states += f.stateChanges; drawn += f.drawn; culled += f.culled;
+	}
+	double n = s.empty() ? 1.0 : (double)s.size();
+	printf("%-8s %8.3f %8.3f %8.3f %8.3f %11.1f %9.1f %7.1f %7.1f\n", name,
+		percentile(ms, 50), percentile(ms, 95), percentile(ms, 99), sum / n,
+		calls / n, states / n, drawn / n, culled / n);
+}
+
+void printLodRow(const char* name, const std::vector<FrameSample>& s) {
+	double lod[LOD_COUNT + 1] = {};
+	for (const auto& f : s)
+		for (int k = 0;k <= LOD_COUNT;k++) lod[k] += f.lod[k];
+	double n = s.empty() ? 1.0 : (double)s.size();
+	printf("%-8s %8.1f %8.1f %8.1f %8.1f %9.1f\n", name, lod[LOD_HIGH] / n, lod[LOD_MEDIUM] / n,
+		lod[LOD_LOW] / n, lod[LOD_MINIMAL] / n, lod[LOD_IMPOSTOR] / n);
+}
+
+// utilisation = a worker's busy time over the graph's wall time, summed over the frames
+void printJobRow(const char* name, const std::vector<FrameSample>& s) {
+	std::vector<double> busy;
+	double graph = 0.0, steals = 0.0;
+	for (const auto& f : s) {
+		if (busy.size() < f.busyMs.size()) busy.resize(f.busyMs.size(), 0.0);
+		for (size_t w = 0;w < f.busyMs.size();w++) busy[w] += f.busyMs[w];
+		graph += f.graphMs;
+		steals += f.steals;
+	}
+	double n = s.empty() ? 1.0 : (double)s.size();
+	double sum = 0.0, least = 1e30, most = 0.0;
+	for (double b : busy) { sum += b; least = std::min(least, b); most = std::max(most, b); }
+	if (busy.empty() || graph <= 0.0) { printf("%-8s %8s\n", name, "-"); return; }
+	printf("%-8s %8zu %9.3f %8.0f%% %8.0f%% %8.0f%% %8.1f\n", name, busy.size(), graph / n, 100.0 * sum / busy.size() / graph,
+		100.0 * least / graph, 100.0 * most / graph, steals / n);
+}
+
+// mean allocations per frame on the first lap and on the later ones, and the most in one
+// later frame
+void printHeapRow(const char* name, const std::vector<FrameSample>& s) {
+	double first = 0.0, later = 0.0;
+	int firstFrames = 0, laterFrames = 0;
+	long long most = 0;
+	for (const auto& f : s) {
+		if (f.lap == 0) { first += f.heap; firstFrames++; }
+		else { later += f.heap; laterFrames++; most = std::max(most, f.heap); }
+	}
+	if (laterFrames == 0) printf("%-8s %9.2f %9s %9s\n", name, first / std::max(firstFrames, 1), "-", "-");
+	else printf("%-8s %9.2f %9.2f %9lld\n", name, first / std::max(firstFrames, 1), later / laterFrames, most);
+}
+
+///////////////
+// main
+///////////////
+int main(int argc, char** argv) {
+	int frames = 300;
+	int width = 640, height = 480;
+	const char* dumpDir = nullptr;
+	int dumpEvery = 60;
+	int laps = 1;
+	const char* traceFile = nullptr;
+
+	for (int i = 1;i < argc;i++) {
+		if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = std::max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%dx%d", &width, &height) == 2) i++;
+		else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc) dumpDir = argv[++i];
+		else if (strcmp(argv[i], "--dump-every") == 0 && i + 1 < argc) dumpEvery = std::max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) traceFile = argv[++i];
+		else if (strcmp(argv[i], "--laps") == 0 && i + 1 < argc) laps = std::max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--no-lod") == 0) lodEnabled = false;
+		else if (strcmp(argv[i], "--unbatched") == 0) renderQueueBatched = false;
+		else if (parseMazeArg(i, argc, argv)) continue;
+		else {
+			fprintf(stderr, "usage: %s [--frames N] [--size WxH] [--dump dir] [--dump-every N] [--trace file] [--no-lod] [--unbatched] [--laps N]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (width <= 0 || height <= 0) {
+		fprintf(stderr, "bad --size\n");
+		return 1;
+	}
+
+	if (!createOffscreenContext(width, height)) return 1;
+	glViewport(0, 0, width, height);
+	viewAspect = (float)width / height;
+	initRenderState();
+	initPrimitiveMeshes();
+	initPropBatches();
+
+	printf("offscreen render benchmark: %dx%d, %d frames per mode (%d per lap), %s\n",
+		width, height, frames * laps, frames, (const char*)glGetString(GL_RENDERER));
+	printf("%-8s %8s %8s %8s %8s %11s %9s %7s %7s\n", "mode", "p50 ms", "p95 ms", "p99 ms", "mean ms",
+		"draw calls", "state chg", "drawn", "culled");
+
+	profilerEnabled = traceFile != nullptr;
+	const float dt = 1.0f / 60.0f;
+	std::vector<FrameSample> all, perMode[5];
+	renderAlpha = 1.0f;
+	for (int mode = 0;mode < 5;mode++) {
+		std::vector<FrameSample> samples;
+		for (int f = 0;f < frames * laps;f++) {
+			if (f % frames == 0) beginLap(mode);
+			float t = (float)(f % frames) / frames;
+			placeDiverOnPath(t);
+			frameArena.beginFrame();
+			long long heap0 = heapAllocations();
+			simulateStep(dt);
+			publishSnapshot();
+			acquireSnapshot();
+			setBenchCamera(mode, t);
+			if (worldStreamActive()) setStreamFocusFromCamera();
+
+			profilerBeginFrame();
+			drawCallCount = 0;
+			stateChangeCount = 0;
+			auto t0 = std::chrono::steady_clock::now();
+			renderScene();
+			glFinish();
+			std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - t0;
+			long long heap = heapAllocations() - heap0;
+			FrameSample sample{};
+			sample.ms = ms.count();
+			sample.drawCalls = drawCallCount;
+			sample.stateChanges = stateChangeCount;
+			sample.drawn = cullStats.drawn;
+			sample.culled = cullStats.culled;
+			sample.heap = heap;
+			sample.lap = f / frames;
+			std::copy(lodObjectCount, lodObjectCount + LOD_COUNT + 1, sample.lod);
+			sample.graphMs = sceneJobStats.graphMs;
+			sample.steals = 0;
+			for (const auto& w : sceneJobStats.workers) {
+				sample.busyMs.push_back(w.busyMs);
+				sample.steals += w.steals;
+			}
+			samples.push_back(sample);
+
+			if (dumpDir && f % dumpEvery == 0) {
+				char name[64];
+				sprintf(name, "/%s_%04d.ppm", benchModes[mode], f);
+				if (!dumpFrame(std::string(dumpDir) + name, width, height)) return 1;
+			}
+		}
+		printRow(benchModes[mode], samples);
+		all.insert(all.end(), samples.begin(), samples.end());
+		perMode[mode] = samples;
+	}
+	printRow("all", all);
+
+	printf("\nobjects per frame by level of detail%s\n", lodEnabled ? "" : " (--no-lod)");
+	printf("%-8s %8s %8s %8s %8s %9s\n", "mode", "high", "medium", "low", "minimal", "impostor");
+	for (int mode = 0;mode < 5;mode++) printLodRow(benchModes[mode], perMode[mode]);
+	printLodRow("all", all);
+
+	printf("\nscene job graph per frame (--sim-threads workers; utilisation = busy / graph time)\n");
+	printf("%-8s %8s %9s %9s %9s %9s %8s\n", "mode", "workers", "graph ms", "util avg", "util min", "util max", "steals");
+	for (int mode = 0;mode < 5;mode++) printJobRow(benchModes[mode], perMode[mode]);
+	printJobRow("all", all);
+
+	printf("\nheap allocations per frame (simulation step + scene pass)\n");
+	printf("%-8s %9s %9s %9s\n", "mode", "lap 1", "later", "max");
+	for (int mode = 0;mode < 5;mode++) printHeapRow(benchModes[mode], perMode[mode]);
+	printHeapRow("all", all);
+	if (traceFile && !profilerWriteChromeTrace(traceFile)) return 1;
+	long long laterHeap = 0;
+	for (const auto& f : all)
+		if (f.lap > 0) laterHeap += f.heap;
+	if (laterHeap > 0 && !worldStreamActive()) {
+		fprintf(stderr, "later laps allocated %lld times\n", laterHeap);
+		return 2;
+	}
+	return 0;
+}
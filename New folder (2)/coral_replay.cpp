@@ -0,0 +1,253 @@
+#include "coral_replay.h"
+#include "coral_sim.h"
+#include "coral_stream.h"
+
+#include <cstdio>
+#include <cstring>
+
+InputLog inputRecording;
+bool inputRecordingOn = false;
+
+///////////////
+// Recording
+///////////////
+void beginInputRecording(float simHz) {
+	inputRecording.simHz = simHz;
+	inputRecording.playerSpeed = playerSpeed;
+	inputRecording.mazeCells = levelMaze.cells;
+	inputRecording.mazeSeed = levelMaze.seed;
+	inputRecording.mazeAlgorithm = (int)levelMaze.algorithm;
+	inputRecording.mazeTile = levelMaze.tileCells;
+	inputRecording.levelPath = levelFilePath ? levelFilePath : "";
+	inputRecording.agentCount = agentCount;
+	inputRecording.streamBudget = streamBudgetBytes;
+	if (streamBudgetBytes > 0)
+		fprintf(stderr, "warning: recording a streamed session; its log will not replay\n");
+	inputRecording.endTick = 0;
+	inputRecording.events.clear();
+	inputRecordingOn = true;
+	sessionTick = 0;
+}
+
+void recordInputEvent(InputEventType type, unsigned char key) {
+	if (!inputRecordingOn) return;
+	inputRecording.events.push_back(InputEvent{ sessionTick, (uint8_t)type, key });
+}
+
+bool saveInputRecording(const char* path) {
+	inputRecording.endTick = sessionTick;
+	return saveInputLog(path, inputRecording);
+}
+
+///////////////
+// File format (little-endian, as written by x86/ARM)
+//   "CRIL" u16 version u16 reserved, f32 simHz, f32 playerSpeed,
+//   i32 mazeCells, u32 mazeSeed, i32 mazeAlgorithm, i32 mazeTile, i64 endTick, u32 eventCount
+//   (version 2) u16 level path length, path bytes
+//   (version 3) i32 agentCount
+//   (version 4) u64 streamBudget; a streamed session is refused on load: which chunks are
+//   resident at a step depends on the I/O thread, so its collision cannot be reproduced
+//   events: varint tick delta, u8 type, u8 key
+///////////////
+static const char inputLogMagic[4] = { 'C', 'R', 'I', 'L' };
+static const uint16_t inputLogVersion = 4;
+
+template <class T>
+static void writeRaw(std::vector<uint8_t>& out, const T& v) {
+	const uint8_t* p = (const uint8_t*)&v;
+	out.insert(out.end(), p, p + sizeof(T));
+}
+
+template <class T>
+static bool readRaw(const uint8_t*& p, const uint8_t* end, T& v) {
+	if (end - p < (long)sizeof(T)) return false;
+	memcpy(&v, p, sizeof(T));
+	p += sizeof(T);
+	return true;
+}
+
+bool saveInputLog(const char* path, const InputLog& log) {
+	std::vector<uint8_t> out;
+	out.insert(out.end(), inputLogMagic, inputLogMagic + 4);
+	writeRaw(out, inputLogVersion);
+	writeRaw(out, (uint16_t)0);
+	writeRaw(out, log.simHz);
+	writeRaw(out, log.playerSpeed);
+	writeRaw(out, (int32_t)log.mazeCells);
+	writeRaw(out, (uint32_t)log.mazeSeed);
+	writeRaw(out, (int32_t)log.mazeAlgorithm);
+	writeRaw(out, (int32_t)log.mazeTile);
+	writeRaw(out, (int64_t)log.endTick);
+	writeRaw(out, (uint32_t)log.events.size());
+	writeRaw(out, (uint16_t)log.levelPath.size());
+	out.insert(out.end(), log.levelPath.begin(), log.levelPath.end());
+	writeRaw(out, (int32_t)log.agentCount);
+	writeRaw(out, log.streamBudget);
+	long long prev = 0;
+	for (const auto& e : log.events) {
+		// ticks never go backwards within a log, so deltas stay small
+		unsigned long long d = (unsigned long long)(e.tick - prev);
+		prev = e.tick;
+		do {
+			uint8_t b = d & 0x7F;
+			d >>= 7;
+			out.push_back(d ? (b | 0x80) : b);
+		} while (d);
+		out.push_back(e.type);
+		out.push_back(e.key);
+	}
+
+	FILE* f = fopen(path, "wb");
+	if (!f) {
+		fprintf(stderr, "cannot write input log %s\n", path);
+		return false;
+	}
+	bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+	ok = (fclose(f) == 0) && ok;
+	if (!ok) fprintf(stderr, "cannot write input log %s\n", path);
+	return ok;
+}
+
+bool loadInputLog(const char* path, InputLog& log) {
+	FILE* f = fopen(path, "rb");
+	if (!f) {
+		fprintf(stderr, "cannot open input log %s\n", path);
+		return false;
+	}
+	std::vector<uint8_t> data;
+	uint8_t buf[4096];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+	fclose(f);
+
+	const uint8_t* p = data.data();
+	const uint8_t* end = p + data.size();
+	uint16_t version, reserved;
+	int32_t cells, algorithm, tile;
+	uint32_t seed, count;
+	int64_t endTick;
+	if (data.size() < 4 || memcmp(p, inputLogMagic, 4) != 0) {
+		fprintf(stderr, "%s: not an input log\n", path);
+		return false;
+	}
+	p += 4;
+	if (!readRaw(p, end, version) || version < 1 || version > inputLogVersion) {
+		fprintf(stderr, "%s: unsupported input log version\n", path);
+		return false;
+	}
+	if (!readRaw(p, end, reserved) || !readRaw(p, end, log.simHz) || !readRaw(p, end, log.playerSpeed) ||
+		!readRaw(p, end, cells) || !readRaw(p, end, seed) || !readRaw(p, end, algorithm) ||
+		!readRaw(p, end, tile) || !readRaw(p, end, endTick) || !readRaw(p, end, count) ||
+		algorithm < 0 || algorithm >= MAZE_ALGORITHM_COUNT || log.simHz <= 0.0f) {
+		fprintf(stderr, "%s: bad input log header\n", path);
+		return false;
+	}
+	log.mazeCells = cells;
+	log.mazeSeed = seed;
+	log.mazeAlgorithm = algorithm;
+	log.mazeTile = tile;
+	log.endTick = endTick;
+	log.levelPath.clear();
+	uint16_t pathBytes = 0;
+	if (version >= 2) {
+		if (!readRaw(p, end, pathBytes) || end - p < pathBytes) {
+			fprintf(stderr, "%s: bad input log header\n", path);
+			return false;
+		}
+		log.levelPath.assign((const char*)p, pathBytes);
+		p += pathBytes;
+	}
+	int32_t divers = 1;
+	if (version >= 3 && (!readRaw(p, end, divers) || divers < 1)) {
+		fprintf(stderr, "%s: bad input log header\n", path);
+		return false;
+	}
+	log.agentCount = divers;
+	log.streamBudget = 0;
+	if (version >= 4 && !readRaw(p, end, log.streamBudget)) {
+		fprintf(stderr, "%s: bad input log header\n", path);
+		return false;
+	}
+	if (log.streamBudget > 0) {
+		fprintf(stderr, "%s: recorded on a streamed level (--stream), which does not replay deterministically\n", path);
+		return false;
+	}
+	log.events.clear();
+	log.events.reserve(count);
+	long long tick = 0;
+	for (uint32_t i = 0;i < count;i++) {
+		unsigned long long d = 0;
+		int shift = 0;
+		uint8_t b;
+		do {
+			if (p == end || shift > 63) {
+				fprintf(stderr, "%s: truncated input log\n", path);
+				return false;
+			}
+			b = *p++;
+			d |= (unsigned long long)(b & 0x7F) << shift;
+			shift += 7;
+		} while (b & 0x80);
+		if (end - p < 2 || p[0] >= INPUT_EVENT_TYPE_COUNT) {
+			fprintf(stderr, "%s: truncated input log\n", path);
+			return false;
+		}
+		tick += (long long)d;
+		log.events.push_back(InputEvent{ tick, p[0], p[1] });
+		p += 2;
+	}
+	return true;
+}
+
+///////////////
+// Replay
+///////////////
+void applyInputEvent(const InputEvent& e) {
+	switch (e.type) {
+	case INPUT_EVENT_KEY_DOWN:
+		if (gameOver) {
+			if (e.key == 'r' || e.key == 'R') resetGame();
+			return;
+		}
+		if (!setInputKey(e.key, true)) applyPlayerKey(e.key);
+		break;
+	case INPUT_EVENT_KEY_UP:
+		setInputKey(e.key, false);
+		break;
+	default: break; // special keys only move the camera
+	}
+}
+
+void beginReplay(const InputLog& log) {
+	playerSpeed = log.playerSpeed;
+	levelMaze.cells = log.mazeCells;
+	levelMaze.seed = log.mazeSeed;
+	levelMaze.algorithm = (MazeAlgorithm)log.mazeAlgorithm;
+	levelMaze.tileCells = log.mazeTile;
+	levelFilePath = log.levelPath.empty() ? nullptr : log.levelPath.c_str();
+	agentCount = log.agentCount;
+	clearInputKeys();
+	resetGame();
+	sessionTick = 0;
+}
+
+int replayEventsUntil(const InputLog& log, size_t& next, long long tick) {
+	int applied = 0;
+	while (next < log.events.size() && log.events[next].tick <= tick) {
+		applyInputEvent(log.events[next++]);
+		applied++;
+	}
+	return applied;
+}
+
+void replaySession(const InputLog& log) {
+	const float dt = 1.0f / log.simHz; // same expression as the game's fixed step
+	beginReplay(log);
+	size_t next = 0;
+	for (;;) {
+		replayEventsUntil(log, next, sessionTick);
+		// the game stops stepping after game over until a restart event arrives
+		if (sessionTick >= log.endTick || gameOver) break;
+		simulateStep(dt);
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+///////////////
+// Input recording & replay
+// Every key/special event is logged with the step it arrived before (sessionTick), so a
+// replay that applies the same events before the same steps reproduces the session bit
+// for bit. Logs are small binary files: a fixed header with the settings that shape the
+// simulation, then one varint tick delta + type + key per event.
+///////////////
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "coral_mazegen.h"
+
+enum InputEventType { INPUT_EVENT_KEY_DOWN, INPUT_EVENT_KEY_UP, INPUT_EVENT_SPECIAL, INPUT_EVENT_TYPE_COUNT };
+
+struct InputEvent {
+	long long tick; // sessionTick when the event arrived (applied before the next step)
+	uint8_t type; // InputEventType
+	uint8_t key; // ASCII key, or the GLUT_KEY_* code for INPUT_EVENT_SPECIAL
+};
+
+struct InputLog {
+	float simHz;
+	float playerSpeed;
+	int mazeCells; // levelMaze settings of the session (0 = hand-made layout)
+	unsigned mazeSeed;
+	int mazeAlgorithm;
+	int mazeTile;
+	std::string levelPath; // --level file of the session, empty for built-in/generated layouts
+	int agentCount; // divers in the maze, the player included
+	uint64_t streamBudget; // --stream budget in bytes, 0 when the level was mapped whole
+	long long endTick; // sessionTick when recording stopped
+	std::vector<InputEvent> events;
+};
+
+extern InputLog inputRecording;
+extern bool inputRecordingOn;
+
+// starts a new log with the current settings and zeroes sessionTick (call before resetGame)
+void beginInputRecording(float simHz);
+void recordInputEvent(InputEventType type, unsigned char key); // no-op while not recording
+bool saveInputRecording(const char* path); // stamps endTick, then writes the log
+
+bool saveInputLog(const char* path, const InputLog& log);
+bool loadInputLog(const char* path, InputLog& log); // refuses logs of streamed sessions
+
+// simulation side of one event (restart after game over, held keys, animation toggles)
+void applyInputEvent(const InputEvent& e);
+
+// replay: beginReplay restores the log settings and starts a fresh round at sessionTick 0;
+// replayEventsUntil applies the events up to tick and returns how many it applied
+void beginReplay(const InputLog& log);
+int replayEventsUntil(const InputLog& log, size_t& next, long long tick);
+void replaySession(const InputLog& log); // whole log at full speed, no front end
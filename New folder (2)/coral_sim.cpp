@@ -0,0 +1,817 @@
+#include "coral_sim.h"
+#include "coral_mazegen.h"
+#include "coral_level.h"
+#include "coral_stream.h"
+#include "coral_nav.h"
+#include "coral_jobs.h"
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+///////////////
+// Globals (divers & game state)
+///////////////
+static Agent makeAgent(float x, float z, uint32_t seed) {
+	Agent a = {};
+	a.x = a.prevX = x;
+	a.y = a.prevY = 0.05f / 2 + 0.1f;
+	a.z = a.prevZ = z;
+	a.rng = seed | 1; // xorshift state must not be 0
+	return a;
+}
+
+std::vector<Agent> agents(1, makeAgent(5.0f, 5.0f, 1));
+int agentCount = 1;
+int simThreads = 0;
+float playerSpeed = 3.6f; // movement speed (units per second; 0.12 per key repeat at 30 Hz)
+
+unsigned inputKeys = 0;
+
+float groundY = 0.05f / 2 + 0.1f; // ground level
+float maxPlayerY = 3.0f; // maximum allowed height
+
+int collectedGoals = 0;
+int totalGoals = 3;
+
+// Timer
+float gameTime = 90.0f; // seconds
+bool gameOver = false;
+bool gameWin = false;
+long long simTick = 0;
+long long sessionTick = 0;
+
+float colorPhase = 0.0f;
+unsigned layoutRevision = 0;
+
+float arenaSize = 10.0f;
+float playerStartX = 5.0f;
+float playerStartZ = 5.0f;
+
+const char* levelFilePath = nullptr;
+
+// major rocks: x, y, z, size
+const float handMadeRocks[3][4] = {
+	{ 1.0f, 0.08f, 1.2f, 0.35f },
+	{ 8.2f, 0.08f, 1.6f, 0.45f },
+	{ 4.0f, 0.08f, 8.2f, 0.30f },
+};
+float majorRocks[3][4];
+
+MazeGrid levelGrid; // cell walls of the generated maze (empty for the hand-made layout)
+
+///////////////
+// AABB collision helper
+///////////////
+bool aabbIntersects(const AABB& a, const AABB& b) {
+	return (a.minx <= b.maxx && a.maxx >= b.minx) &&
+		(a.miny <= b.maxy && a.maxy >= b.miny) &&
+		(a.minz <= b.maxz && a.maxz >= b.minz);
+}
+
+///////////////
+// Scene objects (structures)
+///////////////
+std::vector<SceneObj> majorObjs(2);
+std::vector<SceneObj> regObjs(3);
+
+std::vector<GoalObj> goals;
+AabbSoA goalBoxes;
+
+LevelArray<CoralSegment> coralSegments;
+
+///////////////
+// AABB factories (player, coral, major, regular, goal, rock)
+///////////////
+AABB getAgentAABB(const Agent& a) {
+	// tighter player box so player can touch walls/objects closely
+	const float halfx = 0.14f;
+	const float halfy = 0.48f;
+	const float halfz = 0.14f;
+	return AABB{ a.x - halfx, a.y - halfy, a.z - halfz,
+	a.x + halfx, a.y + halfy, a.z + halfz };
+}
+AABB getPlayerAABB() {
+	return getAgentAABB(player());
+}
+AABB getGoalAABB(const GoalObj& g) {
+
+	float r = 0.20f;
+	return AABB{ g.x - r, g.y - r, g.z - r, g.x + r, g.y + r, g.z + r };
+}
+AABB getCoralAABB(const CoralSegment& c) {
+	return AABB{ c.x, c.y, c.z, c.x + c.w, c.y + c.h, c.z + c.d };
+}
+AABB getMajorAABB(const SceneObj& o) {
+	const float extent = 0.50f;
+	const float height = 1.10f;
+	return AABB{ o.x - extent, o.y, o.z - extent, o.x + extent, o.y + height, o.z + extent };
+}
+AABB getRegAABB(const SceneObj& o) {
+	// regular objects (rock + seaweed) extents match drawing
+	return AABB{ o.x - 0.60f, o.y, o.z - 0.60f, o.x + 0.60f, o.y + 0.90f, o.z + 0.60f };
+}
+AABB getRockAABB(float x, float y, float z, float s) {
+	float xr = 0.5f * s;
+	float yr = 0.5f * s * 0.6f;
+	return AABB{ x - xr, y - yr, z - xr, x + xr, y + yr, z + xr };
+}
+
+///////////////
+// Collision grid (uniform spatial grid for player collision queries)
+// Built from the blocking colliders (coral, majors, major rocks) when the layout is
+// (re)initialised. Cells are stored CSR-style: every cell owns a slot range sized for all
+// colliders that overlap it, with the live ones packed at the front. Hiding a collider
+// swap-removes it from its cells and showing it re-inserts into the reserved slot, so
+// visibility changes never rebuild the grid.
+///////////////
+CollisionGrid collisionGrid;
+float collisionCellSize = 1.0f;
+CollisionScratch mainScratch;
+
+static void gridCellRange(const CollisionGrid& g, const AABB& b, int& x0, int& z0, int& x1, int& z1) {
+	x0 = std::max((int)floorf((b.minx - g.originX) / g.cellSize), 0);
+	z0 = std::max((int)floorf((b.minz - g.originZ) / g.cellSize), 0);
+	x1 = std::min((int)floorf((b.maxx - g.originX) / g.cellSize), g.nx - 1);
+	z1 = std::min((int)floorf((b.maxz - g.originZ) / g.cellSize), g.nz - 1);
+}
+
+void buildCollisionGrid() {
+	CollisionGrid& g = collisionGrid;
+	g.boxes.clear();
+	g.boxes.reserve((int)(coralSegments.size() + majorObjs.size() + 3));
+
+	g.kindBase[COLLIDER_CORAL] = 0;
+	for (const auto& c : coralSegments) g.boxes.push(getCoralAABB(c), c.visible);
+	g.kindBase[COLLIDER_MAJOR] = g.boxes.count;
+	for (const auto& m : majorObjs) g.boxes.push(getMajorAABB(m), m.visible);
+	g.kindBase[COLLIDER_ROCK] = g.boxes.count;
+	for (const auto& r : majorRocks) g.boxes.push(getRockAABB(r[0], r[1], r[2], r[3]), true);
+	g.kindBase[COLLIDER_KIND_COUNT] = g.boxes.count;
+
+	buildGoalBoxes();
+
+	// grid covers every collider (generated levels may be larger than the arena); a streamed
+	// world covers only its resident coral and lists the majors/rocks beyond it as outside
+	float minx = 0.0f, minz = 0.0f, maxx = arenaSize, maxz = arenaSize;
+	int covered = g.boxes.count;
+	if (worldStreamActive()) {
+		covered = g.kindBase[COLLIDER_MAJOR];
+		// nothing resident yet: a small grid around the diver
+		minx = covered > 0 ? 1e30f : player().x - 1.0f; maxx = covered > 0 ? -1e30f : player().x + 1.0f;
+		minz = covered > 0 ? 1e30f : player().z - 1.0f; maxz = covered > 0 ? -1e30f : player().z + 1.0f;
+	}
+	for (int id = 0;id < covered;id++) {
+		AABB b = g.boxes.get(id);
+		minx = std::min(minx, b.minx); minz = std::min(minz, b.minz);
+		maxx = std::max(maxx, b.maxx); maxz = std::max(maxz, b.maxz);
+	}
+	g.cellSize = collisionCellSize;
+	g.originX = minx;
+	g.originZ = minz;
+	g.nx = std::max(1, (int)ceilf((maxx - minx) / g.cellSize));
+	g.nz = std::max(1, (int)ceilf((maxz - minz) / g.cellSize));
+	g.outside.clear();
+	for (int id = covered;id < g.boxes.count;id++) {
+		AABB b = g.boxes.get(id);
+		if (b.minx < minx || b.minz < minz || b.maxx > maxx || b.maxz > maxz) g.outside.push_back(id);
+	}
+
+	// count slots per cell, prefix sum, then place the live colliders
+	int cells = g.nx * g.nz;
+	g.cellStart.assign(cells + 1, 0);
+	g.cellCount.assign(cells, 0);
+	int x0, z0, x1, z1;
+	for (int id = 0;id < g.boxes.count;id++) {
+		gridCellRange(g, g.boxes.get(id), x0, z0, x1, z1);
+		for (int z = z0;z <= z1;z++)
+			for (int x = x0;x <= x1;x++) g.cellStart[z * g.nx + x + 1]++;
+	}
+	for (int i = 0;i < cells;i++) g.cellStart[i + 1] += g.cellStart[i];
+	g.items.assign(g.cellStart[cells], -1);
+	for (int id = 0;id < g.boxes.count;id++) {
+		if (!g.boxes.isVisible(id)) continue;
+		gridCellRange(g, g.boxes.get(id), x0, z0, x1, z1);
+		for (int z = z0;z <= z1;z++)
+			for (int x = x0;x <= x1;x++) {
+				int cell = z * g.nx + x;
+				g.items[g.cellStart[cell] + g.cellCount[cell]++] = id;
+			}
+	}
+}
+
+void buildGoalBoxes() {
+	goalBoxes.clear();
+	for (const auto& goal : goals) goalBoxes.push(getGoalAABB(goal), goal.visible);
+}
+
+// incremental path for visibility flips: only the cells the collider overlaps are touched
+void setColliderLive(ColliderKind kind, int index, bool isLive) {
+	CollisionGrid& g = collisionGrid;
+	int id = g.kindBase[kind] + index;
+	g.boxes.setVisible(id, isLive);
+	int x0, z0, x1, z1;
+	gridCellRange(g, g.boxes.get(id), x0, z0, x1, z1);
+	for (int z = z0;z <= z1;z++)
+		for (int x = x0;x <= x1;x++) {
+			int cell = z * g.nx + x;
+			int* slots = &g.items[g.cellStart[cell]];
+			int& n = g.cellCount[cell];
+			int at = (int)(std::find(slots, slots + n, id) - slots);
+			if (isLive && at == n) slots[n++] = id;
+			else if (!isLive && at < n) slots[at] = slots[--n];
+		}
+}
+
+void setCoralVisible(int index, bool visible) {
+	if (coralSegments[index].visible == visible) return;
+	coralSegments[index].visible = visible;
+	setColliderLive(COLLIDER_CORAL, index, visible);
+	layoutRevision++;
+}
+
+void setMajorVisible(int index, bool visible) {
+	if (majorObjs[index].visible == visible) return;
+	majorObjs[index].visible = visible;
+	setColliderLive(COLLIDER_MAJOR, index, visible);
+}
+
+// calls visit(id) once for every live collider overlapping box, in the cells under the box;
+// stops early when visit returns true. The grid itself is only read, so threads with their
+// own scratch can query it at the same time.
+template <class Visit>
+static bool gridVisit(const AABB& box, CollisionScratch& s, Visit visit) {
+	const CollisionGrid& g = collisionGrid;
+	if (s.stamp.size() < (size_t)g.boxes.count) s.stamp.resize(g.boxes.count, 0); // stale stamps are all older than queryStamp
+	if (++s.queryStamp == 0) {
+		std::fill(s.stamp.begin(), s.stamp.end(), 0);
+		s.queryStamp = 1;
+	}
+	int x0, z0, x1, z1;
+	gridCellRange(g, box, x0, z0, x1, z1);
+	for (int z = z0;z <= z1;z++)
+		for (int x = x0;x <= x1;x++) {
+			int cell = z * g.nx + x;
+			const int* slots = &g.items[g.cellStart[cell]];
+			for (int k = 0;k < g.cellCount[cell];k++) {
+				int id = slots[k];
+				if (s.stamp[id] == s.queryStamp) continue;
+				s.stamp[id] = s.queryStamp;
+				if (aabbIntersects(box, g.boxes.get(id)) && visit(id)) return true;
+			}
+		}
+	for (int id : g.outside) {
+		if (!g.boxes.isVisible(id) || s.stamp[id] == s.queryStamp) continue;
+		s.stamp[id] = s.queryStamp;
+		if (aabbIntersects(box, g.boxes.get(id)) && visit(id)) return true;
+	}
+	return false;
+}
+
+// true if the box overlaps any live collider
+bool gridCollides(const AABB& box) {
+	return gridVisit(box, mainScratch, [](int) { return true; });
+}
+
+void gridQuery(const AABB& box, std::vector<int>& ids) {
+	gridQuery(box, ids, mainScratch);
+}
+
+void gridQuery(const AABB& box, std::vector<int>& ids, CollisionScratch& scratch) {
+	ids.clear();
+	gridVisit(box, scratch, [&](int id) {
+		ids.push_back(id);
+		return false;
+		});
+}
+
+///////////////
+// Build a tidy maze layout with no overlaps and clear collectible spots
+///////////////
+void buildMazeLayout() {
+	coralSegments.clear();
+
+	if (levelMaze.cells > 0) {
+		// a restart keeps the maze it already generated from the same parameters
+		static MazeParams gridMaze;
+		if (levelGrid.n != levelMaze.cells || memcmp(&gridMaze, &levelMaze, sizeof(MazeParams)) != 0) {
+			generateMaze(levelMaze, levelGrid);
+			gridMaze = levelMaze;
+		}
+		mazeToSegments(levelGrid, levelMaze, coralSegments);
+		arenaSize = levelMaze.cells * levelMaze.cellSize;
+		// spawn in the centre cell
+		playerStartX = playerStartZ = (levelMaze.cells / 2 + 0.5f) * levelMaze.cellSize;
+		return;
+	}
+	levelGrid.n = 0;
+	levelGrid.walls.clear();
+	arenaSize = 10.0f;
+	playerStartX = 5.0f;
+	playerStartZ = 5.0f;
+
+	auto addBox = [&](float x, float z, float w, float d) {
+		CoralSegment s;
+		s.x = x; s.z = z; s.y = 0.0f;
+		s.w = w; s.d = d; s.h = 0.9f;
+		s.visible = true;
+		coralSegments.push_back(s);
+		};
+
+	// Layout chosen to create a few corridors and visible collectible spots
+	// Coordinates are chosen not to overlap with majors/regObjs or rocks
+
+	// vertical wall left
+	addBox(1.0f, 1.0f, 0.4f, 6.5f); // from z=1 to z=7.5
+	// vertical wall right
+	addBox(8.6f, 2.0f, 0.4f, 6.0f); // from z=2 to z=8
+	// horizontal middle bar
+	addBox(2.0f, 4.0f, 4.8f, 0.4f); // from x=2 to x=6.8 at z=4
+	// small divider near start
+	addBox(4.2f, 1.4f, 0.4f, 1.8f);
+	// another small divider near end
+	addBox(6.0f, 6.0f, 0.4f, 1.8f);
+
+	// pillars (clear, not overlapping)
+	addBox(3.0f, 7.6f, 0.6f, 0.6f);
+	addBox(5.6f, 7.6f, 0.6f, 0.6f);
+}
+
+///////////////
+// Generated maze objects (seeded like the maze)
+// Goals and regular objects go on random cells reachable from the spawn (BFS), blocking
+// majors only into dead ends so they never cut a path, and rocks against a cell corner
+// where they leave the corridor passable.
+///////////////
+static void initGeneratedObjects() {
+	const int n = levelGrid.n;
+	const float cs = levelMaze.cellSize;
+	MazeRng rng(((uint64_t)levelMaze.seed << 32) ^ 0x5CE7Eull);
+	int start = (n / 2) * n + n / 2;
+	// scratch kept between rounds, so a restart does not reallocate it
+	static std::vector<int> dist, reachable, deadEnds;
+	static std::vector<char> taken;
+	mazeDistances(levelGrid, start, dist);
+	reachable.clear();
+	deadEnds.clear();
+	static const int steps[4][2] = { {1,0},{-1,0},{0,1},{0,-1} };
+	for (int cell = 0;cell < n * n;cell++) {
+		if (dist[cell] <= 0) continue; // unreachable or the spawn cell
+		reachable.push_back(cell);
+		int exits = 0;
+		for (const auto& s : steps) exits += levelGrid.open(cell, s[0], s[1]) ? 1 : 0;
+		if (exits == 1) deadEnds.push_back(cell);
+	}
+	for (int i = (int)deadEnds.size() - 1;i > 0;i--) std::swap(deadEnds[i], deadEnds[rng.below(i + 1)]);
+	taken.assign(n * n, 0);
+	auto centreX = [&](int cell) { return (cell % n + 0.5f) * cs; };
+	auto centreZ = [&](int cell) { return (cell / n + 0.5f) * cs; };
+	// a random reachable cell not used yet (falls back to any reachable cell when crowded)
+	auto pickCell = [&]() {
+		for (int tries = 0;tries < 64;tries++) {
+			int cell = reachable[rng.below((int)reachable.size())];
+			if (!taken[cell]) { taken[cell] = 1; return cell; }
+		}
+		return reachable[rng.below((int)reachable.size())];
+		};
+
+	// majors (large, blocking): dead ends only; hidden when the maze has too few
+	for (size_t i = 0;i < majorObjs.size();i++) {
+		SceneObj& m = majorObjs[i];
+		m.y = 0.0f; m.animPhase = 0; m.animating = true;
+		m.visible = i < deadEnds.size();
+		if (!m.visible) continue;
+		taken[deadEnds[i]] = 1;
+		m.x = centreX(deadEnds[i]); m.z = centreZ(deadEnds[i]);
+	}
+
+	if (reachable.empty()) reachable.push_back(start);
+
+	// rocks: tucked into a random corner of their cell
+	for (auto& r : majorRocks) {
+		int cell = pickCell();
+		float inset = levelMaze.wallThickness / 2.0f + 0.3f;
+		float sx = rng.below(2) ? 1.0f : -1.0f, sz = rng.below(2) ? 1.0f : -1.0f;
+		r[0] = centreX(cell) + sx * (cs / 2.0f - inset);
+		r[1] = 0.08f;
+		r[2] = centreZ(cell) + sz * (cs / 2.0f - inset);
+		r[3] = 0.30f + 0.05f * rng.below(4);
+	}
+
+	// regular (minor, non-blocking) objects
+	for (auto& r : regObjs) {
+		int cell = pickCell();
+		r.x = centreX(cell); r.y = 0.0f; r.z = centreZ(cell);
+		r.visible = true; r.animating = true; r.animPhase = 0;
+	}
+
+	// goals (collectibles) on reachable cells
+	goals.clear();
+	for (int i = 0;i < totalGoals;i++) {
+		int cell = pickCell();
+		GoalObj g;
+		g.x = centreX(cell); g.z = centreZ(cell); g.y = 0.6f;
+		g.visible = true; g.phase = 0.5f + i;
+		goals.push_back(g);
+	}
+	colorPhase = 0.0f;
+}
+
+///////////////
+// Initialize objects tidily (no overlaps)
+///////////////
+void initSceneObjects() {
+	layoutRevision++;
+	if (levelFilePath) {
+		// remapped every round, so last round's visibility flips are dropped; a streamed
+		// level reads just the chunks around the spawn
+		if (streamBudgetBytes > 0 ? beginWorldStream(levelFilePath) : loadLevelFile(levelFilePath)) return;
+		fprintf(stderr, "falling back to the built-in layout\n");
+		levelFilePath = nullptr;
+	}
+	if (worldStreamActive()) endWorldStream();
+	buildMazeLayout();
+	totalGoals = 3;
+	majorObjs.resize(2);
+	regObjs.resize(3);
+
+	if (levelMaze.cells > 0) {
+		initGeneratedObjects();
+		buildCollisionGrid();
+		return;
+	}
+	std::copy(&handMadeRocks[0][0], &handMadeRocks[0][0] + 12, &majorRocks[0][0]);
+
+	// majors (large, blocking).
+	majorObjs[0].x = 2.0f; majorObjs[0].y = 0.0f; majorObjs[0].z = 1.8f;
+	majorObjs[0].visible = true; majorObjs[0].animPhase = 0; majorObjs[0].animating = true;
+
+	majorObjs[1].x = 7.2f; majorObjs[1].y = 0.0f; majorObjs[1].z = 6.8f;
+	majorObjs[1].visible = true; majorObjs[1].animPhase = 0; majorObjs[1].animating = true;
+
+	// regular (minor) objects (seaweed/rock clusters).
+	regObjs[0].x = 3.4f; regObjs[0].y = 0.0f; regObjs[0].z = 3.2f; regObjs[0].visible = true; regObjs[0].animating = true;
+	regObjs[1].x = 6.4f; regObjs[1].y = 0.0f; regObjs[1].z = 2.2f; regObjs[1].visible = true; regObjs[1].animating = true;
+	regObjs[2].x = 2.2f; regObjs[2].y = 0.0f; regObjs[2].z = 8.4f; regObjs[2].visible = true; regObjs[2].animating = true;
+
+	// goals (collectibles)
+	goals.clear();
+	// visible near corridor junction
+	GoalObj g1; g1.x = 4.5f; g1.z = 3.7f; g1.y = 0.6f; g1.visible = true; g1.phase = 0.5f; goals.push_back(g1);
+	// visible in small alcove (raised to require floating)
+	GoalObj g2; g2.x = 7.8f; g2.z = 7.8f; g2.y = 1.6f; g2.visible = true; g2.phase = 1.5f; goals.push_back(g2);
+	// visible near pillar cluster (easy to spot)
+	GoalObj g3; g3.x = 1.5f; g3.z = 9.0f; g3.y = 0.65f; g3.visible = true; g3.phase = 2.5f; goals.push_back(g3);
+	colorPhase = 0.0f;
+
+	// collision grid over the new layout (coral, majors, rocks)
+	buildCollisionGrid();
+}
+
+///////////////
+// New round (startup and R after game over)
+///////////////
+void resetGame() {
+	gameOver = false;
+	gameWin = false;
+	collectedGoals = 0;
+	gameTime = 90.0f;
+	simTick = 0;
+	initSceneObjects(); // sets the spawn point of the layout
+	spawnAgents();
+}
+
+// autonomous divers start on random spots inside the arena where their box is free (and, in
+// a streamed world, resident); the same layout and count always give the same spots
+void spawnAgents() {
+	agents.assign(1, makeAgent(playerStartX, playerStartZ, 1));
+	MazeRng rng(0xD1BE5ull ^ ((uint64_t)levelMaze.seed << 32));
+	const float margin = wallTh + 0.14f;
+	for (int i = 1;i < agentCount;i++) {
+		Agent a = makeAgent(playerStartX, playerStartZ, (uint32_t)rng.next());
+		for (int tries = 0;tries < 32;tries++) {
+			a.x = margin + (arenaSize - 2.0f * margin) * (float)(rng.next() >> 40) / (float)(1 << 24);
+			a.z = margin + (arenaSize - 2.0f * margin) * (float)(rng.next() >> 40) / (float)(1 << 24);
+			AABB box = getAgentAABB(a);
+			if (gridCollides(box)) continue;
+			if (worldStreamActive()) {
+				streamBlockers(box, mainScratch.blockers);
+				if (!mainScratch.blockers.empty()) continue;
+			}
+			break;
+		}
+		a.prevX = a.x; a.prevZ = a.z;
+		agents.push_back(a);
+	}
+}
+
+///////////////
+// Player movement (swept AABB, per-axis sliding)
+// The move is resolved one axis at a time (x, z, then y). Each axis sweeps the player box
+// over the whole step and stops it a skin short of the first collider in the way, so no
+// speed or tick rate can tunnel through a wall, and the other axes still slide along it.
+///////////////
+static const float collisionSkin = 0.001f; // gap left between the diver and a wall it ran into
+
+static float boxMin(const AABB& b, int axis) { return axis == 0 ? b.minx : (axis == 1 ? b.miny : b.minz); }
+static float boxMax(const AABB& b, int axis) { return axis == 0 ? b.maxx : (axis == 1 ? b.maxy : b.maxz); }
+
+// distance the box can travel along axis (towards d) before it would touch a live collider.
+// Colliders the box already overlaps by more than the skin are ignored so a diver caught
+// inside one can walk out.
+// Chunks of a streamed world that are not in memory yet count as colliders.
+static float sweepAxis(const AABB& box, int axis, float d, CollisionScratch& scratch) {
+	if (d == 0.0f) return 0.0f;
+	AABB swept = box;
+	if (axis == 0) { if (d > 0) swept.maxx += d; else swept.minx += d; }
+	else if (axis == 1) { if (d > 0) swept.maxy += d; else swept.miny += d; }
+	else { if (d > 0) swept.maxz += d; else swept.minz += d; }
+
+	float allowed = fabsf(d);
+	auto limit = [&](const AABB& c) {
+		// must overlap on the other two axes (strictly, so sliding along a face is free)
+		for (int a = 0;a < 3;a++)
+			if (a != axis && !(boxMin(box, a) < boxMax(c, a) && boxMax(box, a) > boxMin(c, a))) return;
+		float gap = d > 0 ? boxMin(c, axis) - boxMax(box, axis) : boxMin(box, axis) - boxMax(c, axis);
+		if (gap < -collisionSkin) return; // behind the box, or already overlapping (rounding after a stop stays within the skin)
+		allowed = std::min(allowed, std::max(0.0f, gap - collisionSkin));
+		};
+	gridQuery(swept, scratch.ids, scratch);
+	for (int id : scratch.ids) limit(collisionGrid.boxes.get(id));
+	if (worldStreamActive()) {
+		streamBlockers(swept, scratch.blockers);
+		for (const AABB& c : scratch.blockers) limit(c);
+	}
+	return d > 0 ? allowed : -allowed;
+}
+
+void moveAgent(Agent& a, float dx, float dy, float dz, CollisionScratch& scratch) {
+	a.prevX = a.x;
+	a.prevZ = a.z;
+	a.prevY = a.y;
+
+	// clamp each target to the arena bounds (player half-extents) and the allowed height first,
+	// so every axis sweeps from where the diver really ends up on the previous one
+	const float phalfx = 0.14f;
+	const float phalfz = 0.14f;
+	float tx = std::min(std::max(a.x + dx, wallTh + phalfx), arenaSize - wallTh - phalfx);
+	a.x += sweepAxis(getAgentAABB(a), 0, tx - a.x, scratch);
+	float tz = std::min(std::max(a.z + dz, wallTh + phalfz), arenaSize - wallTh - phalfz);
+	a.z += sweepAxis(getAgentAABB(a), 2, tz - a.z, scratch);
+	float ty = std::min(std::max(a.y + dy, groundY), maxPlayerY);
+	a.y += sweepAxis(getAgentAABB(a), 1, ty - a.y, scratch);
+}
+
+///////////////
+// Player input (simulation side of the keyboard handler)
+///////////////
+bool setInputKey(unsigned char key, bool down) {
+	int bit;
+	switch (key) {
+		// player movement (kept EXACT keys: I/J/K/L)
+	case 'i': bit = INPUT_FORWARD; break; // forward (decreasing Z)
+	case 'k': bit = INPUT_BACK; break; // backward
+	case 'j': bit = INPUT_LEFT; break; // left
+	case 'l': bit = INPUT_RIGHT; break; // right
+
+		// vertical movement: u = up, o = down
+	case 'u': bit = INPUT_UP; break;
+	case 'o': bit = INPUT_DOWN; break;
+	default: return false;
+	}
+	if (down) inputKeys |= 1u << bit;
+	else inputKeys &= ~(1u << bit);
+	return true;
+}
+
+void clearInputKeys() {
+	inputKeys = 0;
+}
+
+// held keys -> velocity and facing; opposite keys cancel, diagonals are no faster than straight moves
+static void sampleAgentVelocity(Agent& a, unsigned keys) {
+	auto held = [keys](int bit) { return (keys >> bit) & 1 ? 1.0f : 0.0f; };
+	float dx = held(INPUT_RIGHT) - held(INPUT_LEFT);
+	float dz = held(INPUT_BACK) - held(INPUT_FORWARD);
+	float len = sqrtf(dx * dx + dz * dz);
+	if (len > 0.0f) {
+		dx /= len; dz /= len;
+		a.angleY = atan2f(-dx, -dz) * 57.2957795f; // 0 = facing -z (forward)
+	}
+	a.velX = dx * playerSpeed;
+	a.velZ = dz * playerSpeed;
+	a.velY = (held(INPUT_UP) - held(INPUT_DOWN)) * playerSpeed;
+}
+
+bool applyPlayerKey(unsigned char key) {
+	switch (key) {
+		// animation toggles: M/N control majors anim start/stop
+	case 'm':
+		for (auto& mo : majorObjs) mo.animating = true;
+		break;
+	case 'n':
+		for (auto& mo : majorObjs) mo.animating = false;
+		break;
+
+		// animation toggles: ,/. control regulars anim start/stop
+	case 'v':
+		for (auto& r : regObjs) r.animating = true;
+		break;
+	case 'b':
+		for (auto& r : regObjs) r.animating = false;
+		break;
+
+	default: return false;
+	}
+	return true;
+}
+
+///////////////
+// Autonomous divers
+// Each one follows the nearest-goal flow field (coral_nav.h) one cell at a time, rising or
+// sinking to the goal's height at the end. A diver whose move was mostly blocked, or that
+// has no goal it can reach, holds a random heading (one of the eight key combinations) for
+// a while instead. The random state is per diver (xorshift), so the crowd moves the same
+// for any thread count.
+///////////////
+static uint32_t agentRandom(Agent& a) {
+	a.rng ^= a.rng << 13;
+	a.rng ^= a.rng >> 17;
+	a.rng ^= a.rng << 5;
+	return a.rng;
+}
+
+static const unsigned keyForward = 1u << INPUT_FORWARD, keyBack = 1u << INPUT_BACK;
+static const unsigned keyLeft = 1u << INPUT_LEFT, keyRight = 1u << INPUT_RIGHT;
+
+static void wanderAgent(Agent& a, int minTicks, int spread) {
+	static const unsigned headings[8] = {
+		keyForward, keyForward | keyRight, keyRight, keyBack | keyRight,
+		keyBack, keyBack | keyLeft, keyLeft, keyForward | keyLeft };
+	a.keys = headings[agentRandom(a) & 7];
+	a.thinkTicks = minTicks + (int)(agentRandom(a) % spread);
+}
+
+// keys towards the nearest goal; false if none is reachable from the diver's cell
+static bool seekGoal(Agent& a) {
+	int cell = navCellAt(a.x, a.z);
+	int goal = navNearestGoal(cell);
+	if (goal < 0) {
+		// pressed into a blocked cell: its neighbours may still lead somewhere
+		int next = navNextCell(cell);
+		goal = navNearestGoal(next);
+		if (goal < 0) return false;
+	}
+	const GoalObj& g = goals[goal];
+	float tx = g.x, tz = g.z;
+	int next = navNextCell(cell);
+	if (next >= 0) navCellCentre(next, tx, tz);
+	const float deadband = 0.05f;
+	a.keys = 0;
+	if (tx > a.x + deadband) a.keys |= keyRight;
+	else if (tx < a.x - deadband) a.keys |= keyLeft;
+	if (tz > a.z + deadband) a.keys |= keyBack;
+	else if (tz < a.z - deadband) a.keys |= keyForward;
+	// goal boxes are 0.2 in radius, the diver 0.48 tall either side of its centre
+	if (g.y - 0.2f > a.y + 0.48f) a.keys |= 1u << INPUT_UP;
+	else if (g.y + 0.2f < a.y - 0.48f) a.keys |= 1u << INPUT_DOWN;
+	return true;
+}
+
+static void thinkAgent(Agent& a, float dt) {
+	const unsigned planar = keyForward | keyBack | keyLeft | keyRight;
+	float moved = fabsf(a.x - a.prevX) + fabsf(a.z - a.prevZ);
+	if ((a.keys & planar) != 0 && moved < 0.25f * playerSpeed * dt) {
+		wanderAgent(a, 10, 50); // get round whatever stopped it, then seek again
+		return;
+	}
+	if (--a.thinkTicks > 0) return;
+	if (seekGoal(a)) a.thinkTicks = 0; // re-read the field every step
+	else wanderAgent(a, 30, 150);
+}
+
+// one autonomous diver's step; reads only the layout, the goal boxes and the nav fields
+static void stepAgent(Agent& a, float dt, CollisionScratch& scratch) {
+	thinkAgent(a, dt);
+	sampleAgentVelocity(a, a.keys);
+	moveAgent(a, a.velX * dt, a.velY * dt, a.velZ * dt, scratch);
+	a.pitch = a.y > groundY + 0.01f ? 20.0f : 0.0f;
+	a.touchingGoal = aabbBatchAny(goalBoxes, getAgentAABB(a), 0, goalBoxes.count);
+}
+
+///////////////
+// Per-worker collision scratch: worker 0 (the thread running the step) uses mainScratch
+///////////////
+static const int agentBlock = 64; // divers per task
+static std::vector<CollisionScratch> workerScratch;
+
+static CollisionScratch& jobScratch() {
+	int w = jobWorkerIndex();
+	return w == 0 ? mainScratch : workerScratch[w];
+}
+
+// sized for the whole grid before the step's jobs start (a query can't return more ids than
+// there are colliders), so the divers' queries never grow them
+static void prepareScratch(CollisionScratch& s) {
+	size_t colliders = collisionGrid.boxes.count;
+	if (s.stamp.size() < colliders) s.stamp.resize(colliders, 0);
+	if (s.ids.capacity() < colliders) s.ids.reserve(colliders);
+}
+
+// Check goals (collect) - goals are always visible or hidden but do not block
+// (one batch test over the uncollected goal boxes)
+static void collectGoals(Agent& a) {
+	static std::vector<int> goalHits;
+	goalHits.resize(goalBoxes.count);
+	int hits = aabbBatchOverlaps(goalBoxes, getAgentAABB(a), 0, goalBoxes.count, goalHits.data());
+	for (int k = 0;k < hits;k++) {
+		int i = goalHits[k];
+		goals[i].visible = false;
+		goalBoxes.setVisible(i, false);
+		collectedGoals++;
+		a.goalsCollected++;
+		if (collectedGoals >= totalGoals) {
+			gameOver = true;
+			gameWin = true;
+		}
+	}
+}
+
+///////////////
+// Simulation step (animations, collisions, timer), always advanced by a fixed dt
+// - Movement: held keys give a velocity, integrated over dt and swept against visible majors/corals/major rocks
+// - Minor objects do NOT block
+// - One job graph (coral_jobs.h): animation, the player's move and the nav sync then the other
+//   divers in blocks run side by side; goal collection waits for both moves
+///////////////
+void simulateStep(float dt) {
+	if (gameOver) return;
+	simTick++;
+	sessionTick++;
+
+	// streamed world: merge finished chunk loads, queue the next ones
+	if (worldStreamActive()) updateWorldStream();
+
+	// update timer
+	gameTime -= dt;
+	if (gameTime <= 0.0f) {
+		gameOver = true;
+		gameWin = (collectedGoals >= totalGoals);
+		return;
+	}
+
+	colorPhase += dt * 1.0f;
+
+	static JobGraph step;
+	static float stepDt;
+	static int navNode, agentsNode;
+	if (step.nodes.empty()) {
+		// animate majors if enabled (animation property unaffected by show/hide)
+		step.add("animate", [] {
+			for (auto& m : majorObjs) {
+				if (m.animating) m.animPhase += stepDt;
+			}
+			for (auto& r : regObjs) {
+				if (r.animating) r.animPhase += stepDt * 1.2f;
+			}
+			for (auto& g : goals) g.phase += stepDt * 1.5f;
+			});
+		// integrate the held-key velocity, sliding along whatever blocks the move
+		int playerNode = step.add("movePlayer", [] {
+			Agent& p = player();
+			sampleAgentVelocity(p, inputKeys);
+			moveAgent(p, p.velX * stepDt, p.velY * stepDt, p.velZ * stepDt, jobScratch());
+
+			// airborne detection and pitch (positive tilts head forward around x-axis)
+			bool airborne = (p.y > groundY + 0.01f);
+			p.pitch = airborne ? 20.0f : 0.0f;
+			});
+		// the other divers in blocks, steering by the nearest-goal field
+		navNode = step.add("syncNav", [] { syncNav(); });
+		agentsNode = step.addFor("moveAgents", 0, agentBlock, [](int begin, int end) {
+			CollisionScratch& scratch = jobScratch();
+			for (int i = begin;i < end;i++) stepAgent(agents[1 + i], stepDt, scratch);
+			}, { navNode });
+		// goals: the player first, then the divers that touched one in order, so the same
+		// inputs collect the same goals for any worker count
+		step.add("collectGoals", [] {
+			collectGoals(player());
+			for (size_t i = 1;i < agents.size();i++)
+				if (agents[i].touchingGoal) collectGoals(agents[i]);
+			}, { playerNode, agentsNode });
+	}
+	stepDt = dt;
+	int crowd = (int)agents.size() - 1;
+	step.setCount(navNode, crowd > 0 ? 1 : 0);
+	step.setCount(agentsNode, crowd);
+	// a crowd of one block or less is cheaper on this thread than waking the workers
+	prepareScratch(mainScratch);
+	if (crowd > agentBlock && jobWorkerCount() > 1) {
+		workerScratch.resize(jobWorkerCount());
+		for (size_t w = 1;w < workerScratch.size();w++) prepareScratch(workerScratch[w]);
+		runJobs(step);
+	}
+	else runJobsSerial(step);
+}
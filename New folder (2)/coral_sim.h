@@ -0,0 +1,178 @@
+#pragma once
+///////////////
+// Coral maze simulation: scene data, collision and the fixed-step game update.
+// No GL/GLUT dependency, so it is shared by the GLUT game and the headless runner.
+///////////////
+#include <vector>
+#include <cstdint>
+
+#include "coral_aabb_batch.h"
+
+#define DEG2RAD(a) (a *0.0174532925f)
+
+///////////////
+// Divers & game state
+// agents[0] is the player, steered by the held keys; the others are autonomous divers that
+// wander the maze by holding keys of their own (--agents N). All of them collide with the
+// layout and collect goals; they don't collide with each other.
+///////////////
+struct Agent {
+	float x, y, z;
+	float angleY; // rotation to face movement
+	float pitch; // tilt on x-axis when airborne
+	float prevX, prevY, prevZ;
+	float velX, velY, velZ; // from the held keys, sampled at the start of each step (units per second)
+	unsigned keys; // held InputKey bits of an autonomous diver (the player's are inputKeys)
+	uint32_t rng; // wander state
+	int thinkTicks; // steps until the diver picks a new heading
+	bool touchingGoal; // overlapped an uncollected goal after its last move
+	int goalsCollected;
+};
+
+extern std::vector<Agent> agents; // never empty
+inline Agent& player() { return agents[0]; }
+
+extern int agentCount; // divers resetGame spawns, the player included
+extern int simThreads; // job system workers (coral_jobs.h), the calling thread included; 0 = hardware concurrency
+extern float playerSpeed; // movement speed (units per second while a key is held)
+
+extern float groundY; // ground level
+extern float maxPlayerY; // maximum allowed height
+
+extern int collectedGoals;
+extern int totalGoals;
+
+extern float gameTime; // seconds left
+extern bool gameOver;
+extern bool gameWin;
+extern long long simTick; // simulated steps since the last reset
+extern long long sessionTick; // simulated steps since startup or the start of a recording/replay; resetGame keeps it
+
+///////////////
+// AABB collision helper (AABB and the batch store are in coral_aabb_batch.h)
+///////////////
+bool aabbIntersects(const AABB& a, const AABB& b);
+
+///////////////
+// Scene objects (structures)
+///////////////
+struct SceneObj {
+	float x, y, z;
+	float sx, sy, sz;
+	bool visible;
+	bool animating;
+	float animPhase;
+	SceneObj() : x(0), y(0), z(0), sx(1), sy(1), sz(1), visible(true), animating(false), animPhase(0) {}
+};
+
+extern std::vector<SceneObj> majorObjs;
+extern std::vector<SceneObj> regObjs;
+
+struct GoalObj {
+	float x, y, z;
+	bool visible;
+	float phase;
+};
+extern std::vector<GoalObj> goals;
+extern AabbSoA goalBoxes; // goal i -> box, visibility bit = not yet collected
+
+struct CoralSegment {
+	float x, y, z;
+	float w, h, d; // box dims
+	bool visible;
+};
+extern LevelArray<CoralSegment> coralSegments;
+
+///////////////
+// Arena
+///////////////
+extern float arenaSize; // square arena side; 10 for the hand-made layout, set by generated mazes
+const float wallHeight = 1.0f;
+const float wallTh = 0.2f;
+
+extern float colorPhase;
+
+// bumped whenever the coral layout or a coral's visibility changes; renderer caches key off it
+extern unsigned layoutRevision;
+
+// major rocks: x, y, z, size
+extern float majorRocks[3][4];
+
+// diver spawn point of the current layout
+extern float playerStartX;
+extern float playerStartZ;
+
+// binary level (coral_level.h) used instead of the hand-made/generated layout; --level file
+extern const char* levelFilePath;
+
+///////////////
+// AABB factories (player, coral, major, regular, goal, rock)
+///////////////
+AABB getAgentAABB(const Agent& a);
+AABB getPlayerAABB();
+AABB getGoalAABB(const GoalObj& g);
+AABB getCoralAABB(const CoralSegment& c);
+AABB getMajorAABB(const SceneObj& o);
+AABB getRegAABB(const SceneObj& o);
+AABB getRockAABB(float x, float y, float z, float s);
+
+///////////////
+// Collision grid (uniform spatial grid for player collision queries)
+///////////////
+enum ColliderKind { COLLIDER_CORAL, COLLIDER_MAJOR, COLLIDER_ROCK, COLLIDER_KIND_COUNT };
+
+struct CollisionGrid {
+	float originX, originZ;
+	float cellSize;
+	int nx, nz;
+	LevelArray<int> cellStart; // nx*nz+1 slot offsets into items
+	LevelArray<int> cellCount; // live entries per cell
+	LevelArray<int> items; // collider ids
+	AabbSoA boxes; // collider id -> box, visibility bit = live
+	std::vector<int> outside; // colliders reaching beyond the grid (streamed worlds), tested by every query
+	int kindBase[COLLIDER_KIND_COUNT + 1]; // first collider id of each kind
+};
+
+// per-thread query state, so several threads can query the grid at once
+struct CollisionScratch {
+	std::vector<unsigned> stamp; // collider id -> last query that saw it
+	unsigned queryStamp = 0;
+	std::vector<int> ids;
+	std::vector<AABB> blockers;
+};
+
+extern CollisionGrid collisionGrid;
+extern float collisionCellSize;
+extern CollisionScratch mainScratch; // simulation thread
+
+void buildCollisionGrid(); // also refreshes goalBoxes
+void buildGoalBoxes();
+void setColliderLive(ColliderKind kind, int index, bool isLive);
+void setCoralVisible(int index, bool visible);
+void setMajorVisible(int index, bool visible);
+bool gridCollides(const AABB& box);
+void gridQuery(const AABB& box, std::vector<int>& ids); // live collider ids overlapping box, each once
+void gridQuery(const AABB& box, std::vector<int>& ids, CollisionScratch& scratch);
+
+///////////////
+// Held-key input
+// The front end records key down/up into a bitset; simulateStep samples it once per tick,
+// so movement speed depends on neither the key-repeat rate nor the frame rate.
+///////////////
+enum InputKey { INPUT_FORWARD, INPUT_BACK, INPUT_LEFT, INPUT_RIGHT, INPUT_UP, INPUT_DOWN, INPUT_KEY_COUNT };
+
+extern unsigned inputKeys; // bit (1 << InputKey) set while the key is held
+
+bool setInputKey(unsigned char key, bool down); // i/k/j/l/u/o; false if not a movement key
+void clearInputKeys();
+
+///////////////
+// Layout, input & update
+///////////////
+void buildMazeLayout(); // hand-made layout, or a generated maze when levelMaze.cells > 0
+void initSceneObjects();
+void resetGame(); // new round: divers, timer, goals and layout
+void spawnAgents(); // player at the spawn point, the other divers on random free spots
+bool applyPlayerKey(unsigned char key); // animation toggles (m/n, v/b); false if not one of them
+void moveAgent(Agent& a, float dx, float dy, float dz, CollisionScratch& scratch); // swept move with per-axis sliding, then arena clamp
+void simulateStep(float dt);
@@ -0,0 +1,89 @@
+#include "coral_snapshot.h"
+#include "coral_nav.h"
+#include "coral_profiler.h"
+
+#include <atomic>
+#include <algorithm>
+
+bool snapshotNavHint = false;
+
+///////////////
+// Triple buffer
+// middle holds the slot index handed over between the two sides, plus snapshotFresh while
+// the render side hasn't taken it yet. The exchanges order the copies: everything the
+// simulation wrote before its exchange is visible after the render side's.
+///////////////
+const int snapshotFresh = 4;
+
+static SimSnapshot slots[3];
+static std::atomic<int> middle{ 1 };
+static int back = 0; // simulation side
+static int published = -1; // simulation side: the slot it handed over last
+static int front = 2; // render side
+static unsigned sequence = 0;
+static std::shared_ptr<const SimLayout> layout; // simulation side: the newest generation
+
+static void captureFrame(SimFrame& f) {
+	f.agents.resize(agents.size());
+	for (size_t i = 0;i < agents.size();i++) {
+		const Agent& a = agents[i];
+		f.agents[i] = AgentPose{ a.x, a.y, a.z, a.angleY, a.pitch };
+	}
+	f.majors = majorObjs; // same sizes tick to tick: copied into the slot's storage
+	f.regs = regObjs;
+	f.goals = goals;
+	f.colorPhase = colorPhase;
+}
+
+// a new generation for the current layoutRevision; the old one lives on in the slots that
+// still hold it
+static std::shared_ptr<const SimLayout> captureLayout() {
+	PROFILE_ZONE("captureLayout");
+	auto l = std::make_shared<SimLayout>();
+	l->revision = layoutRevision;
+	l->arenaSize = arenaSize;
+	std::copy(&majorRocks[0][0], &majorRocks[0][0] + 12, &l->rocks[0][0]);
+	l->coral.assign(coralSegments.begin(), coralSegments.end());
+	l->coralLive.assign((l->coral.size() + 63) / 64, 0);
+	std::vector<AABB> boxes(l->coral.size());
+	for (size_t i = 0;i < l->coral.size();i++) {
+		boxes[i] = getCoralAABB(l->coral[i]);
+		if (l->coral[i].visible) l->coralLive[i >> 6] |= 1ull << (i & 63);
+	}
+	buildBvh(l->coralBvh, boxes.data(), (int)boxes.size());
+	return l;
+}
+
+void publishSnapshot(bool restart) {
+	PROFILE_ZONE("publishSnapshot");
+	SimSnapshot& s = slots[back];
+	// the tick before comes from the slot handed over last, which back never is
+	if (!restart && published >= 0) s.prev = slots[published].curr;
+	captureFrame(s.curr);
+	if (restart || published < 0) s.prev = s.curr;
+	s.simTick = simTick;
+	s.sessionTick = sessionTick;
+	s.gameTime = gameTime;
+	s.collectedGoals = collectedGoals;
+	s.totalGoals = totalGoals;
+	s.gameOver = gameOver;
+	s.gameWin = gameWin;
+	s.layoutRevision = layoutRevision;
+	if (!layout || layout->revision != layoutRevision) layout = captureLayout();
+	s.layout = layout;
+	if (snapshotNavHint) navHintPath(agents[0].x, agents[0].z, s.hintPath);
+	else s.hintPath.clear();
+	s.sequence = ++sequence;
+
+	published = back;
+	back = middle.exchange(back | snapshotFresh) & ~snapshotFresh;
+}
+
+const SimSnapshot& acquireSnapshot() {
+	if (middle.load() & snapshotFresh) front = middle.exchange(front) & ~snapshotFresh;
+	return slots[front];
+}
+
+const SimSnapshot& frontSnapshot() {
+	return slots[front];
+}
@@ -0,0 +1,66 @@
+#pragma once
+///////////////
+// Simulation snapshots
+// Everything the renderer and the HUD read of the simulation, copied out after each tick:
+// the divers' poses, the objects with their animation phases and visibility, the round's
+// counters and the path hint. Three slots: the simulation fills its back slot and publishes
+// it with one atomic exchange against the middle; the render side takes the newest
+// published slot with another and reads it as an immutable front until its next acquire.
+// Neither side ever waits for the other, and the slots keep their capacity, so a steady run
+// does not allocate. A snapshot holds the tick before too, for interpolation.
+// The layout (coral, rocks, the arena) only changes at layoutRevision, on a new round, a
+// coral visibility flip or a streamed chunk, so it is not copied per tick: each revision
+// gets one immutable generation that every snapshot of it shares. The simulation rebuilds
+// coralSegments in place; the render side keeps reading the generation its front snapshot
+// holds, which stays alive until that slot is handed back by the next acquire.
+///////////////
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "coral_sim.h"
+#include "coral_bvh.h"
+
+struct AgentPose {
+	float x, y, z;
+	float angleY, pitch;
+};
+
+// state after one tick
+struct SimFrame {
+	std::vector<AgentPose> agents; // the player first
+	std::vector<SceneObj> majors, regs;
+	std::vector<GoalObj> goals;
+	float colorPhase;
+};
+
+// one layoutRevision's layout, never changed once published
+struct SimLayout {
+	unsigned revision; // layoutRevision it was taken at
+	float arenaSize;
+	float rocks[3][4]; // majorRocks
+	std::vector<CoralSegment> coral; // coralSegments, visibility included
+	std::vector<uint64_t> coralLive; // bit i = coral[i].visible, the BVH's filter
+	Bvh coralBvh; // over every coral box, hidden ones included
+};
+
+struct SimSnapshot {
+	SimFrame prev, curr; // the last two ticks; equal right after a restart
+	long long simTick, sessionTick;
+	float gameTime;
+	int collectedGoals, totalGoals;
+	bool gameOver, gameWin;
+	unsigned layoutRevision;
+	std::shared_ptr<const SimLayout> layout; // the generation of layoutRevision
+	std::vector<float> hintPath; // x, z pairs from the player to the nearest goal (snapshotNavHint)
+	unsigned sequence; // publishes so far
+};
+
+extern bool snapshotNavHint; // publish the path hint (coral_nav.h) with every snapshot
+
+// simulation side, after a tick; restart = no tick before it (new round), prev = curr
+void publishSnapshot(bool restart = false);
+// render side: takes the newest published snapshot if there is one; it stays unchanged
+// until the next call
+const SimSnapshot& acquireSnapshot();
+const SimSnapshot& frontSnapshot(); // the one acquireSnapshot returned last
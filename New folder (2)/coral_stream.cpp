@@ -0,0 +1,392 @@
+#include "coral_stream.h"
+#include "coral_level.h"
+
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+size_t streamBudgetBytes = 0;
+float streamRadius = 24.0f;
+
+static const float streamLookahead = 1.0f; // seconds of movement the diver focus runs ahead
+
+enum ChunkState { CHUNK_UNLOADED, CHUNK_LOADING, CHUNK_RESIDENT, CHUNK_FAILED };
+
+struct ChunkLoad {
+	int chunk;
+	bool ok;
+	std::vector<CoralSegment> coral;
+};
+
+///////////////
+// Streamed level (main thread; the worker only reads streamHeader/streamTable, which
+// never change while it runs)
+///////////////
+static bool streamOn = false;
+static std::string streamPath;
+static LevelFileHeader streamHeader;
+static LevelChunkTable streamTable;
+static std::vector<uint8_t> chunkState;
+static std::vector<std::vector<CoralSegment>> chunkCoral;
+static std::vector<int> residentChunks; // resident chunks that have coral
+static std::vector<unsigned> keepStamp; // chunk -> plan that wants it
+static unsigned planStamp = 0;
+static long long planKey = -1; // focus chunks + radii the current plan was made for
+static size_t loadingBytes = 0;
+static bool layoutDirty = false;
+static std::vector<int> changedChunks; // residency flips since the last rebuild
+static std::vector<unsigned> chunkRevision; // chunk -> layoutRevision of the rebuild that last flipped it
+static unsigned streamRevision = 0; // layoutRevision the last rebuild made
+static unsigned chainRevision = 0; // every layout change since this one was a streamed rebuild
+static float cameraFocusX = 0.0f, cameraFocusZ = 0.0f, cameraFocusRadius = 0.0f;
+static StreamStats stats;
+
+static size_t chunkBytes(int k) {
+	return (size_t)(streamTable.start[k + 1] - streamTable.start[k]) * sizeof(CoralSegment);
+}
+
+///////////////
+// I/O thread: reads queued chunks through its own handle on the level file
+///////////////
+static struct StreamWorker {
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake, idle;
+	std::deque<int> requests;
+	std::vector<ChunkLoad> done;
+	int busy = 0; // requests taken off the queue but not yet in done
+	bool quit = false;
+	FILE* file = nullptr;
+
+	void run() {
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;) {
+			wake.wait(lock, [&] { return quit || !requests.empty(); });
+			if (quit) return;
+			ChunkLoad load;
+			load.chunk = requests.front();
+			requests.pop_front();
+			busy++;
+			lock.unlock();
+			uint32_t first = streamTable.start[load.chunk];
+			uint32_t count = streamTable.start[load.chunk + 1] - first;
+			load.coral.resize(count);
+			load.ok = readLevelCoral(file, streamHeader, first, count, load.coral.data());
+			lock.lock();
+			done.push_back(std::move(load));
+			busy--;
+			idle.notify_all();
+		}
+	}
+	void stop() {
+		if (thread.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				quit = true;
+			}
+			wake.notify_all();
+			thread.join();
+		}
+		quit = false;
+		requests.clear();
+		done.clear();
+		busy = 0;
+		if (file) fclose(file);
+		file = nullptr;
+	}
+	~StreamWorker() { stop(); }
+} worker;
+
+///////////////
+// Residency
+///////////////
+static void rebuildResidentLayout() {
+	auto t0 = std::chrono::steady_clock::now();
+	std::sort(residentChunks.begin(), residentChunks.end());
+	size_t total = 0;
+	for (int k : residentChunks) total += chunkCoral[k].size();
+	coralSegments.clear();
+	coralSegments.reserve(total);
+	for (int k : residentChunks)
+		for (const auto& c : chunkCoral[k]) coralSegments.push_back(c);
+	buildCollisionGrid();
+	// somebody else moved the layout since the last rebuild (a new round, coral hidden):
+	// the chunk revisions no longer tell the whole story before this one
+	bool chained = layoutRevision == streamRevision;
+	layoutRevision++;
+	streamRevision = layoutRevision;
+	if (!chained) chainRevision = layoutRevision;
+	for (int k : changedChunks) chunkRevision[k] = layoutRevision;
+	changedChunks.clear();
+	layoutDirty = false;
+	stats.rebuilds++;
+	stats.rebuildMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static void mergeFinishedLoads() {
+	static std::vector<ChunkLoad> finished;
+	{
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		finished.swap(worker.done);
+	}
+	for (auto& load : finished) {
+		int k = load.chunk;
+		loadingBytes -= chunkBytes(k);
+		if (!load.ok) {
+			// stays solid; not retried
+			fprintf(stderr, "%s: cannot read chunk %d\n", streamPath.c_str(), k);
+			chunkState[k] = CHUNK_FAILED;
+			continue;
+		}
+		if (keepStamp[k] != planStamp && stats.residentBytes + loadingBytes + chunkBytes(k) > streamBudgetBytes) {
+			// read before the plan moved on and no room for it
+			chunkState[k] = CHUNK_UNLOADED;
+			continue;
+		}
+		chunkState[k] = CHUNK_RESIDENT;
+		chunkCoral[k].swap(load.coral);
+		residentChunks.push_back(k);
+		stats.residentBytes += chunkBytes(k);
+		stats.loads++;
+		changedChunks.push_back(k);
+		layoutDirty = true;
+	}
+	finished.clear();
+	stats.peakBytes = std::max(stats.peakBytes, stats.residentBytes);
+}
+
+// distance from (x, z) to the chunk's bounds (0 inside)
+static float chunkDistance(int k, float x, float z) {
+	const float* b = &streamTable.bounds[k * 4];
+	float dx = std::max(std::max(b[0] - x, x - b[2]), 0.0f);
+	float dz = std::max(std::max(b[1] - z, z - b[3]), 0.0f);
+	return sqrtf(dx * dx + dz * dz);
+}
+
+static int chunkAt(float x, float z) {
+	const LevelChunkTable& t = streamTable;
+	int cx = std::min(std::max((int)floorf(x / t.size), 0), t.nx - 1);
+	int cz = std::min(std::max((int)floorf(z / t.size), 0), t.nz - 1);
+	return cz * t.nx + cx;
+}
+
+// keeps the chunks around the focus points nearest first while they fit the budget, queues
+// the missing ones, drops queued loads that are no longer wanted and evicts the farthest
+// unwanted chunks while resident + loading coral is over the budget
+static void planStream(float px, float pz, float aheadX, float aheadZ) {
+	struct Focus { float x, z, r; };
+	Focus focus[2] = { { aheadX, aheadZ, streamRadius }, { cameraFocusX, cameraFocusZ, cameraFocusRadius } };
+	int playerChunk = chunkAt(px, pz);
+	// priority: distance relative to the focus radius, the diver's own chunk first
+	auto priority = [&](int k) {
+		float p = 1e30f;
+		for (const auto& f : focus)
+			if (f.r > 0.0f) p = std::min(p, chunkDistance(k, f.x, f.z) / f.r);
+		return k == playerChunk ? -1.0f : p;
+		};
+
+	static std::vector<std::pair<float, int>> wanted;
+	wanted.clear();
+	if (++planStamp == 0) {
+		std::fill(keepStamp.begin(), keepStamp.end(), 0);
+		planStamp = 1;
+	}
+	const LevelChunkTable& t = streamTable;
+	if (chunkBytes(playerChunk) > 0) {
+		keepStamp[playerChunk] = planStamp;
+		wanted.push_back(std::make_pair(-1.0f, playerChunk));
+	}
+	for (const auto& f : focus) {
+		if (f.r <= 0.0f) continue;
+		// chunk bounds can overhang by their coral, so look one chunk further out
+		int x0 = std::max((int)floorf((f.x - f.r) / t.size) - 1, 0), x1 = std::min((int)floorf((f.x + f.r) / t.size) + 1, t.nx - 1);
+		int z0 = std::max((int)floorf((f.z - f.r) / t.size) - 1, 0), z1 = std::min((int)floorf((f.z + f.r) / t.size) + 1, t.nz - 1);
+		for (int z = z0;z <= z1;z++)
+			for (int x = x0;x <= x1;x++) {
+				int k = z * t.nx + x;
+				if (keepStamp[k] == planStamp || chunkBytes(k) == 0) continue;
+				if (chunkDistance(k, f.x, f.z) > f.r) continue;
+				keepStamp[k] = planStamp;
+				wanted.push_back(std::make_pair(priority(k), k));
+			}
+	}
+	std::sort(wanted.begin(), wanted.end());
+
+	// the nearest chunks that fit the budget stay wanted (the diver's own chunk always does)
+	size_t used = 0;
+	for (size_t i = 0;i < wanted.size();i++) {
+		int k = wanted[i].second;
+		used += chunkBytes(k);
+		if (k != playerChunk && used > streamBudgetBytes) keepStamp[k] = 0;
+	}
+
+	std::lock_guard<std::mutex> lock(worker.mutex);
+	// queued loads nobody wants any more
+	for (auto it = worker.requests.begin();it != worker.requests.end();) {
+		if (keepStamp[*it] == planStamp) { ++it; continue; }
+		chunkState[*it] = CHUNK_UNLOADED;
+		loadingBytes -= chunkBytes(*it);
+		it = worker.requests.erase(it);
+	}
+	// evict the farthest unwanted chunks while over the budget
+	size_t incoming = 0;
+	for (const auto& w : wanted)
+		if (keepStamp[w.second] == planStamp && chunkState[w.second] == CHUNK_UNLOADED) incoming += chunkBytes(w.second);
+	if (stats.residentBytes + loadingBytes + incoming > streamBudgetBytes) {
+		static std::vector<std::pair<float, int>> victims;
+		victims.clear();
+		for (int k : residentChunks)
+			if (keepStamp[k] != planStamp) victims.push_back(std::make_pair(priority(k), k));
+		std::sort(victims.begin(), victims.end());
+		while (!victims.empty() && stats.residentBytes + loadingBytes + incoming > streamBudgetBytes) {
+			int k = victims.back().second;
+			victims.pop_back();
+			chunkState[k] = CHUNK_UNLOADED;
+			std::vector<CoralSegment>().swap(chunkCoral[k]);
+			residentChunks.erase(std::find(residentChunks.begin(), residentChunks.end(), k));
+			stats.residentBytes -= chunkBytes(k);
+			stats.evictions++;
+			changedChunks.push_back(k);
+			layoutDirty = true;
+		}
+	}
+	// queue the missing ones nearest first
+	for (const auto& w : wanted) {
+		int k = w.second;
+		if (keepStamp[k] != planStamp || chunkState[k] != CHUNK_UNLOADED) continue;
+		chunkState[k] = CHUNK_LOADING;
+		loadingBytes += chunkBytes(k);
+		worker.requests.push_back(k);
+	}
+	worker.wake.notify_one();
+}
+
+static void streamStep(float px, float pz, float aheadX, float aheadZ) {
+	mergeFinishedLoads();
+	// replan when the diver, its focus or the camera focus moves to another chunk or changes size
+	const LevelChunkTable& t = streamTable;
+	long long chunks = (long long)t.nx * t.nz;
+	long long key = ((chunkAt(px, pz) * chunks + chunkAt(aheadX, aheadZ)) * chunks + chunkAt(cameraFocusX, cameraFocusZ)) * 256 +
+		(long long)std::min(cameraFocusRadius / t.size, 255.0f);
+	if (key != planKey) {
+		planKey = key;
+		planStream(px, pz, aheadX, aheadZ);
+	}
+	if (layoutDirty) rebuildResidentLayout();
+}
+
+///////////////
+// Public interface
+///////////////
+bool worldStreamActive() {
+	return streamOn;
+}
+
+bool beginWorldStream(const char* path) {
+	if (streamOn && streamPath == path) {
+		// new round on the same level: fresh objects, keep the resident chunks
+		LevelFileHeader h;
+		LevelChunkTable table;
+		if (!loadLevelObjects(path, h, table)) return false;
+	}
+	else {
+		endWorldStream();
+		if (!loadLevelObjects(path, streamHeader, streamTable)) return false;
+		worker.file = fopen(path, "rb");
+		if (!worker.file) return false;
+		int chunks = streamTable.nx * streamTable.nz;
+		chunkState.assign(chunks, CHUNK_UNLOADED);
+		chunkCoral.assign(chunks, std::vector<CoralSegment>());
+		keepStamp.assign(chunks, 0);
+		chunkRevision.assign(chunks, 0);
+		for (int k = 0;k < chunks;k++)
+			if (chunkBytes(k) == 0) chunkState[k] = CHUNK_RESIDENT; // nothing to load, never solid
+		stats = StreamStats();
+		stats.chunks = chunks;
+		streamPath = path;
+		streamOn = true;
+		worker.thread = std::thread([] { worker.run(); });
+	}
+	// the diver starts with its surroundings in memory
+	planKey = -1;
+	streamStep(playerStartX, playerStartZ, playerStartX, playerStartZ);
+	waitWorldStream();
+	mergeFinishedLoads();
+	rebuildResidentLayout(); // also picks up the fresh majors and rocks
+	return true;
+}
+
+void endWorldStream() {
+	worker.stop();
+	streamOn = false;
+	streamPath.clear();
+	chunkState.clear();
+	chunkCoral.clear();
+	residentChunks.clear();
+	keepStamp.clear();
+	changedChunks.clear();
+	chunkRevision.clear();
+	loadingBytes = 0;
+	planKey = -1;
+	layoutDirty = false;
+}
+
+void setStreamCameraFocus(float x, float z, float radius) {
+	cameraFocusX = x;
+	cameraFocusZ = z;
+	cameraFocusRadius = radius;
+}
+
+void updateWorldStream() {
+	if (!streamOn) return;
+	const Agent& p = player();
+	streamStep(p.x, p.z, p.x + p.velX * streamLookahead, p.z + p.velZ * streamLookahead);
+}
+
+void waitWorldStream() {
+	std::unique_lock<std::mutex> lock(worker.mutex);
+	worker.idle.wait(lock, [] { return worker.requests.empty() && worker.busy == 0; });
+}
+
+void streamBlockers(const AABB& box, std::vector<AABB>& out) {
+	out.clear();
+	if (!streamOn) return;
+	const LevelChunkTable& t = streamTable;
+	// chunk bounds can overhang by their coral, so look one chunk further out
+	int x0 = std::max((int)floorf(box.minx / t.size) - 1, 0), x1 = std::min((int)floorf(box.maxx / t.size) + 1, t.nx - 1);
+	int z0 = std::max((int)floorf(box.minz / t.size) - 1, 0), z1 = std::min((int)floorf(box.maxz / t.size) + 1, t.nz - 1);
+	for (int z = z0;z <= z1;z++)
+		for (int x = x0;x <= x1;x++) {
+			int k = z * t.nx + x;
+			if (chunkState[k] == CHUNK_RESIDENT) continue;
+			const float* b = &t.bounds[k * 4];
+			AABB c = AABB{ b[0], -1e6f, b[1], b[2], 1e6f, b[3] };
+			if (aabbIntersects(box, c)) out.push_back(c);
+		}
+}
+
+bool streamChangedChunks(unsigned since, std::vector<AABB>& out) {
+	out.clear();
+	if (!streamOn || layoutRevision != streamRevision || since < chainRevision || since > layoutRevision) return false;
+	const LevelChunkTable& t = streamTable;
+	for (int k = 0;k < (int)chunkRevision.size();k++) {
+		if (chunkRevision[k] <= since) continue;
+		const float* b = &t.bounds[k * 4];
+		out.push_back(AABB{ b[0], -1e6f, b[1], b[2], 1e6f, b[3] });
+	}
+	return true;
+}
+
+const StreamStats& worldStreamStats() {
+	int loading = 0;
+	for (uint8_t s : chunkState) loading += s == CHUNK_LOADING ? 1 : 0;
+	stats.loading = loading;
+	stats.resident = (int)residentChunks.size();
+	return stats;
+}
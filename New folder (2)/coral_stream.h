@@ -0,0 +1,40 @@
+#pragma once
+///////////////
+// World streaming
+// A streamed level (--level file.crlv --stream MB) keeps only the coral of the chunks near
+// the diver and the camera in memory. A background I/O thread reads chunks through the
+// level's chunk table (coral_level.h); updateWorldStream, run at the start of every
+// simulation step, merges finished loads, evicts the farthest chunks while the resident
+// coral is over the memory budget, rebuilds coralSegments and the collision grid from the
+// resident chunks and queues the next loads nearest first. Chunks that are not in memory
+// are solid to the diver. Majors, regulars, goals and rocks are few and stay resident.
+///////////////
+#include <vector>
+#include <cstddef>
+
+#include "coral_sim.h"
+
+extern size_t streamBudgetBytes; // resident coral budget; 0 = streaming off (the level is mapped whole)
+extern float streamRadius; // world units kept loaded around the diver and ahead of its movement
+
+struct StreamStats {
+	int chunks; // in the level
+	int resident, loading;
+	size_t residentBytes, peakBytes;
+	long long loads, evictions, rebuilds;
+	double rebuildMs; // total time spent rebuilding coralSegments and the collision grid
+};
+
+bool worldStreamActive();
+// objects of the level and its chunks around the spawn (read before returning); a new round
+// on the same level keeps the resident chunks. false if the level can't be opened
+bool beginWorldStream(const char* path);
+void endWorldStream(); // stops the I/O thread and drops the resident chunks
+void setStreamCameraFocus(float x, float z, float radius); // ground the active camera mode shows; radius 0 = none
+void updateWorldStream();
+void waitWorldStream(); // blocks until the queued loads are read (round start, benchmarks)
+void streamBlockers(const AABB& box, std::vector<AABB>& out); // not-resident chunks under box, as full-height boxes
+// the chunks loaded or evicted since layoutRevision was `since`, as full-height boxes; false
+// when the layout also changed some other way since (a new round, hidden coral, no stream)
+bool streamChangedChunks(unsigned since, std::vector<AABB>& out);
+const StreamStats& worldStreamStats();